@@ -8,16 +8,22 @@
 // or submit itself to any jurisdiction.
 
 
+#pragma once
+
 // STL
 #include <memory>
+#include <string>
+#include <vector>
 
 // HepMC3
 #include "HepMC3/GenParticle.h"
 #include "HepMC3/GenEvent.h"
+#include "HepMC3/Reader.h"
 #include "HepMC3/ReaderAsciiHepMC2.h"
 
 #include "SQLamarr/db_functions.h"
 #include "SQLamarr/BaseSqlInterface.h"
+#include "SQLamarr/ColumnarEventStore.h"
 
 namespace SQLamarr
 {
@@ -49,13 +55,79 @@ namespace SQLamarr
     `AbsDataLoader` should be implemented to provide the logic for *loading*
     the data, without the need of re-implementing the interactions with 
     the database.
+
+    If a ColumnarEventStore is attached to the database, vertices and 
+    particles are appended directly to its tables, bypassing the SQL engine.
+
+    Lists of files can be loaded with `load_many`, parsing the files in
+    parallel threads, each writing to a private in-memory database.
+    The temporary databases are then attached to the main connection and 
+    their rows are copied to the event store, in the order of the list, 
+    shifting the identifiers of the events, vertices and particles after 
+    those already stored. The transformers keep running on the single 
+    connection of the event store.
+    ```cpp
+    HepMC2DataLoader loader (db);
+    loader.load_many(file_paths, runNumber, firstEvtNumber, 8);
+    ```
+    Loaders not implementing `clone` load the files sequentially.
   */
   class AbsDataLoader: public BaseSqlInterface
   {
     public:
       using BaseSqlInterface::BaseSqlInterface;
 
+      /// Value of `max_events` loading all the events of the source
+      static const size_t all_events = static_cast<size_t>(-1);
+
+      /// Load an event from a file or other data source 
+      virtual void load (
+          const std::string& file_path, ///< Path or identifier of the source
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t evt_number           ///< Unique identifier of the event 
+          ) = 0;
+
+      /// Load a list of files, one event per file with increasing event 
+      /// numbers, parsing the files in parallel threads
+      void load_many (
+          const std::vector<std::string>& file_paths, ///< Paths of the sources
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t first_evt_number,    ///< Event number of the first file
+          unsigned int n_threads = 0  ///< Number of threads, 0 for all cores
+          );
+
     protected: 
+      /// Create a loader of the same type, writing to another database.
+      /// Used by `load_many`, returns nullptr if not supported.
+      virtual std::unique_ptr<AbsDataLoader> clone (SQLite3DB& /*db*/) const
+      { return std::unique_ptr<AbsDataLoader>(); }
+
+      /** Dense mapping of the HepMC vertex identifiers of a `GenEvent` to
+        the identifiers of the inserted rows.
+
+        HepMC3 numbers the vertices of a `GenEvent` as -1, -2, ..., hence
+        the rows are stored in arrays indexed by `-hepmc_id - 1`.
+        The arrays are reused across `GenEvent`s, so that no memory is
+        allocated once they have grown to the size of the largest event.
+        */
+      class VertexMapping
+      {
+        public:
+          /// Size the arrays for the vertices of `evt` and flag the 
+          /// end vertices of its beam particles as primary vertices
+          void reset (HepMC3::GenEvent& evt);
+
+          /// Row identifier of the vertex with identifier `hepmc_id`
+          int& operator[] (int hepmc_id) { return m_rows[-hepmc_id - 1]; }
+
+          /// True if the vertex is the end vertex of a beam particle
+          bool is_primary (int hepmc_id) const 
+          { return m_primary[-hepmc_id - 1] != 0; }
+
+        private:
+          std::vector<int> m_rows;
+          std::vector<char> m_primary;
+      };
       
       /// Insert data source reference in the `DataSources` table
       int insert_event (
@@ -110,6 +182,43 @@ namespace SQLamarr
           float m          ///< Generated mass which in HepMC may differ from
                            ///  \f$\sqrt{e^2-p^2}\f$ for resonances
           );
+
+      /// Insert a HepMC `GenEvent` as a collision, with its vertices and 
+      /// particles. Returns the global identifier of the collision.
+      int insert_hepmc_collision (
+          int datasource_id,      ///< Unique identifier of the HEP event
+          HepMC3::GenEvent& evt   ///< Collision to insert
+          );
+
+      /// Insert the `GenEvent`s read from a HepMC3 reader as the
+      /// collisions of a single event, in a transaction. If no `GenEvent`
+      /// is read (for example, a range past the end of the file), the
+      /// event is not inserted.
+      void load_hepmc_events (
+          HepMC3::Reader& reader,         ///< Reader of the input file
+          const std::string& data_source, ///< Identifier of the data source
+          size_t run_number,              ///< Unique identifier of the run 
+          size_t evt_number,              ///< Unique identifier of the event 
+          size_t skip_events = 0,         ///< `GenEvent`s to skip first
+          size_t max_events = all_events  ///< Maximum `GenEvent`s to load
+          );
+
+    private:
+      /// Copy the content of a database to the event store, shifting the 
+      /// identifiers of its rows after those already stored
+      void merge_database (const std::string& uri);
+
+      /// Largest identifier ever assigned in an event store table
+      sqlite3_int64 last_id (const std::string& table, const std::string& id);
+
+      /// Columnar table replacing `table` in the database, if any
+      ColumnarTable* columnar_table (bool particles);
+
+    private:
+      VertexMapping m_vertex_mapping;
+      sqlite3* m_columnar_db = nullptr;
+      unsigned int m_columnar_generation = 0;
+      ColumnarEventStore* m_columnar_store = nullptr;
   };
 }
 
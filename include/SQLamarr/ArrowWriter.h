@@ -0,0 +1,148 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// SQLamarr
+#include "SQLamarr/BaseSqlInterface.h"
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/Transformer.h"
+
+namespace SQLamarr
+{
+  /** Append the result of a query to a file in the Arrow IPC file format.
+
+  Each execution runs the SELECT statement and appends its rows to
+  column buffers, which are written to the file as a record batch every
+  `batch_size` rows. The footer of the file, indexing the record batches,
+  is written by `close()` (or by the destructor, if executed at least 
+  once), after which the file can be read, for example, with 
+  `pyarrow.ipc.open_file` or `pandas.read_feather`, and memory-mapped 
+  without copying the buffers.
+
+  The type of each column follows the declared type of the selected
+  column, with the rules of the SQLite type affinity: 64-bit integers if
+  it contains "INT", UTF-8 strings if it contains "CHAR", "CLOB" or "TEXT",
+  and 64-bit floating point numbers otherwise. The type of the columns 
+  without a declared type, as expressions, is that of their first non-NULL
+  value (integer, floating point or text), hence the schema is written 
+  with the first record batch; columns with NULL values only in the first
+  batch are floating point. A value of these columns inconsistent with
+  the type (other than an integer in a floating point column) raises an
+  exception: expressions of mixed types should be converted with `CAST`.
+  NULL values are marked as such in the validity bitmaps.
+
+  If an execution fails, the writer stops accepting rows: `close()` 
+  completes the file with the record batches already written, discarding
+  the rows buffered since the last one.
+
+  Buffers are stored uncompressed in the byte order of the machine,
+  assumed little-endian.
+
+  Example.
+  ```cpp
+  SQLamarr::SQLite3DB db = SQLamarr::make_database(":memory:");
+
+  SQLamarr::ArrowWriter writer(db, "particles.arrow",
+    "SELECT mcparticle_id, pid, px, py, pz FROM MCParticles"
+    );
+
+  Pipeline pipeline({&pv_finder, &mcps, &writer, &clean}, &loader);
+  pipeline.execute_over_files(input_files, runNumber);
+  writer.close();
+  ```
+  */
+  class ArrowWriter: public BaseSqlInterface, public Transformer
+  {
+    public:
+      /// Constructor
+      ArrowWriter (
+          SQLite3DB& db,
+            ///< Reference to the database
+          const std::string& file_path,
+            ///< Path to the output file, overwritten if existing
+          const std::string& query,
+            ///< SQL SELECT statement defining the columns of the file
+          size_t batch_size = 65536
+            ///< Number of rows of each record batch
+          );
+
+      /// Complete the file, if opened by `execute()`
+      ~ArrowWriter ();
+
+      /// Append the rows returned by the query to the file
+      void execute () override;
+
+      /// Write the pending rows and the footer, completing the file
+      void close ();
+
+    private: // types
+      /// Identifiers of the types in the Arrow schema
+      enum ColumnType { Undefined = 0, Int64 = 2, Float64 = 3, Utf8 = 5 };
+
+      struct Column
+      {
+        std::string name;
+        ColumnType type;
+        bool inferred;                ///< Type defined by the values
+        std::string validity;         ///< One bit per row, 1 if not NULL
+        std::string values;           ///< Fixed-size values or characters
+        std::vector<int32_t> offsets; ///< Offsets of the strings in `values`
+        int64_t null_count;
+      };
+
+      struct Block
+      {
+        int64_t offset;
+        int32_t metadata_length;
+        int64_t body_length;
+      };
+
+    private: // methods
+      /// Open the file and define the columns from the query
+      void open ();
+
+      /// Append the current row of the query to the column buffers
+      void append_row (sqlite3_stmt* stmt);
+
+      /// Write the schema, fixing the types of the columns
+      void write_schema ();
+
+      /// Define the type of a column, with `n_rows` NULL values buffered
+      void set_type (Column& column, ColumnType type, int64_t n_rows);
+
+      /// Write the buffered rows as a record batch
+      void write_batch ();
+
+      /// Write an encapsulated message, returning its position in the file
+      Block write_message (const std::string& metadata, const std::string& body);
+
+      /// Write raw bytes to the file
+      void write_bytes (const void* data, size_t size);
+
+    private: // members
+      const std::string m_file_path;
+      const std::string m_query;
+      const size_t m_batch_size;
+      std::ofstream m_file;
+      int64_t m_file_offset;
+      bool m_closed;
+      bool m_schema_written;
+      bool m_failed;                ///< An execution failed
+      std::vector<Column> m_columns;
+      int64_t m_n_rows;
+      std::vector<Block> m_batches;
+  };
+}
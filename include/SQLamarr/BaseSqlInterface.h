@@ -9,14 +9,32 @@
 
 
 #pragma once
+#include <stdint.h>
 #include <iostream>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "SQLamarr/db_functions.h"
 
 namespace SQLamarr
 {
+  /// Profiling counters of a cached statement, accumulated across executions
+  struct StatementProfile
+  {
+    std::string name;         ///< Name of the statement in the cache
+    std::string sql;          ///< SQL text of the statement
+    std::string query_plan;   ///< Output of EXPLAIN QUERY PLAN, one row per line
+    uint64_t executions;      ///< Number of completed executions
+    double time;              ///< Cumulative execution time in seconds
+    int64_t fullscan_steps;   ///< Steps in full table scans
+    int64_t sorts;            ///< Sort operations
+    int64_t autoindex;        ///< Rows inserted in automatic indices
+    int64_t vm_steps;         ///< Virtual machine operations
+  };
+
   /** Abstract interface with helper functions to access an SQLite DB
 
     SQLamarr uses SQLite to replace the Transient Event Store of Gaudi
@@ -28,7 +46,44 @@ namespace SQLamarr
 
     It also standardize the calls to the BEGIN and END transaction queries that
     are used to drastically speed up sets of multiple queries when using a 
-    database with persistency.
+    database with persistency. Transactions opened while another transaction
+    is active are implemented as savepoints, so that the algorithms can 
+    run within a transaction spanning a whole batch (see Pipeline).
+
+    Optionally, the cached statements can be profiled to identify the 
+    queries relying on full table scans, sorts or automatic indices. 
+    For each statement, the `sqlite3_stmt_status` counters, the execution 
+    time measured with `sqlite3_trace_v2` and the query plan are 
+    recorded, keyed by the name of the statement.
+    ```cpp
+    PVFinder pv_finder(db);
+    pv_finder.set_profiling(true);
+    pv_finder.execute();
+    for (const StatementProfile& profile: pv_finder.statement_profiles())
+      std::cerr << profile.name << ": " << profile.fullscan_steps << "\n" 
+                << profile.query_plan;
+    ```
+    Note that profiling registers a trace callback on the connection, 
+    replacing any callback set with `sqlite3_trace_v2` by the application.
+
+    Transformers processing the event store by `genevent_id` can rely on
+    `genevent_range()` and `set_processed()` to restrict their queries to
+    the events loaded since their previous execution, so that a long-lived
+    store accumulating events does not result in a quadratic cost.
+    The incremental mode is disabled by default, so that the whole store 
+    is processed at each execution, and is enabled with 
+    `set_incremental(true)`.
+
+    If enabled with `set_table_tracking(true)`, the tables read and 
+    written by the cached statements are recorded while compiling them, 
+    and can be extended with `declare_tables()` for the accesses not going
+    through `get_statement()`. The Pipeline enables the tracking to 
+    schedule the algorithms not depending on each other concurrently and
+    to skip those whose inputs did not change.
+    Note that the tables are recorded with an authorizer callback 
+    (`sqlite3_set_authorizer`), installed while compiling a statement and 
+    removed afterwards: an authorizer set by the application on the same
+    connection is replaced, and must not be used with the tracking.
 
   */
   class BaseSqlInterface
@@ -41,11 +96,79 @@ namespace SQLamarr
       void sync_database(const std::string& db_uri)
       {update_db_connection(m_database, db_uri);}
 
+      /// Release the locks held by cached statements and flush the cache of 
+      /// the connection, making the updates visible to other connections 
+      /// without re-opening the database.
+      void flush() { reset_statements(); flush_database(m_database); }
+
+      /// Reference to the database connection
+      const SQLite3DB& database() const { return m_database; }
+
+      /// Number of rows returned by the statements executed with exec_stmt
+      uint64_t n_rows_returned() const { return m_n_rows_returned; }
+
+      /// Number of statements compiled with get_statement
+      uint64_t n_statements_prepared() const { return m_n_statements_prepared; }
+
       /// Invalidate the cache of the queries. 
       /// Especially useful to allow refreshing the connection when running 
       /// from Python.
       void invalidate_cache(void);
 
+      /// Reset the cached statements, releasing the locks they may hold on 
+      /// the tables, without finalizing them.
+      void reset_statements(void);
+
+      /// Enable or disable the profiling of the cached statements
+      void set_profiling(bool enabled);
+
+      /// True if the cached statements are being profiled
+      bool profiling() const { return m_profiling; }
+
+      /// Profiling counters of the statements, sorted by name
+      std::vector<StatementProfile> statement_profiles(void);
+
+      /// Reset the profiling counters, preserving the query plans
+      void reset_profiles(void);
+
+      /// Enable or disable the processing of the new events only
+      void set_incremental(bool enabled) { m_incremental = enabled; }
+
+      /// True if only the events loaded after the last execution are processed
+      bool incremental() const { return m_incremental; }
+
+      /// Largest `genevent_id` processed in incremental mode
+      sqlite3_int64 last_processed_event() const { return m_last_genevent_id; }
+
+      /// Forget the processed events, the next execution will process them all
+      void reset_processed_events() { m_last_genevent_id = 0; }
+
+      /// Enable or disable the recording of the tables accessed by the
+      /// statements. Enabling it compiles the cached statements again.
+      void set_table_tracking(bool enabled);
+
+      /// True if the tables accessed by the statements are recorded
+      bool table_tracking() const { return m_table_tracking; }
+
+      /// Tables read by the cached statements (lowercase names)
+      const std::set<std::string>& tables_read() const 
+      { return m_tables_read; }
+
+      /// Tables created, dropped or modified by the cached statements 
+      /// (lowercase names)
+      const std::set<std::string>& tables_written() const 
+      { return m_tables_written; }
+
+      /// Roll back the transactions (or savepoints) opened by 
+      /// `begin_transaction()` and not ended, as after an exception
+      void rollback_transactions();
+
+      /// Add tables to those read and written by the algorithm
+      void declare_tables (
+          const std::vector<std::string>& read,   ///< Tables read
+          const std::vector<std::string>& written ///< Tables written
+          );
+
     protected: // members
       SQLite3DB& m_database; ///< Reference to the SQLite database (not owned).
 
@@ -53,6 +176,28 @@ namespace SQLamarr
     private: //members
       std::unordered_map<std::string, sqlite3_stmt*> m_queries;
       sqlite3* m_cached_raw_ptr;
+      uint64_t m_n_rows_returned;
+      uint64_t m_n_statements_prepared;
+      bool m_profiling;
+      std::unordered_map<std::string, StatementProfile> m_profiles;
+      bool m_incremental;
+      sqlite3_int64 m_last_genevent_id;
+      std::vector<bool> m_nested_transactions;
+      bool m_table_tracking;
+      std::set<std::string> m_tables_read;
+      std::set<std::string> m_tables_written;
+
+    private: // methods
+      /// Authorizer callback recording the tables accessed by a statement
+      static int record_table_access (void* self, int action, 
+          const char* arg1, const char* arg2, const char* schema, 
+          const char* trigger);
+
+      /// Start profiling a cached statement
+      void register_profile (const std::string& name, sqlite3_stmt* stmt);
+
+      /// Accumulate the status counters of a cached statement and reset them
+      void collect_stmt_status (const std::string& name, sqlite3_stmt* stmt);
 
     protected: // methods
       /// Creates or retrieve from cache a statement
@@ -64,11 +209,23 @@ namespace SQLamarr
           );
 
       /// Begin an SQL transaction stopping update to disk util
-      ///`end_transaction()` is issued 
-      void begin_transaction () { sqlite3_exec(m_database.get(), "BEGIN", 0, 0, 0); }
+      ///`end_transaction()` is issued. If a transaction is already open 
+      /// (e.g. by the Pipeline), a savepoint is created instead, so that 
+      /// `end_transaction()` does not commit the enclosing transaction.
+      /// The write lock is acquired immediately, so that an algorithm
+      /// running concurrently on another connection waits for the commit
+      /// rather than failing on a stale read snapshot.
+      void begin_transaction (
+          bool exclusive = false  ///< Use `BEGIN EXCLUSIVE` if not nested
+          );
+
+      /// End the transaction (or release the savepoint) opened by the 
+      /// matching `begin_transaction()`
+      void end_transaction ();
 
-      /// End an SQL transaction re-enabling disk updates
-      void end_transaction () { sqlite3_exec(m_database.get(), "COMMIT", 0, 0, 0); }
+      /// Discard the updates of the transaction (or of the savepoint) 
+      /// opened by the matching `begin_transaction()`
+      void rollback_transaction ();
 
       /// Return the index of the last rows inserted in any table
       int last_insert_row () { return sqlite3_last_insert_rowid(m_database.get()); }
@@ -88,5 +245,14 @@ namespace SQLamarr
 
       /// Execute a statement, possibly throwing an exception on failure
       bool exec_stmt (sqlite3_stmt*);
+
+      /// Range of `genevent_id` values (both included) to be processed: 
+      /// the events loaded since the last call to `set_processed()` in 
+      /// incremental mode, or all the events otherwise.
+      std::pair<sqlite3_int64, sqlite3_int64> genevent_range (void);
+
+      /// Mark the events up to `genevent_id` (included) as processed
+      void set_processed (sqlite3_int64 genevent_id) 
+      { m_last_genevent_id = genevent_id; }
   };
 }
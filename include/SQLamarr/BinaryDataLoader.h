@@ -0,0 +1,60 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <memory>
+#include <string>
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/AbsDataLoader.h"
+
+namespace SQLamarr
+{
+  /** `AbsDataLoader` implementation for files in the BinaryEventFormat.
+
+  Generator-level samples processed with multiple configurations can be
+  parsed once and converted to the binary format, which is then 
+  memory-mapped and copied to the event store without any parsing.
+
+  For example,
+  ```cpp
+  for (auto input_file: input_files)
+    HepMC2DataLoader::convert_to_binary(input_file, input_file + ".bin");
+
+  SQLite3DB db = make_database(":memory:");
+  BinaryDataLoader loader (db);
+  for (auto input_file: input_files)
+    loader.load(input_file + ".bin", runNumber, evtNumber++);
+  ```
+
+  The `load` function throws std::invalid_argument if the file cannot be
+  read or is not in the BinaryEventFormat.
+  */
+  class BinaryDataLoader: public AbsDataLoader
+  {
+    public:
+      using AbsDataLoader::AbsDataLoader;
+
+      /// Load an event (possibly including multiple collisions) from a
+      /// binary file written by BinaryEventWriter
+      void load (
+          const std::string& file_path, ///< Path to the binary file
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t evt_number           ///< Unique identifier of the event 
+          ) override;
+
+    protected:
+      /// Loader writing to another database, used by `load_many`
+      std::unique_ptr<AbsDataLoader> clone (SQLite3DB& db) const override
+      { return std::unique_ptr<AbsDataLoader>(new BinaryDataLoader(db)); }
+  };
+}
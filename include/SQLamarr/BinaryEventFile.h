@@ -0,0 +1,168 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace SQLamarr
+{
+  /** Binary, column-oriented representation of the generator-level data
+   * of an event, as loaded in the `GenEvents`, `GenVertices` and
+   * `GenParticles` tables.
+   *
+   * The file is composed of a fixed-size header, followed by one array per
+   * column, each padded to a multiple of 8 bytes. All the fields are
+   * stored as 32-bit integers or floats in the byte order of the machine
+   * writing the file, which is checked when reading it.
+   *
+   * Vertices and particles are stored contiguously for each collision,
+   * and the `FirstVertex` and `FirstParticle` columns (with one entry more
+   * than the collisions) delimit the rows of each collision.
+   * The `production_vertex` and `end_vertex` of the particles are indices
+   * of the vertices within the collision, or -1 if not defined.
+   *
+   * Files are written with BinaryEventWriter (see also
+   * HepMC2DataLoader::convert_to_binary) and are memory-mapped for reading
+   * by BinaryEventFile, so that loading them (see BinaryDataLoader) does not
+   * involve any parsing.
+   */
+  namespace BinaryEventFormat
+  {
+    /// Columns of the file, in the order they are stored
+    enum Column {
+      CollisionNumber, CollisionT, CollisionX, CollisionY, CollisionZ,
+      FirstVertex, FirstParticle,
+      VertexHepmcId, VertexStatus, VertexIsPrimary,
+      VertexT, VertexX, VertexY, VertexZ,
+      ParticleHepmcId, ParticleProductionVertex, ParticleEndVertex,
+      ParticlePid, ParticleStatus,
+      ParticlePe, ParticlePx, ParticlePy, ParticlePz, ParticleM,
+      NColumns
+    };
+
+    /// Header of the file
+    struct Header
+    {
+      char magic[8];          ///< "SQLMEVT" followed by a null character
+      uint32_t version;       ///< Version of the format
+      uint32_t byte_order;    ///< `byte_order_mark`, as written
+      uint32_t n_columns;     ///< Number of columns in the file
+      uint32_t reserved;      ///< Unused, zero
+      uint64_t n_collisions;  ///< Number of collisions (HepMC `GenEvent`s)
+      uint64_t n_vertices;    ///< Number of vertices
+      uint64_t n_particles;   ///< Number of particles
+    };
+
+    /// Version of the format written by BinaryEventWriter
+    const uint32_t version = 1;
+
+    /// Marker used to detect files written with a different byte order
+    const uint32_t byte_order_mark = 0x01020304;
+  }
+
+
+  /// Writer of event files in the BinaryEventFormat
+  class BinaryEventWriter
+  {
+    public:
+      /// Constructor
+      BinaryEventWriter (
+          const std::string& file_path ///< Path to the output file
+          );
+
+      /// Add a collision. Vertices and particles added next belong to it.
+      void add_collision (
+          int collision,  ///< HepMC identifier of the `GenEvent`
+          float t,        ///< Time coordinate of the origin
+          float x,        ///< x coordinate of the origin
+          float y,        ///< y coordinate of the origin
+          float z         ///< z coordinate of the origin
+          );
+
+      /// Add a vertex to the last collision.
+      /// Returns the index of the vertex within the collision.
+      int add_vertex (
+          int hepmc_id,   ///< HepMC identifier of the vertex
+          int status,     ///< HepMC status
+          float t,        ///< Vertex time coordinate
+          float x,        ///< Vertex *x* coordinate
+          float y,        ///< Vertex *y* coordinate
+          float z,        ///< Vertex *z* coordinate
+          bool is_primary ///< Boolean flag identifying primary vertices
+          );
+
+      /// Add a particle to the last collision
+      void add_particle (
+          int hepmc_id,   ///< HepMC identifier of the particle
+          int production_vertex, ///< Index of the production vertex, or -1
+          int end_vertex, ///< Index of the end vertex, or -1
+          int pid,        ///< PDG Identifier of the particle type
+          int status,     ///< HepMC status value
+          float pe,       ///< Energy of the particle
+          float px,       ///< *x* coordinate of the momentum
+          float py,       ///< *y* coordinate of the momentum
+          float pz,       ///< *z* coordinate of the momentum
+          float m         ///< Generated mass
+          );
+
+      /// Write the file
+      void write ();
+
+    private:
+      union Field { int32_t i; float f; };
+
+      const std::string m_file_path;
+      std::vector<Field> m_columns[BinaryEventFormat::NColumns];
+  };
+
+
+  /// Read-only, memory-mapped event file in the BinaryEventFormat
+  class BinaryEventFile
+  {
+    public:
+      /// Map a file in memory, throwing std::invalid_argument if the file
+      /// cannot be read or is not a valid event file
+      BinaryEventFile (const std::string& file_path);
+      ~BinaryEventFile ();
+
+      BinaryEventFile (const BinaryEventFile&) = delete;
+      BinaryEventFile& operator= (const BinaryEventFile&) = delete;
+
+      /// Number of collisions
+      size_t n_collisions () const { return m_header->n_collisions; }
+
+      /// Number of vertices
+      size_t n_vertices () const { return m_header->n_vertices; }
+
+      /// Number of particles
+      size_t n_particles () const { return m_header->n_particles; }
+
+      /// Fields of an integer column
+      const int32_t* integers (BinaryEventFormat::Column column) const
+      { return reinterpret_cast<const int32_t*>(m_columns[column]); }
+
+      /// Fields of a real column
+      const float* reals (BinaryEventFormat::Column column) const
+      { return reinterpret_cast<const float*>(m_columns[column]); }
+
+    private:
+      /// Check the rows of each collision are within the file
+      bool valid_boundaries (BinaryEventFormat::Column, size_t n_rows) const;
+
+    private:
+      void* m_data;
+      size_t m_size;
+      const BinaryEventFormat::Header* m_header;
+      const char* m_columns[BinaryEventFormat::NColumns];
+  };
+}
@@ -2,8 +2,11 @@
 
 #include "SQLamarr/db_functions.h"
 #include "SQLamarr/GenerativePlugin.h"
+#include "SQLamarr/MultiModelPlugin.h"
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 
 namespace SQLamarr 
@@ -20,6 +23,8 @@ namespace SQLamarr
      * the charge of the particle and the isMuon flag.
      *
      * A different model is defined for each particle (pi, K, p, and mu).
+     * The models of all the particles can be evaluated with a single scan
+     * of the tracks, writing to a single table, with `make_fused`.
     */
     namespace LbParticleId
     {
@@ -45,6 +50,30 @@ namespace SQLamarr
             ///< Absolute particle ID to process with this pipeline
           );
 
+      /// Initialize a `MultiModelPlugin` evaluating the PID model of each 
+      /// particle species on the tracks of that species, selected with
+      /// a single query, and writing the outputs of all the species to 
+      /// the same table.
+      std::unique_ptr<MultiModelPlugin> make_fused (
+          SQLite3DB& db,
+            ///< Reference to the database 
+          const std::string& library,
+            ///< Path to the library
+          const std::vector<std::pair<int, std::string> >& models,
+            ///< Absolute particle ID and name of the linking symbol of the
+            ///  model of each species
+          const std::string& output_table,
+            ///< Name of the output table (overwrite on existing)
+          const std::string& particle_table,
+            /**< Name of the MCParticle table.
+             * Table must include columns `mcparticle_id`,`px`, `py`, `pz`.
+             */
+          const std::string& track_table
+            /**< Name of table with track type information.
+             * Table must include column `track_type`.
+             */
+          );
+
       /// Provide a vector of the names of the columns of the output table.
       std::vector<std::string> get_column_names (
             bool include_indices = true,
@@ -21,7 +21,11 @@ namespace SQLamarr
    * including temporary instances, from SQLite3 schema, then loops over the 
    * existing tables and deletes all the rows.
    * This won't change the DB schema, nor change the DB connection data,
-   * but clean the database to process another batch
+   * but clean the database to process another batch.
+   *
+   * The AUTOINCREMENT counters (`sqlite_sequence` table) are preserved, so
+   * that the identifiers of the next batch (e.g. `genevent_id`) do not 
+   * overlap with those already processed by incremental transformers.
    */
   class CleanEventStore: public BaseSqlInterface, public Transformer
   {
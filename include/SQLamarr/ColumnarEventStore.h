@@ -0,0 +1,316 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// SQLite3
+#include "sqlite3.h"
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+
+namespace SQLamarr
+{
+  /** Bump allocator releasing all its allocations at once.
+   *
+   * Memory is obtained in large blocks which are kept when the arena is
+   * released, so that the next batch reuses them without further
+   * allocations. Objects allocated in the arena are never destructed.
+   */
+  class Arena
+  {
+    public:
+      /// Constructor
+      Arena (size_t block_size = 4 << 20 ///< Size of each block in bytes
+          );
+      ~Arena ();
+
+      Arena (const Arena&) = delete;
+      Arena& operator= (const Arena&) = delete;
+
+      /// Allocate `n_bytes` bytes, aligned to 16 bytes
+      void* allocate (size_t n_bytes);
+
+      /// Release all the allocations in O(1), keeping the blocks for reuse
+      void release () { m_current = 0; m_offset = 0; }
+
+      /// Memory reserved by the arena, in bytes
+      size_t capacity () const;
+
+    private:
+      struct Block { char* data; size_t size; };
+      const size_t m_block_size;
+      std::vector<Block> m_blocks;
+      size_t m_current;
+      size_t m_offset;
+  };
+
+
+  /** Table stored in memory as a structure of arrays.
+   *
+   * Rows are stored in chunks of `chunk_rows` rows allocated in an Arena,
+   * each chunk holding the columns as contiguous arrays.
+   * The first column is the unique identifier of the row (used as rowid by
+   * SQLite) and is assigned incrementally on insertion, as for
+   * `AUTOINCREMENT` columns. Identifiers are not reused after `release()`.
+   *
+   * Integer columns flagged as `indexed` can be searched by value through
+   * a sorted permutation of the rows, built lazily at the first search.
+   * Rows appended afterwards are merged into the permutation at the next
+   * search, in linear time if their values are not smaller than those
+   * already indexed (e.g. `genevent_id`), while updates of the column
+   * require sorting the whole permutation again.
+   *
+   * NULL integers are represented by `null_integer`, NULL reals by NaN.
+   */
+  class ColumnarTable
+  {
+    public:
+      /// Type of the column, as declared to SQLite
+      enum ColumnType { Integer, Real };
+
+      /// Definition of a column
+      struct Column
+      {
+        std::string name;   ///< Name of the column
+        ColumnType type;    ///< Type of the column
+        bool indexed;       ///< Enable searches by value (integers only)
+      };
+
+      /// Field of a row
+      union Value { int64_t i; double d; };
+
+      /// Representation of NULL in integer columns
+      static const int64_t null_integer;
+
+      /// Number of rows per chunk
+      static const size_t chunk_rows = 4096;
+
+      /// Sorted permutation of the row indices
+      typedef std::shared_ptr<const std::vector<uint32_t>> Index;
+
+      /// Constructor
+      ColumnarTable (
+          const std::string& name,            ///< Name of the SQL table
+          const std::vector<Column>& columns  ///< Columns, the first is the id
+          );
+
+      /// Name of the SQL table
+      const std::string& name () const { return m_name; }
+
+      /// Definition of the columns
+      const std::vector<Column>& columns () const { return m_columns; }
+
+      /// CREATE TABLE statement declaring the columns to SQLite
+      std::string declaration () const;
+
+      /// Number of rows, including the deleted ones
+      size_t size () const { return m_size; }
+
+      /// Number of rows not deleted
+      size_t n_live () const { return m_n_live; }
+
+      /// Identifier assigned to the next appended row
+      int64_t next_id () const { return m_next_id; }
+
+      /// Append a row, `values` listing all the columns but the id.
+      /// If `id` is not positive, the next identifier is assigned.
+      /// Returns the identifier of the new row.
+      int64_t append (const Value* values, int64_t id = 0);
+
+      /// Mark a row as deleted. Releases the memory if no row is left.
+      void remove (size_t row);
+
+      /// Update a field of a row
+      void update (size_t row, int column, Value value);
+
+      /// Field of a row
+      Value get (size_t row, int column) const
+      { return cell(row, column); }
+
+      /// True if the row was deleted
+      bool deleted (size_t row) const
+      { return cell(row, int(m_columns.size())).i != 0; }
+
+      /// Identifier of a row
+      int64_t id (size_t row) const { return cell(row, 0).i; }
+
+      /// First row with identifier not smaller than `id`
+      size_t lower_bound (int64_t id) const;
+
+      /// Permutation of the rows sorted by the value of an indexed column
+      Index index (int column);
+
+      /// Release all the rows in O(1)
+      void release ();
+
+      /// Start recording the modifications, so that they can be reverted
+      /// until `commit()`
+      void begin ();
+
+      /// Save the current state as the savepoint `level` (0-based)
+      void savepoint (int level);
+
+      /// Revert the modifications done after the savepoint `level`
+      void rollback_to (int level);
+
+      /// Forget the savepoints from `level` on
+      void release_savepoint (int level);
+
+      /// Stop recording the modifications. The memory is released if no
+      /// row is left.
+      void commit ();
+
+      /// Revert the modifications done after `begin()` and stop recording
+      void rollback ();
+
+      /// True if the modifications are being recorded
+      bool in_transaction () const { return !m_checkpoints.empty(); }
+
+      /// True if the virtual table exists in the database
+      bool created () const { return m_created; }
+
+      /// Set when the virtual table is created or dropped
+      void set_created (bool created) { m_created = created; }
+
+    private:
+      /// State of the table at the beginning of a transaction or savepoint
+      struct Checkpoint
+      {
+        size_t size;
+        size_t n_live;
+        int64_t next_id;
+        bool dense_ids;
+        size_t n_undo;  ///< Length of the undo log
+      };
+
+      /// Field overwritten during a transaction
+      struct Undo
+      {
+        size_t row;
+        int column;
+        Value value;
+      };
+
+      /// Record the value of a field before modifying it
+      void record_undo (size_t row, int column);
+
+      /// Restore the state of a checkpoint
+      void restore (const Checkpoint& checkpoint);
+
+      Value& cell (size_t row, int column) const
+      {
+        return m_chunks[row / chunk_rows][
+          column * chunk_rows + row % chunk_rows
+        ];
+      }
+
+    private:
+      const std::string m_name;
+      const std::vector<Column> m_columns;
+      Arena m_arena;
+      std::vector<Value*> m_chunks;
+      size_t m_size;
+      size_t m_n_live;
+      int64_t m_next_id;
+      bool m_dense_ids;
+      struct SortedIndex 
+      {
+        std::shared_ptr<std::vector<uint32_t>> permutation;
+        size_t n_rows;  ///< Number of rows included in the permutation
+      };
+      std::vector<SortedIndex> m_indices;
+      std::vector<Checkpoint> m_checkpoints; ///< Transaction, then savepoints
+      std::vector<Undo> m_undo;
+      bool m_created;
+  };
+
+
+  /** In-memory event store for the generator-level particles and vertices.
+   *
+   * The ColumnarEventStore replaces the `GenParticles` and `GenVertices`
+   * tables of a connection with virtual tables of the same name and
+   * columns, backed by ColumnarTable objects.
+   * The virtual tables are created in the `temp` schema and, being resolved
+   * before the tables of the `main` schema, are transparently used by the
+   * SQL statements of the data loaders and transformers, avoiding the cost
+   * of B-tree insertions and lookups.
+   * Searches by `genevent_id`, `production_vertex` and `end_vertex` rely
+   * on the sorted indices of the columnar tables.
+   *
+   * AbsDataLoader appends the particles and vertices directly to the columnar
+   * tables, bypassing the SQL engine.
+   * When all the rows of a table are deleted (e.g. by CleanEventStore),
+   * its memory is released in O(1) and reused for the next batch, once
+   * the transaction is committed.
+   *
+   * The virtual tables take part in the transactions and savepoints of the
+   * connection: rows appended after a savepoint are truncated when rolling
+   * back to it, while the fields of the previous rows modified by UPDATE 
+   * or DELETE are restored from an undo log. Since the rows appended by
+   * the data loaders bypass the SQL engine, the loaders enroll the tables 
+   * in the open transaction before appending.
+   *
+   * Example.
+   * ```cpp
+   * SQLite3DB db = make_database(":memory:");
+   * ColumnarEventStore::attach(db);
+   *
+   * HepMC2DataLoader loader(db);
+   * PVFinder pv_finder(db);
+   * ...
+   * ```
+   *
+   * Limitations:
+   *  - the virtual tables are visible only to the connection they are
+   *    attached to. Other connections, for example those obtained with
+   *    `SQLite3DB.connect()` in Python, would access the (empty) tables of
+   *    the `main` schema;
+   *  - the identifiers of the rows cannot be modified with UPDATE;
+   *  - the store is destroyed with the connection, hence it must be attached
+   *    again after UpdateDBConnection.
+   */
+  class ColumnarEventStore
+  {
+    public:
+      /// Constructor
+      ColumnarEventStore ();
+
+      /// Table of the generator-level particles
+      ColumnarTable& particles () { return m_particles; }
+
+      /// Table of the generator-level vertices
+      ColumnarTable& vertices () { return m_vertices; }
+
+      /// Table by SQL name, nullptr if not defined
+      ColumnarTable* table (const std::string& name);
+
+      /// Create the store for a connection and the virtual tables
+      /// `temp.GenParticles` and `temp.GenVertices`. The store is owned by
+      /// the connection. If a store was already attached, it is returned.
+      static ColumnarEventStore* attach (SQLite3DB& db);
+
+      /// Store attached to a connection, nullptr if none
+      static ColumnarEventStore* get (sqlite3* db);
+
+      /// Counter incremented each time a store is attached or destroyed,
+      /// enabling caching the result of `get()`
+      static unsigned int generation ();
+
+    private:
+      ColumnarTable m_particles;
+      ColumnarTable m_vertices;
+  };
+}
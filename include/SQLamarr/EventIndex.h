@@ -0,0 +1,65 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace SQLamarr
+{
+  /** Byte offsets of the events in an ASCII HepMC file.
+   *
+   * Events are identified, in both the HepMC2 and HepMC3 ASCII formats,
+   * by the lines starting with `E `. Scanning a large file for these lines
+   * is much cheaper than parsing it, but still requires reading it all,
+   * hence the index is cached in a file named as the input file followed
+   * by `.idx` (see cache_path()). The cache is used as long as the size and
+   * the modification time of the input file are unchanged, and is rebuilt
+   * otherwise. Failing to write the cache (e.g. in read-only directories)
+   * is not an error.
+   *
+   * Compressed files cannot be indexed.
+   */
+  class EventIndex
+  {
+    public:
+      /// Read the index of a file from the cache, or build and cache it
+      EventIndex (const std::string& file_path);
+
+      /// Number of events in the file
+      size_t n_events () const { return m_offsets.size() - 1; }
+
+      /// Offset of the `event`-th event (0-based). For events beyond the 
+      /// last one, the offset of the end of the event listing.
+      uint64_t offset (size_t event) const
+      { return m_offsets[std::min(event, n_events())]; }
+
+      /// True if the index was read from the cache
+      bool cached () const { return m_cached; }
+
+      /// Path to the cache of the index of a file
+      static std::string cache_path (const std::string& file_path)
+      { return file_path + ".idx"; }
+
+    private:
+      bool read_cache (const std::string& file_path);
+      void build (const std::string& file_path);
+      void write_cache (const std::string& file_path) const;
+
+    private:
+      std::vector<uint64_t> m_offsets;  ///< One entry more than the events
+      uint64_t m_file_size;
+      int64_t m_file_mtime;
+      bool m_cached;
+  };
+}
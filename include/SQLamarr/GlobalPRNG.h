@@ -114,7 +114,7 @@ namespace SQLamarr
       {
         // Gets the singleton handle
         T_GlobalPRNG& h {T_GlobalPRNG::handle()};
-        std::lock_guard<std::mutex>(h.m_mutex); // Forbids multithreading
+        std::lock_guard<std::mutex> lock(h.m_mutex); // Forbids multithreading
 
         // Looks for the DB in the hash table
         auto gen_it = h.m_generators.find(db);
@@ -157,7 +157,7 @@ namespace SQLamarr
       static bool release (const sqlite3* db)
       {
         T_GlobalPRNG& h {T_GlobalPRNG::handle()};
-        std::lock_guard<std::mutex>(h.m_mutex); // Forbids multithreading
+        std::lock_guard<std::mutex> lock(h.m_mutex); // Forbids multithreading
 
         auto it = h.m_generators.find(db);
         bool releasing_unexisting = (it == h.m_generators.end());
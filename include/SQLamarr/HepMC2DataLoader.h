@@ -8,6 +8,8 @@
 // or submit itself to any jurisdiction.
 
 
+#pragma once
+
 // STL
 #include <string>
 #include <unordered_map>
@@ -42,6 +44,8 @@ namespace SQLamarr
   HepMC2DataLoader assumes each of the `GenEvent` instances in the input 
   file represent a collision in the same, single, event.
 
+  Gzip-compressed files are decompressed on the fly.
+
   The `HepMC2DataLoader::load` function can be called multiple times 
   passing the path of new file, and the corresponding run and event number, 
   as arguments.
@@ -59,6 +63,16 @@ namespace SQLamarr
     loader.load(file_path, runNumber, evtNumber++);
   ```
 
+  Large files including many `GenEvent`s can be split among workers,
+  each loading a range of events:
+  ```cpp
+  loader.load(file_path, runNumber, evtNumber, worker_id * 100, 100);
+  ```
+
+  Samples processed multiple times can be converted once to the 
+  BinaryEventFormat with `convert_to_binary`, and then loaded with 
+  BinaryDataLoader skipping the parsing of the ASCII files.
+
   */
   class HepMC2DataLoader: public AbsDataLoader
   {
@@ -71,6 +85,30 @@ namespace SQLamarr
           const std::string& file_path, ///< Full path to the ASCII file
           size_t run_number,          ///< Unique identifier of the run 
           size_t evt_number           ///< Unique identifier of the event 
+          ) override;
+
+      /// Load the `GenEvent`s from `first_event` (0-based) to 
+      /// `first_event + max_events` (excluded) of a file as an event.
+      /// Uncompressed files are indexed at the first call (see EventIndex)
+      /// to reach the first event without parsing the previous ones.
+      void load (
+          const std::string& file_path, ///< Full path to the input file
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t evt_number,          ///< Unique identifier of the event 
+          size_t first_event,         ///< Index of the first `GenEvent`
+          size_t max_events = all_events ///< Maximum `GenEvent`s to load
           );
+
+      /// Parse an ASCII file once and write its content in the 
+      /// BinaryEventFormat, to be loaded with BinaryDataLoader
+      static void convert_to_binary (
+          const std::string& file_path,   ///< Full path to the ASCII file
+          const std::string& output_path  ///< Path to the binary file
+          );
+
+    protected:
+      /// Loader writing to another database, used by `load_many`
+      std::unique_ptr<AbsDataLoader> clone (SQLite3DB& db) const override
+      { return std::unique_ptr<AbsDataLoader>(new HepMC2DataLoader(db)); }
   };
 }
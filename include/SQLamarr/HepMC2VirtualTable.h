@@ -0,0 +1,82 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <string>
+
+// SQLite3
+#include "sqlite3.h"
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+
+namespace SQLamarr
+{
+  /** Read-only view of an HepMC2 ASCII file as SQL tables.
+   *
+   * The `sqlamarr_hepmc2` module exposes the events, vertices and particles
+   * of a file as virtual tables with the same columns as `GenEvents`,
+   * `GenVertices` and `GenParticles`, respectively.
+   * The events are parsed only when a query reaches them: the first access
+   * to an event records the position of the events preceding it in the
+   * file, without parsing them, and the last parsed events are cached and
+   * shared by all the tables reading the same file.
+   *
+   * Constraints on `genevent_id` (equality and ranges) and on the identifier
+   * of the rows are used to parse only the selected events, so that queries
+   * involving a subset of the events do not pay for loading the whole file
+   * in the event store.
+   *
+   * Example.
+   * ```sql
+   * CREATE VIRTUAL TABLE temp.FileParticles
+   *   USING sqlamarr_hepmc2('path/to/file.mc2', GenParticles);
+   *
+   * INSERT INTO MCParticles (genparticle_id, genevent_id, pid, pe, px, py, pz)
+   *   SELECT genparticle_id, genevent_id, pid, pe, px, py, pz
+   *   FROM temp.FileParticles
+   *   WHERE genevent_id BETWEEN 10 AND 20 AND status = 1;
+   * ```
+   *
+   * The identifiers are not assigned by the event store, but encoded from
+   * the position of the rows in the file:
+   *  - `genevent_id` is the index of the event in the file, starting from 1;
+   *  - `genvertex_id` and `genparticle_id` are obtained with make_id()
+   *    from the `genevent_id` and from the (1-based) index of the vertex
+   *    or particle in the event. The `production_vertex` and `end_vertex`
+   *    columns of the particles refer to the vertices with the same encoding.
+   *
+   * The tables cannot be modified, hence the transformers updating
+   * `GenVertices` (e.g. PVFinder) must run on a copy of the rows loaded into
+   * the event store.
+   */
+  class HepMC2VirtualTable
+  {
+    public:
+      /// Number of bits of the identifiers reserved to the index of the row
+      static const int row_bits = 24;
+
+      /// Identifier of the `row`-th vertex or particle (1-based) of an event
+      static sqlite3_int64 make_id (sqlite3_int64 genevent_id, int row)
+      { return (genevent_id << row_bits) | row; }
+
+      /// Register the `sqlamarr_hepmc2` module on a connection, if needed
+      static void register_module (SQLite3DB& db);
+
+      /// Create the virtual tables `<prefix>Events`, `<prefix>Vertices`
+      /// and `<prefix>Particles` in the `temp` schema, reading `file_path`
+      static void attach (
+          SQLite3DB& db,                  ///< Reference to the database
+          const std::string& file_path,   ///< Path to the HepMC2 ASCII file
+          const std::string& prefix = "HepMC" ///< Prefix of the table names
+          );
+  };
+}
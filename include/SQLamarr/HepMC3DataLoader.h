@@ -0,0 +1,71 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <memory>
+#include <string>
+
+// HepMC3
+#include "HepMC3/ReaderAscii.h"
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/AbsDataLoader.h"
+
+namespace SQLamarr
+{
+  /** `AbsDataLoader` implementation for the native Ascii format of HepMC3.
+
+  The input files are read with `HepMC3::ReaderAscii`, as written by
+  `HepMC3::WriterAscii`. As for HepMC2DataLoader, each `GenEvent` in the 
+  file is loaded as a collision of the same event, and gzip-compressed files
+  are decompressed on the fly, avoiding decompressing them to disk.
+
+  For example,
+  ```cpp
+  SQLite3DB db = make_database(":memory:");
+  HepMC3DataLoader loader (db);
+
+  for (auto input_file: {"my_event_1.hepmc3.gz", "my_event_2.hepmc3.gz"})
+    loader.load(input_file, runNumber, evtNumber++);
+  ```
+  */
+  class HepMC3DataLoader: public AbsDataLoader
+  {
+    public:
+      using AbsDataLoader::AbsDataLoader;
+
+      /// Load an event (possibly including multiple `GenEvent`s) from an 
+      /// Ascii file in the HepMC3 format, possibly gzip-compressed
+      void load (
+          const std::string& file_path, ///< Full path to the input file
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t evt_number           ///< Unique identifier of the event 
+          ) override;
+
+      /// Load the `GenEvent`s from `first_event` (0-based) to 
+      /// `first_event + max_events` (excluded) of a file as an event.
+      /// Uncompressed files are indexed at the first call (see EventIndex)
+      /// to reach the first event without parsing the previous ones.
+      void load (
+          const std::string& file_path, ///< Full path to the input file
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t evt_number,          ///< Unique identifier of the event 
+          size_t first_event,         ///< Index of the first `GenEvent`
+          size_t max_events = all_events ///< Maximum `GenEvent`s to load
+          );
+
+    protected:
+      /// Loader writing to another database, used by `load_many`
+      std::unique_ptr<AbsDataLoader> clone (SQLite3DB& db) const override
+      { return std::unique_ptr<AbsDataLoader>(new HepMC3DataLoader(db)); }
+  };
+}
@@ -43,6 +43,9 @@ namespace SQLamarr
 
     More advanced or branched selection criteria can be defined by 
     inheriting from this class and overriding the `keep` method.
+
+    In incremental mode (see BaseSqlInterface::set_incremental), only the 
+    `GenEvent`s loaded after the previous execution are processed.
   */
   class MCParticleSelector: public BaseSqlInterface, public Transformer
   {
@@ -0,0 +1,149 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include <string>
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/BaseSqlInterface.h"
+#include "SQLamarr/Transformer.h"
+
+namespace SQLamarr
+{
+  /// Several dynamically linked parametrizations evaluated on the rows of
+  /// a single query.
+  ///
+  /// Parametrizations sharing their inputs (for example the acceptance and
+  /// the efficiency of the tracking) can be evaluated with a single
+  /// execution of the SELECT statement, instead of running the same query,
+  /// with its joins and SQL functions, once per `Plugin`.
+  ///
+  /// Each model added with `add_model()` is a function linked from a
+  /// shared object, with the signature of `Plugin`
+  /// (`float* (float*, const float*)`) or, if `n_random > 0`, of
+  /// `GenerativePlugin` (`float* (float*, const float*, const float*)`).
+  /// By default, a model takes as an input all the selected columns not
+  /// listed as reference keys, in the order of the query; alternatively,
+  /// the input columns can be selected by name.
+  ///
+  /// The outputs of each model are written, together with the reference
+  /// keys, to a temporary table, which is overwritten at each execution.
+  /// Models sharing the name of the output table are written to a single
+  /// wide table, with the columns in the order the models were added.
+  ///
+  /// Rows can be routed to different models according to the value of a
+  /// selection column (for example, the particle species), set with
+  /// `set_selection()`. Models restricted to disjoint sets of values and
+  /// writing the same outputs to the same table share its columns, so
+  /// that a single table collects the outputs of all the species.
+  /// Outputs of the models not evaluated on a row are NULL, and no row
+  /// is written to a table if none of its models was evaluated.
+  ///
+  /// Example.
+  /// ```cpp
+  /// MultiModelPlugin tracking(db, select_query, {"mcparticle_id"});
+  /// tracking.add_model(library, "acceptance", "tmp_acceptance_out",
+  ///                    {"acceptance"});
+  /// tracking.add_model(library, "efficiency", "tmp_efficiency_out",
+  ///                    {"not_recoed", "long", "upstream", "downstream"});
+  /// tracking.execute();
+  /// ```
+  ///
+  class MultiModelPlugin: public BaseSqlInterface, public Transformer
+  {
+    public:
+      /// Constructor
+      MultiModelPlugin (
+          SQLite3DB& db,
+            ///< Reference to the database, passed without ownership
+          const std::string& select_query,
+            ///< SQL Query selecting the reference keys and the inputs
+          const std::vector<std::string> reference_keys = {"ref_id"}
+            ///< Columns copied to the output tables, not used as inputs
+          );
+
+      MultiModelPlugin (MultiModelPlugin&) = delete;
+
+      /// Release the linked libraries
+      virtual ~MultiModelPlugin();
+
+      /// Add a parametrization, evaluated on each row of the query.
+      /// Models should be added before the first execution, since the
+      /// existing output tables are not modified.
+      void add_model (
+          const std::string& library,
+            ///< Path to the shared object (library). If in CWD, prepend "./".
+          const std::string& function_name,
+            ///< Linking symbol of the target function as set at compile-time
+          const std::string& output_table,
+            ///< SQL name of the output table. Must be alphanumeric.
+          const std::vector<std::string>& outputs,
+            ///< Column names of the outputs of the parametrization
+          unsigned int n_random = 0,
+            ///< Size of the normally distributed random input (generative
+            ///  models), or 0
+          const std::vector<std::string>& inputs = {},
+            ///< Columns of the query used as inputs, in order. If empty,
+            ///  all the columns not listed as reference keys, nor used as
+            ///  selection column.
+          const std::vector<int64_t>& selected_values = {}
+            ///< Values of the selection column of the rows the model is
+            ///  evaluated on. If empty, all the rows.
+          );
+
+      /// Define the column of the query routing the rows to the models
+      void set_selection (
+          const std::string& column
+            ///< Name of an integer column selected by the query
+          );
+
+      /// Execute the query once, evaluating all the models on each row
+      void execute () override;
+
+    private: // types
+      typedef float *(*mlfunc)(float *, const float*);
+      typedef float *(*genfunc)(float *, const float*, const float*);
+
+      struct Model
+      {
+        void* function;                   ///< Symbol loaded from the library
+        unsigned int n_random;            ///< Size of the random input
+        std::vector<std::string> inputs;  ///< Input columns, all if empty
+        std::vector<int64_t> selected_values; ///< Routed rows, all if empty
+        size_t table;                     ///< Index of the output table
+        size_t first_output;              ///< First output column in table
+        size_t n_outputs;                 ///< Number of outputs
+      };
+
+      struct OutputTable
+      {
+        std::string name;
+        std::vector<std::string> outputs;
+      };
+
+    private: // members
+      const std::string m_select_query;
+      const std::vector<std::string> m_refkeys;
+      std::string m_selection;
+      std::map<std::string, void*> m_handles;
+      std::vector<Model> m_models;
+      std::vector<OutputTable> m_tables;
+
+    private: // methods
+      std::string compose_create_query (const OutputTable& table) const;
+      std::string compose_insert_query (const OutputTable& table) const;
+  };
+}
@@ -36,6 +36,12 @@ namespace SQLamarr
       The value of the HepMC status identifying signal particles depends 
       may depend on the generator and is defined as argument of the 
       constructor.
+
+      In incremental mode (see BaseSqlInterface::set_incremental), only 
+      the `GenEvent`s loaded after the previous execution are processed, 
+      so that the cost of each execution scales with the batch just loaded
+      rather than with the size of the event store. Otherwise, all the 
+      `GenEvent`s in the store are processed at each execution.
   */ 
   class PVFinder: public BaseSqlInterface, public Transformer
   {
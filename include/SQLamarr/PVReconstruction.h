@@ -47,6 +47,10 @@ namespace SQLamarr
      - `sigma1`, the standard deviation of the first Gaussian 
      - `sigma2`, the standard deviation of the second Gaussian 
      - `sigma3`, the standard deviation of the third Gaussian 
+
+    In incremental mode (see BaseSqlInterface::set_incremental), only the 
+    primary vertices of the `GenEvent`s loaded after the previous execution 
+    are reconstructed.
     */
   class PVReconstruction: public BaseSqlInterface, public Transformer
   {
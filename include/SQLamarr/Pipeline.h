@@ -0,0 +1,332 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/BaseSqlInterface.h"
+#include "SQLamarr/Transformer.h"
+#include "SQLamarr/AbsDataLoader.h"
+
+namespace SQLamarr
+{
+  /// Performance counters of a Transformer, accumulated across executions
+  struct TransformerStats
+  {
+    std::string name;             ///< Demangled class name of the Transformer
+    uint64_t calls;               ///< Number of executions
+    double wall_time;             ///< Elapsed time in seconds
+    double cpu_time;              ///< Processor time in seconds
+    int64_t rows_changed;         ///< Rows inserted, updated or deleted
+    uint64_t rows_returned;       ///< Rows returned by SELECT statements
+    uint64_t statements_prepared; ///< SQL statements compiled
+    int64_t cache_hits;           ///< SQLite page cache hits
+    int64_t cache_misses;         ///< SQLite page cache misses
+  };
+
+  /** Sequence of Transformers executed in an event loop run in C++.
+   *
+   * The Pipeline is configured once with the list of algorithms (and 
+   * optionally a data loader), and then executed multiple times without
+   * returning the control to the caller between events. 
+   * This avoids the overhead of crossing the language boundary and of 
+   * re-preparing the SQL statements for each event when SQLamarr is 
+   * steered from Python.
+   *
+   * Algorithms and data loader are not owned by the Pipeline and must
+   * outlive it.
+   *
+   * Example.
+   * ```cpp
+   * SQLite3DB db = make_database(":memory:");
+   * HepMC2DataLoader loader(db);
+   * PVFinder pv_finder(db);
+   * MCParticleSelector mcps(db);
+   * CleanEventStore clean(db);
+   *
+   * Pipeline pipeline({&pv_finder, &mcps, &clean}, &loader);
+   * pipeline.execute_over_files(input_files, runNumber);
+   * ```
+   *
+   * Optionally, the Pipeline accumulates per-transformer performance 
+   * counters (see TransformerStats) that can be exported to a table 
+   * of the database to identify the steps worth optimizing.
+   * ```cpp
+   * pipeline.set_instrumentation(true);
+   * pipeline.execute_over_files(input_files, runNumber);
+   * pipeline.export_stats(db, "PipelineStats");
+   * ```
+   *
+   * Similarly, the statements cached by the algorithms and by the data loader
+   * can be profiled (see BaseSqlInterface::set_profiling) and their counters
+   * and query plans exported to a table.
+   * ```cpp
+   * pipeline.set_profiling(true);
+   * pipeline.execute_over_files(input_files, runNumber);
+   * pipeline.export_profiles(db, "QueryProfiles");
+   * ```
+   *
+   * By default, each algorithm commits its own work (or runs in autocommit).
+   * With a file-backed database, the transaction policy can group the 
+   * updates of a whole batch (the data loaded from one file, or one 
+   * execution of the sequence), or of several batches, in a single
+   * transaction, sparing the disk synchronizations of the intermediate 
+   * commits. The transactions opened by the algorithms become savepoints 
+   * of the one opened by the Pipeline (see 
+   * BaseSqlInterface::begin_transaction).
+   * ```cpp
+   * pipeline.set_transaction_policy(Pipeline::PerNBatches, 100);
+   * pipeline.execute_over_files(input_files, runNumber);
+   * ```
+   * The pipeline transaction is committed at the latest when `execute()` or
+   * `execute_over_files()` returns, and before running an algorithm 
+   * updating the database connection. It is opened on the connection 
+   * of the data loader, or of the first algorithm if none, 
+   * hence all the algorithms are expected to share that connection.
+   * If an algorithm raises, the batches of the open pipeline transaction
+   * are rolled back, while those already committed are preserved.
+   *
+   * When the database is in write-ahead log mode (see enable_wal_mode), 
+   * concurrent readers see the data as of the last committed transaction.
+   * The log can be checkpointed on batch boundaries, after the 
+   * transaction is committed, rather than by the automatic checkpoints
+   * of SQLite, which run on the commits of the algorithms.
+   * ```cpp
+   * enable_wal_mode(db, 0);
+   * pipeline.set_transaction_policy(Pipeline::PerBatch);
+   * pipeline.set_checkpoint_interval(100);
+   * pipeline.execute_over_files(input_files, runNumber);
+   * ```
+   *
+   * The algorithms can be scheduled by their dependencies, as inferred 
+   * from the tables read and written by their statements (see
+   * BaseSqlInterface::tables_read). The first execution runs the 
+   * sequence in order to discover them; then, the algorithms are grouped 
+   * in stages, each algorithm being placed after all those preceding it 
+   * in the sequence and writing a table it accesses, or accessing a table
+   * it writes. Algorithms that are not BaseSqlInterface, or that update 
+   * the database connection, depend on all the others. 
+   * Within a stage, the algorithms bound to different connections (for
+   * example, to a database file in WAL mode, see enable_wal_mode) run
+   * concurrently, up to `n_threads` at a time, while those sharing a 
+   * connection run one after the other, as SQLite serializes the 
+   * operations of a connection.
+   * The tables are recorded with BaseSqlInterface::set_table_tracking, 
+   * enabled on the algorithms and on the data loader when `n_threads > 1`
+   * or when skipping the unchanged algorithms: no other authorizer should
+   * be set on their connections.
+   * Concurrent writers still wait for each other's commit: the connections
+   * are configured to wait up to one minute for the locks held by others.
+   * ```cpp
+   * pipeline.set_n_threads(4);
+   * pipeline.execute_over_files(input_files, runNumber);
+   * ```
+   *
+   * Optionally, the algorithms whose tables have not been modified since 
+   * their last execution, by the data loader or by the other algorithms 
+   * of the Pipeline, are skipped. Modifications through the connections 
+   * of the algorithms between two executions mark all the tables as 
+   * changed, while those made through other connections must be
+   * notified with `mark_changed()`.
+   * ```cpp
+   * pipeline.set_skip_unchanged(true);
+   * pipeline.execute(10); // the algorithms run once
+   * ```
+   */
+  class Pipeline
+  {
+    public:
+      /// Granularity of the transactions committing the database updates
+      enum TransactionPolicy
+      {
+        PerTransformer, ///< Transactions (if any) managed by the algorithms
+        PerBatch,       ///< One transaction per batch
+        PerNBatches     ///< One transaction every `n_batches` batches
+      };
+
+    public:
+      /// Constructor
+      Pipeline (
+          const std::vector<Transformer*>& algorithms,
+            ///< Sequence of algorithms (not owned)
+          AbsDataLoader* loader = nullptr
+            ///< Data loader used by execute_over_files (not owned)
+          );
+
+      /// Execute the sequence of algorithms `n_times` times 
+      void execute (size_t n_times = 1);
+
+      /// Load each file with the data loader, running the sequence of 
+      /// algorithms after each of them. 
+      void execute_over_files (
+          const std::vector<std::string>& file_paths, 
+            ///< Paths to the input files, one per event
+          size_t run_number,
+            ///< Run number for the loaded events
+          size_t first_evt_number = 0
+            ///< Event number of the first file, incremented for each file
+          );
+
+      /// Finalize the statements cached by the algorithms and the data loader,
+      /// enabling a safe refresh of the database connection
+      void invalidate_cache ();
+
+      /// Reset the statements cached by the algorithms and the data loader,
+      /// releasing the locks they may hold on the tables
+      void reset_statements ();
+
+      /// Index of the algorithm being executed, or of the one that failed 
+      /// if an exception was raised. -1 if the data loader was running.
+      int current_algorithm () const { return m_current_algorithm; }
+
+      /// Enable or disable the collection of the performance counters
+      void set_instrumentation (bool enabled) { m_instrumented = enabled; }
+
+      /// Set the granularity of the transactions (PerTransformer by default)
+      void set_transaction_policy (
+          TransactionPolicy policy,   ///< Transaction granularity
+          size_t n_batches = 1        ///< Batches per transaction (PerNBatches)
+          );
+
+      /// Checkpoint the write-ahead log every `n_batches` batches, or never
+      /// if 0 (default). Checkpoints are passive, never waiting for readers.
+      void set_checkpoint_interval (size_t n_batches) 
+      { m_checkpoint_interval = n_batches; }
+
+      /// Run the independent algorithms of each stage on up to `n_threads`
+      /// threads; 1 (default) runs the sequence in order. Concurrency 
+      /// requires the PerTransformer transaction policy.
+      void set_n_threads (unsigned int n_threads);
+
+      /// Skip the algorithms whose tables did not change since their 
+      /// last execution
+      void set_skip_unchanged (bool enabled);
+
+      /// Mark a table (or all the tables, if empty) as modified, forcing 
+      /// the execution of the algorithms accessing it
+      void mark_changed (const std::string& table = std::string());
+
+      /// Indices of the algorithms in each stage of the schedule, 
+      /// empty until the first concurrent execution
+      const std::vector<std::vector<int> >& stages () const 
+      { return m_stages; }
+
+      /// Performance counters, one entry per algorithm
+      const std::vector<TransformerStats>& stats () const { return m_stats; }
+
+      /// Reset the performance counters to zero
+      void reset_stats ();
+
+      /// Write the performance counters to a table
+      void export_stats (
+          SQLite3DB& db,            ///< Reference to the database
+          const std::string& table, ///< Name of the output table
+          bool append = false,      ///< If false, replace the table content
+          int first_algorithm = 0   ///< Index of the first algorithm
+          ) const;
+
+      /// Enable or disable the profiling of the SQL statements of the 
+      /// algorithms and of the data loader
+      void set_profiling (bool enabled);
+
+      /// Write the profiles of the SQL statements to a table
+      void export_profiles (
+          SQLite3DB& db,            ///< Reference to the database
+          const std::string& table, ///< Name of the output table
+          bool append = false       ///< If false, replace the table content
+          );
+
+    private: // methods
+      /// Connection of the data loader, or of the first algorithm if none
+      sqlite3* connection () const;
+
+      /// Run the sequence of algorithms once
+      void execute_once ();
+
+      /// Run an algorithm, unless skipped as unchanged
+      void execute_algorithm (int iAlg);
+
+      /// Run an algorithm updating its performance counters
+      void execute_instrumented (int iAlg);
+
+      /// Run the algorithms of a stage, concurrently if on distinct 
+      /// connections
+      void execute_stage (const std::vector<int>& stage);
+
+      /// Group the algorithms in stages, according to their dependencies
+      void build_stages ();
+
+      /// Number of statements compiled by the algorithms, which may have
+      /// extended the tables they access
+      uint64_t n_statements_prepared () const;
+
+      /// True if no table accessed by the algorithm changed since its
+      /// last execution
+      bool unchanged (int iAlg);
+
+      /// Mark the tables written by an algorithm (or by the data loader,
+      /// if -1) as changed
+      void record_execution (int iAlg);
+
+      /// Store the number of rows modified through the connections of the
+      /// algorithms, marking all the tables as changed if `mark` is true 
+      /// and the database was modified since the previous call
+      void check_external_changes (bool mark);
+
+      /// Open the pipeline transaction, if required by the policy
+      void begin_batch ();
+
+      /// Commit the pipeline transaction, if required by the policy
+      void end_batch ();
+
+      /// Commit the pipeline transaction, if open
+      void commit_transaction ();
+
+      /// Record the tables accessed by the algorithms and the data loader,
+      /// to schedule them or to skip them
+      void enable_table_tracking ();
+
+      /// Discard the updates of the pipeline transaction, if open, and 
+      /// the transactions left open by the algorithms
+      void rollback_transaction ();
+
+    private: // members
+      const std::vector<Transformer*> m_algorithms;
+      std::vector<BaseSqlInterface*> m_sql_interfaces;
+      std::vector<bool> m_updates_connection;
+      AbsDataLoader* m_loader;
+      int m_current_algorithm;
+      bool m_instrumented;
+      std::vector<TransformerStats> m_stats;
+      TransactionPolicy m_transaction_policy;
+      size_t m_batches_per_transaction;
+      size_t m_batches_in_transaction;
+      sqlite3* m_transaction_db;
+      size_t m_checkpoint_interval;
+      size_t m_batches_since_checkpoint;
+      unsigned int m_n_threads;
+      std::vector<std::vector<int> > m_stages;
+      uint64_t m_stages_statements;
+      bool m_skip_unchanged;
+      std::mutex m_changes_mutex;
+      uint64_t m_n_changes;
+      uint64_t m_all_changed;
+      std::map<std::string, uint64_t> m_table_changes;
+      std::vector<uint64_t> m_last_execution;
+      std::map<sqlite3*, int64_t> m_total_changes;
+  };
+}
@@ -0,0 +1,108 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <string>
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/AbsDataLoader.h"
+#include "SQLamarr/preprocessor_symbols.h"
+
+namespace SQLamarr
+{
+  /** `AbsDataLoader` implementation generating synthetic events.
+
+  SyntheticDataLoader writes randomly generated decay trees directly into 
+  the event store, without any file I/O. It is intended for load and 
+  scaling tests of the transformers, for example at pile-up levels 
+  for which no generator-level sample is available.
+
+  Each event includes a Poisson-distributed number of collisions 
+  (pile-up), each with a primary vertex produced by two beam protons and 
+  a Poisson-distributed number of particles produced at the primary vertex. 
+  Each particle decays with a given probability in a fixed number of 
+  daughters, which may decay in turn until the maximum depth of the tree 
+  is reached. If requested, the first decaying particle of the first 
+  collision is flagged with the signal status code.
+
+  Random numbers are drawn from the generator associated to the database
+  by GlobalPRNG, which must be seeded.
+
+  For example,
+  ```cpp
+  SQLite3DB db = make_database(":memory:");
+  GlobalPRNG::get_or_create(db.get(), 42);
+
+  SyntheticDataLoader::Config config;
+  config.pileup = 7.6;
+  SyntheticDataLoader loader (db, config);
+
+  for (size_t evtNumber = 0; evtNumber < 100; ++evtNumber)
+    loader.load("synthetic", runNumber, evtNumber);
+  ```
+  */
+  class SyntheticDataLoader: public AbsDataLoader
+  {
+    public:
+      /// Parameters of the generated events
+      struct Config 
+      {
+        /// Mean number of collisions per event
+        double pileup = 5.5;
+
+        /// Mean number of particles produced at each primary vertex
+        double multiplicity = 100.;
+
+        /// Maximum number of generations in the decay trees
+        unsigned int max_depth = 3;
+
+        /// Probability for a particle to decay, if `max_depth` allows
+        double decay_probability = 0.1;
+
+        /// Number of daughters of each decay
+        unsigned int n_daughters = 2;
+
+        /// Whether to flag a decaying particle per event as signal
+        bool with_signal = true;
+
+        int beam_status = 4;  ///< Status code of the colliding protons
+        int stable_status = LAMARR_LHCB_STABLE_IN_PRODGEN; ///< Status of stable particles
+        int decayed_status = LAMARR_LHCB_DECAYED_BY_PRODGEN; ///< Status of decayed particles
+        int signal_status = LAMARR_LHCB_SIGNAL_IN_LAB_FRAME; ///< Status of the signal
+      };
+
+      /// Constructor with default parameters
+      SyntheticDataLoader (
+          SQLite3DB& db                     ///< Reference to the database
+          );
+
+      /// Constructor
+      SyntheticDataLoader (
+          SQLite3DB& db,                    ///< Reference to the database
+          const Config& config              ///< Parameters of the events
+          );
+
+      /// Generate an event and store it in the database. 
+      void load (
+          const std::string& data_source, ///< Label of the data source
+          size_t run_number,          ///< Unique identifier of the run 
+          size_t evt_number           ///< Unique identifier of the event 
+          ) override;
+
+    private: // members
+      const Config m_config;
+
+    private: // methods
+      /// Generate a collision and its decay trees
+      void generate_collision (int datasource_id, int collision, bool signal);
+  };
+}
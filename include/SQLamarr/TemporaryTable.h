@@ -46,6 +46,40 @@ namespace SQLamarr
   some_parts.execute();
   ```
 
+  The materialization strategy (see `set_materialization()`) avoids 
+  copying intermediate results read only once, or re-processing the 
+  events already processed:
+   * `Copy` (default): the table content is replaced at each execution
+     (`DELETE` and `INSERT ... SELECT`);
+   * `View`: a view is created at the first execution, and its query is 
+     evaluated by the consumers, each time they read it. Not suited to 
+     queries involving random numbers, or read by multiple consumers.
+     Persistent views cannot refer to temporary tables;
+   * `Recreate`: the table is dropped and created again with 
+     `CREATE TABLE ... AS SELECT`, releasing its pages at each execution;
+   * `Incremental`: the rows of the events loaded since the previous 
+     execution (see `BaseSqlInterface::genevent_range()`) are appended to 
+     the table. The queries must restrict their output to the events with
+     `genevent_id` between the `:first_genevent_id` and `:last_genevent_id` 
+     parameters. The incremental mode must be enabled with 
+     `set_incremental(true)`, otherwise the table is filled again with all
+     the events at each execution.
+
+  When the strategy is not `Copy`, tables or views with the same name as
+  the output table are dropped at the first execution.
+
+  Example.
+  ```cpp
+  SQLamarr::TemporaryTable new_tracks(db,
+    "tracks", {"mcparticle_id", "pz"},
+    "SELECT mcparticle_id, pz FROM MCParticles AS p "
+    "INNER JOIN MCVertices AS v ON p.production_vertex = v.mcvertex_id "
+    "WHERE v.genevent_id BETWEEN :first_genevent_id AND :last_genevent_id"
+    );
+  new_tracks.set_materialization(SQLamarr::TemporaryTable::Incremental);
+  new_tracks.set_incremental(true);
+  ```
+
   See also:
    * `SQLamarr::Plugin` creating temporary tables based on an external lib
    * `SQLamarr::GenerativePlugin` creating a temporary table with random numbers
@@ -53,6 +87,10 @@ namespace SQLamarr
   */
   class TemporaryTable: public BaseSqlInterface, public Transformer
   {
+    public:
+      /// Strategy used to materialize the output table
+      enum Materialization { Copy, View, Recreate, Incremental };
+
     public:
       /// Define the operations to define to create the temp table
       TemporaryTable (
@@ -90,6 +128,12 @@ namespace SQLamarr
       /// Execute the SQL statements creating and populating the temp table
       void execute () override;
 
+      /// Set the materialization strategy (`Copy` by default)
+      void set_materialization (Materialization strategy);
+
+      /// Materialization strategy
+      Materialization materialization () const { return m_materialization; }
+
     private:
       // Name of the output temporary table
       const std::string m_output_table;
@@ -104,6 +148,13 @@ namespace SQLamarr
       std::string compose_create_query() const;
       std::string compose_delete_query() const;
       std::string compose_insert_query(const std::string& st) const;
+      std::string compose_union_query() const;
+      void drop_existing();
+      void execute_view();
+      void execute_recreate();
+      void execute_incremental();
       bool m_make_persistent;
+      Materialization m_materialization;
+      bool m_drop_existing;
   };
 }
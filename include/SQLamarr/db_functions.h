@@ -34,9 +34,39 @@ namespace SQLamarr
   /// Read a column field from a sqlite3 statement and convert it to float
   float read_as_float(sqlite3_stmt*, int);
 
+  /// Conservative integer lower bound of a value compared with `>=` 
+  /// (or `>` if `strict`) in a constraint of a virtual table.
+  /// Returns false if no row can satisfy the constraint (NULL value).
+  bool lower_bound_of (sqlite3_value* value, bool strict, sqlite3_int64& bound);
+
+  /// Conservative integer upper bound of a value compared with `<=` 
+  /// (or `<` if `strict`) in a constraint of a virtual table.
+  /// Returns false if no row can satisfy the constraint (NULL value).
+  bool upper_bound_of (sqlite3_value* value, bool strict, sqlite3_int64& bound);
+
   /// Ensure a token is alphanumeric
   void validate_token(const std::string& token);
 
+  /// Write the dirty pages of the connection cache to disk, without closing
+  /// the connection
+  void flush_database(SQLite3DB& db);
+
+  /// Switch a file-backed database to the write-ahead log journal, so that
+  /// other connections (possibly from other processes) read consistent 
+  /// snapshots of the committed data without blocking the writer.
+  /// `autocheckpoint` is the size of the log (in pages) triggering an 
+  /// automatic checkpoint on commit: 0 disables automatic checkpoints (see
+  /// checkpoint_database), negative values keep the SQLite default.
+  void enable_wal_mode (SQLite3DB& db, int autocheckpoint = -1);
+
+  /// Copy the content of the write-ahead log into the database file.
+  /// Returns false if the checkpoint could not complete, for example 
+  /// because of readers still using older snapshots.
+  bool checkpoint_database (
+      SQLite3DB& db, 
+      int mode = SQLITE_CHECKPOINT_PASSIVE  ///< `SQLITE_CHECKPOINT_*` mode
+      );
+
   /// Force synchronization to disk by closing and opening the connection
   void update_db_connection(
       SQLite3DB& old_db, 
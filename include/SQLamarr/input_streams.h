@@ -0,0 +1,34 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+#pragma once
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace SQLamarr
+{
+  /// Open a file for reading. Gzip-compressed files (identified by their
+  /// magic bytes, independently of the extension) are decompressed on the
+  /// fly. If the file cannot be opened, the returned stream is in a failed
+  /// state.
+  std::shared_ptr<std::istream> open_input_stream (const std::string& path);
+
+  /// Open an ASCII HepMC file for reading from its `first_event`-th event
+  /// (0-based). Uncompressed files are positioned at the requested event 
+  /// using their EventIndex, after the lines preceding the first event 
+  /// (the header and the run info), and `first_event` is set to zero. 
+  /// Otherwise, `first_event` is left unchanged and the events must be 
+  /// skipped by the reader.
+  std::shared_ptr<std::istream> open_input_stream (
+      const std::string& path,
+      size_t& first_event
+      );
+}
@@ -0,0 +1,60 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#pragma once
+
+// STL
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+
+namespace SQLamarr
+{
+  /** Concatenate the tables of several databases into `output`.
+   *
+   * Each input database is attached to the output connection and its tables
+   * are copied with a single `INSERT ... SELECT` per table, in a savepoint
+   * per input. Tables missing in the output are created with the definition
+   * found in the input.
+   *
+   * If a transaction is open on `output`, the merge is part of it, and a 
+   * failing input only rolls back its own rows. Since SQLite cannot detach
+   * a database read in an open transaction, the inputs remain attached 
+   * until a later merge, once the transaction has ended.
+   *
+   * The identifiers of the event store are shifted after the largest
+   * identifier ever assigned in the output, so that the references among
+   * the tables remain consistent. Shifted columns are those named as the
+   * primary keys of the event store (`datasource_id`, `genevent_id`,
+   * `genvertex_id`, `genparticle_id`, `mcvertex_id`, `mcparticle_id` and
+   * `vertex_id`), in any table, and the `production_vertex` and
+   * `end_vertex` columns of `GenParticles` and `MCParticles`.
+   * Integer primary keys of other tables are assigned again on insertion.
+   *
+   * For example, the output of independent jobs can be merged with
+   * ```cpp
+   * SQLite3DB db = make_database("merged.db");
+   * merge_databases(db, {"job1.db", "job2.db", "job3.db"});
+   * ```
+   * or with the `sqlamarr_merge` command.
+   *
+   * Returns the number of rows copied to each table.
+   */
+  std::map<std::string, uint64_t> merge_databases (
+      SQLite3DB& output,                      ///< Output database
+      const std::vector<std::string>& input_paths, ///< Paths (or URIs)
+      /// Tables to copy, all the tables of each input if empty. Tables
+      /// referenced by the copied ones should be copied as well.
+      const std::vector<std::string>& tables = std::vector<std::string>()
+      );
+}
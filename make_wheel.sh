@@ -1,7 +1,7 @@
 # docker run -it -v $PWD:/mylib quay.io/pypa/manylinux2014_x86_64:latest bash
 export PYBIN=/opt/python/cp37-cp37m/bin/python3
 yum check-updates 
-yum install -y HepMC3 HepMC3-devel
+yum install -y HepMC3 HepMC3-devel zlib-devel
 
 cd /mylib;
 rm -f wheelhouse/*.whl | echo "Ok";
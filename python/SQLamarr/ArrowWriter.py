@@ -0,0 +1,86 @@
+# (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+#
+# This software is distributed under the terms of the GNU General Public
+# Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+#
+# In applying this licence, CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization
+# or submit itself to any jurisdiction.
+
+import ctypes
+from SQLamarr import clib, c_TransformerPtr
+
+from SQLamarr.db_functions import SQLite3DB
+
+clib.new_ArrowWriter.argtypes = (
+    ctypes.c_void_p,        # void *db,
+    ctypes.c_char_p,        # const char* file_path,
+    ctypes.c_char_p,        # const char* query,
+    ctypes.c_size_t,        # size_t batch_size
+    )
+clib.new_ArrowWriter.restype = c_TransformerPtr
+
+clib.ArrowWriter_close.argtypes = (c_TransformerPtr,)
+clib.ArrowWriter_close.restype = ctypes.c_int
+
+class ArrowWriter:
+  """Appends the result of a query to a file in the Arrow IPC (Feather v2)
+  format, in record batches of fixed size.
+
+  Python binding of `SQLamarr::ArrowWriter`.
+
+  The file is completed by `close()`, or when the object is deleted, and
+  can then be read without copies from a memory map.
+
+  Example.
+  ```python
+  writer = SQLamarr.ArrowWriter(db, "particles.arrow",
+      "SELECT mcparticle_id, pid, px, py, pz FROM MCParticles")
+  pipeline = SQLamarr.Pipeline([pv_finder, mcps, writer, clean], loader=loader)
+  pipeline.execute_over_files(my_list_of_files, runNumber)
+  writer.close()
+
+  import pyarrow
+  table = pyarrow.ipc.open_file(pyarrow.memory_map("particles.arrow")).read_all()
+  ```
+  """
+
+  def __init__ (
+      self,
+      db: SQLite3DB,
+      file_path: str,
+      query: str,
+      batch_size: int = 65536,
+      ):
+    """
+    Acquires the reference to an open connection to the DB and configure the
+    Transformer.
+
+    @param db: An open database connection;
+    @param file_path: path to the output file, overwritten if existing;
+    @param query: SQL SELECT statement defining the columns of the file;
+    @param batch_size: number of rows of each record batch.
+    """
+    if batch_size <= 0:
+      raise ValueError("The batch size must be positive")
+
+    self._self = clib.new_ArrowWriter(
+        db.get(),
+        file_path.encode('utf-8'),
+        query.encode('ascii'),
+        batch_size,
+        )
+
+  def close(self):
+    """Write the pending rows and the footer, completing the file."""
+    if clib.ArrowWriter_close(self._self) != 0:
+      raise RuntimeError("Failed completing the Arrow file")
+
+  def __del__(self):
+    """@private: Release the bound class instance"""
+    clib.del_Transformer(self._self)
+
+  @property
+  def raw_pointer(self):
+    """@private: Return the raw pointer to the algorithm."""
+    return self._self
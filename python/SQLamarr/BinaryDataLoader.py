@@ -0,0 +1,104 @@
+# (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration. 
+#                                                                             
+# This software is distributed under the terms of the GNU General Public
+# Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+#                                                                             
+# In applying this licence, CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization  
+# or submit itself to any jurisdiction.
+
+import ctypes
+from typing import List
+import os
+from SQLamarr import clib
+
+from SQLamarr.db_functions import SQLite3DB
+
+clib.new_BinaryDataLoader.argtypes = (ctypes.c_void_p,)
+clib.new_BinaryDataLoader.restype = ctypes.c_void_p
+
+clib.del_BinaryDataLoader.argtypes = (ctypes.c_void_p,)
+
+clib.BinaryDataLoader_load.argtypes = (
+    ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t
+    ) 
+clib.BinaryDataLoader_load.restype = ctypes.c_int
+
+clib.AbsDataLoader_load_many.argtypes = (
+    ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_char_p), 
+    ctypes.c_size_t, ctypes.c_size_t, ctypes.c_uint
+    )
+clib.AbsDataLoader_load_many.restype = ctypes.c_int
+
+class BinaryDataLoader:
+  """
+  Data loader for the binary files written by 
+  `HepMC2DataLoader.convert_to_binary`.
+
+  Samples processed with many configurations can be parsed once and 
+  then loaded from the memory-mapped binary files, skipping the parsing of
+  the ASCII files.
+
+  Example.
+  ```python
+  for file in my_list_of_files:
+    SQLamarr.HepMC2DataLoader.convert_to_binary(file, file + ".bin")
+
+  db = SQLamarr.SQLite3DB()
+  data_loader = SQLamarr.BinaryDataLoader(db)
+  for iEvent, file in enumerate(my_list_of_files, 1):
+    data_loader.load(file + ".bin", runNumber, iEvent)
+    # ...do something...
+  ```
+  """
+  def __init__(self, db: SQLite3DB):
+    """Acquires the reference to an open connection to the DB"""
+    self._db = db
+    self._self = clib.new_BinaryDataLoader(self._db.get())
+
+  def __del__(self):
+    """@private: Release the bound class instance"""
+    clib.del_BinaryDataLoader(self._self)
+
+  @property
+  def raw_pointer(self):
+    """@private: Return the raw pointer to the data loader."""
+    return self._self
+
+  def check_source(self, filename: str):
+    """@private: Raise FileNotFoundError if filename does not exist"""
+    if not os.path.exists(filename):
+      raise FileNotFoundError(filename)
+
+  def load(self, filename: str, runNumber: int, evtNumber: int):
+    """Loads a binary event file."""
+    self.check_source(filename)
+
+    if clib.BinaryDataLoader_load(
+        self._self, filename.encode('ascii'), runNumber, evtNumber
+        ) != 0:
+      raise ValueError(f"Invalid binary event file {filename}")
+
+  def load_many(
+      self, 
+      filenames: List[str], 
+      runNumber: int, 
+      firstEvtNumber: int, 
+      n_threads: int = 0
+      ):
+    """Loads a list of binary event files, one event per file with
+    event numbers increasing from `firstEvtNumber`, parsing the files in 
+    `n_threads` parallel threads (all the available cores if 0).
+
+    The files are parsed into temporary in-memory databases, which are 
+    then copied to the event store in the order of the list.
+    """
+    for filename in filenames:
+      self.check_source(filename)
+
+    ArrayOfPaths = ctypes.c_char_p * len(filenames)
+    buf = ArrayOfPaths(*[f.encode('ascii') for f in filenames])
+    if clib.AbsDataLoader_load_many(
+        self._self, len(filenames), buf, runNumber, firstEvtNumber, n_threads
+        ) != 0:
+      raise RuntimeError("Failed loading the list of files")
@@ -0,0 +1,129 @@
+# (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration. 
+#                                                                             
+# This software is distributed under the terms of the GNU General Public
+# Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+#                                                                             
+# In applying this licence, CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization  
+# or submit itself to any jurisdiction.
+
+import ctypes
+from typing import List, Optional
+import os
+from SQLamarr import clib
+
+from SQLamarr.db_functions import SQLite3DB
+
+clib.new_HepMC3DataLoader.argtypes = (ctypes.c_void_p,)
+clib.new_HepMC3DataLoader.restype = ctypes.c_void_p
+
+clib.del_HepMC3DataLoader.argtypes = (ctypes.c_void_p,)
+
+clib.HepMC3DataLoader_load.argtypes = (
+    ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t
+    ) 
+clib.HepMC3DataLoader_load.restype = ctypes.c_int
+
+clib.HepMC3DataLoader_load_range.argtypes = (
+    ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t,
+    ctypes.c_size_t, ctypes.c_size_t
+    ) 
+clib.HepMC3DataLoader_load_range.restype = ctypes.c_int
+
+clib.AbsDataLoader_load_many.argtypes = (
+    ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_char_p), 
+    ctypes.c_size_t, ctypes.c_size_t, ctypes.c_uint
+    )
+clib.AbsDataLoader_load_many.restype = ctypes.c_int
+
+class HepMC3DataLoader:
+  """
+  Data loader for ASCII files in the native HepMC3 format, possibly 
+  gzip-compressed.
+
+  Example.
+  ```python
+  db = SQLamarr.SQLite3DB()
+  data_loader = SQLamarr.HepMC3DataLoader(db)
+
+  for iEvent, file in enumerate(my_list_of_hepmc3_gz_files, 1):
+    data_loader.load(file, runNumber, iEvent)
+    # ...do something...
+  ```
+  """
+  def __init__(self, db: SQLite3DB):
+    """Acquires the reference to an open connection to the DB"""
+    self._db = db
+    self._self = clib.new_HepMC3DataLoader(self._db.get())
+
+  def __del__(self):
+    """@private: Release the bound class instance"""
+    clib.del_HepMC3DataLoader(self._self)
+
+  @property
+  def raw_pointer(self):
+    """@private: Return the raw pointer to the data loader."""
+    return self._self
+
+  def check_source(self, filename: str):
+    """@private: Raise FileNotFoundError if filename does not exist"""
+    if not os.path.exists(filename):
+      raise FileNotFoundError(filename)
+
+  def load(
+      self, 
+      filename: str, 
+      runNumber: int, 
+      evtNumber: int, 
+      first_event: int = 0, 
+      max_events: Optional[int] = None
+      ):
+    """Loads an ASCII file with
+    [HepMC3::ReaderAscii](http://hepmc.web.cern.ch/hepmc/classHepMC3_1_1ReaderAscii.html),
+    decompressing gzip-compressed files on the fly.
+
+    If `first_event` or `max_events` are specified, only the `GenEvent`s 
+    from `first_event` (0-based) to `first_event + max_events` (excluded) 
+    are loaded. Uncompressed files are indexed at the first call, and the 
+    index is cached in a file named as the input file followed by `.idx`, 
+    so that workers processing different ranges of a large file reach 
+    their first event without parsing the previous ones.
+    """
+    self.check_source(filename)
+
+    if first_event == 0 and max_events is None:
+      ret = clib.HepMC3DataLoader_load(
+          self._self, filename.encode('ascii'), runNumber, evtNumber
+          )
+    else:
+      ret = clib.HepMC3DataLoader_load_range(
+          self._self, filename.encode('ascii'), runNumber, evtNumber,
+          first_event, ctypes.c_size_t(-1 if max_events is None else max_events)
+          )
+
+    if ret != 0:
+      raise RuntimeError(f"Failed loading {filename}")
+
+  def load_many(
+      self, 
+      filenames: List[str], 
+      runNumber: int, 
+      firstEvtNumber: int, 
+      n_threads: int = 0
+      ):
+    """Loads a list of HepMC3 ASCII files, one event per file with
+    event numbers increasing from `firstEvtNumber`, parsing the files in 
+    `n_threads` parallel threads (all the available cores if 0).
+
+    The files are parsed into temporary in-memory databases, which are 
+    then copied to the event store in the order of the list.
+    """
+    for filename in filenames:
+      self.check_source(filename)
+
+    ArrayOfPaths = ctypes.c_char_p * len(filenames)
+    buf = ArrayOfPaths(*[f.encode('ascii') for f in filenames])
+    if clib.AbsDataLoader_load_many(
+        self._self, len(filenames), buf, runNumber, firstEvtNumber, n_threads
+        ) != 0:
+      raise RuntimeError("Failed loading the list of files")
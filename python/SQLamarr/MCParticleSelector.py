@@ -32,9 +32,17 @@ class MCParticleSelector:
   `MCParticle` graph is a tree, with each vertex (node) accepting a single input
   particle (decay vertex).
   """
-  def __init__ (self, db: SQLite3DB):
-    """Acquires the reference to an open connection to the DB"""
+  def __init__ (self, db: SQLite3DB, incremental: bool = False):
+    """
+    Acquires the reference to an open connection to the DB
+
+    @param db: An open database connection;
+    @param incremental: if True, only the events loaded after the previous
+      execution are processed. By default, all the events are processed
+      at each execution.
+    """
     self._self = clib.new_MCParticleSelector(db.get())
+    clib.Transformer_set_incremental(self._self, incremental)
   
   def __del__(self):
     """@private: Release the bound class instance"""
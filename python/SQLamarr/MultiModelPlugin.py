@@ -0,0 +1,141 @@
+# (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+#
+# This software is distributed under the terms of the GNU General Public
+# Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+#
+# In applying this licence, CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization
+# or submit itself to any jurisdiction.
+
+import ctypes
+from SQLamarr import clib, c_TransformerPtr
+from typing import List, Optional
+
+from SQLamarr.db_functions import SQLite3DB
+
+clib.new_MultiModelPlugin.argtypes = (
+    ctypes.c_void_p,        # void *db,
+    ctypes.c_char_p,        # const char* query,
+    ctypes.c_char_p,        # const char* semicolon_separated_references
+    )
+clib.new_MultiModelPlugin.restype = c_TransformerPtr
+
+clib.MultiModelPlugin_add_model.argtypes = (
+    c_TransformerPtr,       # TransformerPtr self,
+    ctypes.c_char_p,        # const char* library_path,
+    ctypes.c_char_p,        # const char* function_name,
+    ctypes.c_char_p,        # const char* output_table,
+    ctypes.c_char_p,        # const char* semicolon_separated_outputs,
+    ctypes.c_int,           # int n_random,
+    ctypes.c_char_p,        # const char* semicolon_separated_inputs
+    ctypes.c_char_p,        # const char* semicolon_separated_selected_values
+    )
+clib.MultiModelPlugin_add_model.restype = ctypes.c_int
+
+clib.MultiModelPlugin_set_selection.argtypes = (c_TransformerPtr, ctypes.c_char_p)
+clib.MultiModelPlugin_set_selection.restype = ctypes.c_int
+
+class MultiModelPlugin:
+  """
+  Wrapper to several compiled parametrizations evaluated on the rows of a
+  single query, running the query (and its SQL functions) only once.
+
+  Python bindings for SQLamarr::MultiModelPlugin.
+
+  Example.
+  ```python
+  tracking = SQLamarr.MultiModelPlugin(db, query, ["mcparticle_id"])
+  tracking.add_model(library, "acceptance", "tmp_acceptance_out", ["acceptance"])
+  tracking.add_model(library, "efficiency", "tmp_efficiency_out",
+      ["not_recoed", "long", "upstream", "downstream"])
+  ```
+
+  With a selection column, each row is routed to the models selecting its
+  value, and models with the same outputs share the columns of the table.
+  ```python
+  pid = SQLamarr.MultiModelPlugin(db, query, ["mcparticle_id"], selection="abspid")
+  pid.add_model(library, "pion_pipe", "tmp_pid", outputs, 64, selected_values=[211])
+  pid.add_model(library, "kaon_pipe", "tmp_pid", outputs, 64, selected_values=[321])
+  ```
+  """
+  def __init__ (
+      self, 
+      db: SQLite3DB,        
+      query: str,
+      references: List[str],
+      selection: Optional[str] = None
+      ):
+    """
+    Configure a `Transformer` evaluating multiple parametrizations on the 
+    rows of a query. Models are added with `add_model()`.
+
+    @param db: An open database connection;
+    @param query: SQL query defining the reference indices and the inputs to
+                  be passed to the wrapped functions;
+    @param references: list of reference indices `SELECT`ed by the `query`,
+                       but not part of the input to the wrapped functions;
+    @param selection: integer column `SELECT`ed by the `query` routing the
+                      rows to the models, not part of their input.
+    """
+    self._self = clib.new_MultiModelPlugin(
+        db.get(),
+        query.encode('ascii'),
+        ";".join(references).encode('ascii'),
+        )
+
+    if selection is not None:
+      if clib.MultiModelPlugin_set_selection(
+          self._self, selection.encode('ascii')) != 0:
+        raise ValueError(f"Invalid selection column {selection}")
+
+  def add_model(
+      self,
+      library_path: str,
+      function_name: str,
+      output_table: str,
+      outputs: List[str],
+      nRandom: int = 0,
+      inputs: Optional[List[str]] = None,
+      selected_values: Optional[List[int]] = None
+      ):
+    """
+    Add a parametrization function defined in an external library.
+    Models writing to the same output table produce a single wide table.
+
+    @param library_path: path-like position of the shared library;
+    @param function_name: linker symbol of the function to wrap;
+    @param output_table: name of the output TEMPORARY TABLE where outputs are
+                  stored toghether with the reference indices;
+    @param outputs: list of the output column names for further reference;
+    @param nRandom: number of normally distributed random noise values, for
+                    generative models, or 0;
+    @param inputs: names of the columns of the query passed to the function,
+                   if not all but the reference indices;
+    @param selected_values: values of the selection column of the rows the
+                   model is evaluated on, if not all.
+    @return the MultiModelPlugin itself, to chain the calls.
+    """
+    ret = clib.MultiModelPlugin_add_model(
+        self._self,
+        library_path.encode('ascii'),
+        function_name.encode('ascii'),
+        output_table.encode('ascii'),
+        ";".join(outputs).encode('ascii'),
+        int(nRandom),
+        ";".join(inputs or []).encode('ascii'),
+        ";".join(str(int(v)) for v in selected_values or []).encode('ascii'),
+        )
+
+    if ret != 0:
+      raise ValueError(f"Failed adding model {function_name} from {library_path}")
+
+    return self
+  
+  def __del__(self):
+    """@private: Release the bound class instance"""
+    clib.del_Transformer(self._self)
+
+  @property
+  def raw_pointer(self):
+    """@private: Return the raw pointer to the algorithm."""
+    return self._self
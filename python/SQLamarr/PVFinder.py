@@ -21,14 +21,23 @@ class PVFinder:
 
   Python binding of `SQLamarr::PVFinder`.
   """
-  def __init__ (self, db: SQLite3DB, signal_status_code: int = 889):
+  def __init__ (
+      self, 
+      db: SQLite3DB, 
+      signal_status_code: int = 889, 
+      incremental: bool = False
+      ):
     """
     Acquires the reference to an open connection to the DB.
 
     @param db: SQLite3DB reference to an open connection
     @param signal_status_code: HepMC status code identifying a signal canidate
+    @param incremental: if True, only the events loaded after the previous
+      execution are processed. By default, all the events are processed
+      at each execution.
     """
     self._self = clib.new_PVFinder(db.get(), signal_status_code)
+    clib.Transformer_set_incremental(self._self, incremental)
   
   def __del__(self):
     """@private: Release the bound class instance"""
@@ -34,7 +34,8 @@ class PVReconstruction:
       db: SQLite3DB, 
       file_name: str, 
       table_name: str, 
-      condition: str
+      condition: str,
+      incremental: bool = False
       ):
     """
     Acquires the reference to an open connection to the database and 
@@ -45,13 +46,17 @@ class PVReconstruction:
     @param table_name: string providing the name of the TABLE where the
       parametrizations for the PV reconstruction are stored;
     @param condition: string identifier of the row to read the parametrization
-      from.
+      from;
+    @param incremental: if True, only the primary vertices of the events 
+      loaded after the previous execution are reconstructed. By default,
+      all the primary vertices are reconstructed at each execution.
     """
     self._self = clib.new_PVReconstruction(db.get(), 
         file_name.encode('ascii'),
         table_name.encode('ascii'),
         condition.encode('ascii'),
         )
+    clib.Transformer_set_incremental(self._self, incremental)
   
   def __del__(self):
     """@private: Release the bound class instance"""
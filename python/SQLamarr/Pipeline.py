@@ -8,22 +8,225 @@
 # or submit itself to any jurisdiction.
 
 import ctypes
+import time
 from ctypes import POINTER 
 from SQLamarr import clib, c_TransformerPtr
 
-from typing import List, Any
+from typing import List, Dict, Any, Optional, Union
+
+from SQLamarr.db_functions import SQLite3DB, _validate_token
 
 
 clib.execute_pipeline.argtypes = (ctypes.c_int, POINTER(c_TransformerPtr))
 clib.execute_pipeline.restype = ctypes.c_int
 
+clib.new_Pipeline.argtypes = (
+    ctypes.c_int, POINTER(c_TransformerPtr), ctypes.c_void_p
+    )
+clib.new_Pipeline.restype = ctypes.c_void_p
+
+clib.del_Pipeline.argtypes = (ctypes.c_void_p,)
+
+clib.Pipeline_execute.argtypes = (ctypes.c_void_p, ctypes.c_size_t)
+clib.Pipeline_execute.restype = ctypes.c_int
+
+clib.Pipeline_execute_over_files.argtypes = (
+    ctypes.c_void_p, ctypes.c_int, POINTER(ctypes.c_char_p), 
+    ctypes.c_size_t, ctypes.c_size_t
+    )
+clib.Pipeline_execute_over_files.restype = ctypes.c_int
+
+clib.Pipeline_set_instrumentation.argtypes = (ctypes.c_void_p, ctypes.c_bool)
+
+clib.Pipeline_set_transaction_policy.argtypes = (
+    ctypes.c_void_p, ctypes.c_int, ctypes.c_size_t
+    )
+clib.Pipeline_set_transaction_policy.restype = ctypes.c_int
+
+clib.Pipeline_set_checkpoint_interval.argtypes = (
+    ctypes.c_void_p, ctypes.c_size_t
+    )
+
+clib.Pipeline_set_n_threads.argtypes = (ctypes.c_void_p, ctypes.c_uint)
+clib.Pipeline_set_n_threads.restype = ctypes.c_int
+
+clib.Pipeline_set_skip_unchanged.argtypes = (ctypes.c_void_p, ctypes.c_bool)
+
+clib.Pipeline_mark_changed.argtypes = (ctypes.c_void_p, ctypes.c_char_p)
+
+clib.Pipeline_get_stage.argtypes = (ctypes.c_void_p, ctypes.c_int)
+clib.Pipeline_get_stage.restype = ctypes.c_int
+
+clib.Pipeline_reset_stats.argtypes = (ctypes.c_void_p,)
+
+clib.Pipeline_export_stats.argtypes = (
+    ctypes.c_void_p, ctypes.c_void_p, ctypes.c_char_p, ctypes.c_bool, ctypes.c_int
+    )
+clib.Pipeline_export_stats.restype = ctypes.c_int
+
+clib.Pipeline_set_profiling.argtypes = (ctypes.c_void_p, ctypes.c_bool)
+
+clib.Pipeline_export_profiles.argtypes = (
+    ctypes.c_void_p, ctypes.c_void_p, ctypes.c_char_p, ctypes.c_bool
+    )
+clib.Pipeline_export_profiles.restype = ctypes.c_int
+
+class c_PipelineStats (ctypes.Structure):
+  """@private: Mirror of the PipelineStats struct of the bindings"""
+  _fields_ = [
+      ("calls", ctypes.c_uint64),
+      ("wall_time", ctypes.c_double),
+      ("cpu_time", ctypes.c_double),
+      ("rows_changed", ctypes.c_int64),
+      ("rows_returned", ctypes.c_uint64),
+      ("statements_prepared", ctypes.c_uint64),
+      ("cache_hits", ctypes.c_int64),
+      ("cache_misses", ctypes.c_int64),
+      ]
+
+clib.Pipeline_get_stats.argtypes = (ctypes.c_void_p, ctypes.c_int)
+clib.Pipeline_get_stats.restype = c_PipelineStats
+
+# Values of SQLamarr::Pipeline::TransactionPolicy
+_PER_TRANSFORMER, _PER_BATCH, _PER_N_BATCHES = range(3)
+
 SQL_ERRORSHIFT = 10000
 LOGIC_ERRORSHIFT = 20000
+LOADER_ERROR = 30000
 
 class SQLiteError (RuntimeError):
   pass
 
 
+class _CppChunk:
+  """@private Sequence of C++ transformers registered once in a C++ Pipeline"""
+  def __init__(self, algorithms: List[Any], loader: Any = None):
+    self._algorithms = algorithms
+    self._loader = loader
+    ArrayOfAlgos = c_TransformerPtr * len(algorithms)
+    buf = ArrayOfAlgos(*[c.raw_pointer for c in algorithms])
+    self._self = clib.new_Pipeline(
+        len(algorithms), 
+        buf, 
+        loader.raw_pointer if loader is not None else None
+        )
+
+  def __del__(self):
+    clib.del_Pipeline(self._self)
+
+  def _check(self, ret: int):
+    chunk = self._algorithms
+    if ret >= SQL_ERRORSHIFT and ret < SQL_ERRORSHIFT + len(chunk):
+      raise SQLiteError(f"Failed executing {chunk[ret-SQL_ERRORSHIFT]}")
+    elif ret >= LOGIC_ERRORSHIFT and ret < LOGIC_ERRORSHIFT + len(chunk):
+      raise RuntimeError(f"Failed executing {chunk[ret-LOGIC_ERRORSHIFT]}")
+    elif ret == LOADER_ERROR:
+      raise RuntimeError(f"Failed loading data with {self._loader}")
+    elif ret != 0:
+      raise Exception("Unknown error code from pipeline exec")
+
+  def execute(self, n_times: int = 1):
+    self._check(clib.Pipeline_execute(self._self, n_times))
+
+  def set_instrumentation(self, enabled: bool):
+    clib.Pipeline_set_instrumentation(self._self, enabled)
+
+  def set_transaction_policy(self, policy: int, n_batches: int):
+    if clib.Pipeline_set_transaction_policy(self._self, policy, n_batches) != 0:
+      raise ValueError(f"Invalid transaction policy ({policy}, {n_batches})")
+
+  def set_checkpoint_interval(self, n_batches: int):
+    clib.Pipeline_set_checkpoint_interval(self._self, n_batches)
+
+  def set_n_threads(self, n_threads: int):
+    if clib.Pipeline_set_n_threads(self._self, n_threads) != 0:
+      raise ValueError(f"Invalid number of threads {n_threads}")
+
+  def set_skip_unchanged(self, enabled: bool):
+    clib.Pipeline_set_skip_unchanged(self._self, enabled)
+
+  def mark_changed(self, table: Optional[str]):
+    clib.Pipeline_mark_changed(
+        self._self, table.encode('ascii') if table is not None else None)
+
+  def stages(self):
+    stage_of = [clib.Pipeline_get_stage(self._self, iAlg) 
+        for iAlg in range(len(self._algorithms))]
+    if min(stage_of, default=-1) < 0:
+      return [list(self._algorithms)]
+
+    ret = [[] for _ in range(max(stage_of) + 1)]
+    for alg, stage in zip(self._algorithms, stage_of):
+      ret[stage].append(alg)
+    return ret
+
+  def reset_stats(self):
+    clib.Pipeline_reset_stats(self._self)
+
+  def export_stats(self, db: SQLite3DB, table: str, append: bool, first_algorithm: int):
+    if clib.Pipeline_export_stats(
+        self._self, db.get(), table.encode('ascii'), append, first_algorithm) != 0:
+      raise SQLiteError(f"Failed exporting the stats to {table}")
+
+  def set_profiling(self, enabled: bool):
+    clib.Pipeline_set_profiling(self._self, enabled)
+
+  def export_profiles(self, db: SQLite3DB, table: str, append: bool):
+    if clib.Pipeline_export_profiles(
+        self._self, db.get(), table.encode('ascii'), append) != 0:
+      raise SQLiteError(f"Failed exporting the profiles to {table}")
+
+  def stats(self):
+    ret = []
+    for iAlg, alg in enumerate(self._algorithms):
+      c_stats = clib.Pipeline_get_stats(self._self, iAlg)
+      stats = dict(name=alg.__class__.__name__)
+      stats.update({k: getattr(c_stats, k) for k, _ in c_PipelineStats._fields_})
+      ret.append(stats)
+    return ret
+
+  def execute_over_files(self, files: List[str], run_number: int, first_evt_number: int):
+    ArrayOfPaths = ctypes.c_char_p * len(files)
+    buf = ArrayOfPaths(*[f.encode('ascii') for f in files])
+    self._check(clib.Pipeline_execute_over_files(
+      self._self, len(files), buf, run_number, first_evt_number
+      ))
+
+
+class _PyStep:
+  """@private Python callable, timed in Python if instrumented"""
+  def __init__(self, algorithm: Any):
+    self._algorithm = algorithm
+    self._instrumented = False
+    self.reset_stats()
+
+  def execute(self):
+    if not self._instrumented:
+      return self._algorithm()
+
+    wall_start, cpu_start = time.perf_counter(), time.process_time()
+    self._algorithm()
+    self._stats['cpu_time'] += time.process_time() - cpu_start
+    self._stats['wall_time'] += time.perf_counter() - wall_start
+    self._stats['calls'] += 1
+
+  def set_instrumentation(self, enabled: bool):
+    self._instrumented = enabled
+
+  def mark_changed(self, table: Optional[str]):
+    pass
+
+  def stages(self):
+    return [[self._algorithm]]
+
+  def reset_stats(self):
+    self._stats = {k: 0 for k, _ in c_PipelineStats._fields_}
+
+  def stats(self):
+    name = getattr(self._algorithm, '__name__', self._algorithm.__class__.__name__)
+    return [dict(name=name, **self._stats)]
+
+
 class Pipeline:
   """
   The `Pipeline` object defines the envelop for running C++ transformers from
@@ -39,36 +242,128 @@ class Pipeline:
   
   Hence, if logically possible, one should avoid interleaving C++ and Python
   algorithms.
+
+  Consecutive C++ transformers are registered once in a persistent C++ 
+  `SQLamarr::Pipeline`. If the pipeline is composed of C++ transformers only,
+  the event loops of `execute(n_times)` and `execute_over_files()` 
+  run entirely in C++.
+
+  Example.
+  ```python
+  loader = SQLamarr.HepMC2DataLoader(db)
+  pipeline = SQLamarr.Pipeline([
+      SQLamarr.PVFinder(db),
+      SQLamarr.MCParticleSelector(db),
+      SQLamarr.CleanEventStore(db),
+    ], loader=loader)
+
+  pipeline.execute_over_files(my_list_of_files, runNumber)
+  ```
+
+  With `instrument=True`, the pipeline accumulates per-algorithm timing 
+  and, for C++ transformers, SQLite counters (rows changed and returned, 
+  statements prepared, page cache hits and misses).
+  ```python
+  pipeline = SQLamarr.Pipeline([...], instrument=True)
+  pipeline.execute()
+  pipeline.export_stats(db, "PipelineStats")
+  ```
+
+  With `profile=True`, the SQL statements of the C++ transformers and of 
+  the data loader record the SQLite counters of full-scan steps, sorts, 
+  automatic indices and virtual machine steps, their execution time and 
+  their query plan.
+  ```python
+  pipeline = SQLamarr.Pipeline([...], profile=True)
+  pipeline.execute()
+  pipeline.export_profiles(db, "QueryProfiles")
+  ```
+
+  With a file-backed database, `transaction_policy` groups the updates of
+  the C++ transformers in one transaction per batch (`"batch"`, i.e. per
+  loaded file or per execution) or per `N` batches (an integer `N`), 
+  instead of letting each transformer commit its own updates 
+  (`"transformer"`, the default). Pending updates are committed when 
+  `execute()` or `execute_over_files()` returns.
+  ```python
+  pipeline = SQLamarr.Pipeline([...], loader=loader, transaction_policy=100)
+  pipeline.execute_over_files(my_list_of_files, runNumber)
+  ```
+
+  If the database is in write-ahead log mode (see `SQLite3DB.enable_wal`),
+  `checkpoint_every=N` checkpoints the log every `N` batches, once the 
+  pending updates are committed, while other processes read the 
+  committed batches (see `SQLite3DB.snapshot`).
+  ```python
+  db = SQLamarr.SQLite3DB("production.db").enable_wal(autocheckpoint=0)
+  pipeline = SQLamarr.Pipeline([...], loader=loader, 
+      transaction_policy="batch", checkpoint_every=100)
+  ```
+
+  With `n_threads > 1`, the C++ transformers are scheduled in stages 
+  according to the tables they read and write, as observed in the first
+  execution, and those of a stage bound to different connections (e.g.
+  to a database file in write-ahead log mode) run concurrently.
+  With `skip_unchanged=True`, the C++ transformers whose tables were not
+  modified since their previous execution are skipped; tables modified 
+  through other connections must be notified with `mark_changed()`.
+  Python algorithms are assumed to modify any table, so the C++ 
+  transformers are never skipped after a Python algorithm.
+  ```python
+  pipeline = SQLamarr.Pipeline([...], n_threads=4, skip_unchanged=True)
+  pipeline.execute()
+  stages = pipeline.stages  # algorithms run concurrently, stage by stage
+  ```
   """
-  def __init__(self, algoritms: List[Any]):
+  def __init__(
+      self, 
+      algoritms: List[Any], 
+      loader: Optional[Any] = None,
+      instrument: bool = False,
+      profile: bool = False,
+      transaction_policy: Union[str, int] = "transformer",
+      checkpoint_every: int = 0,
+      n_threads: int = 1,
+      skip_unchanged: bool = False
+      ):
     """
     Acquire the list of algorithms
-    """
-    self._algorithms = algoritms
-
 
-  @staticmethod
-  def _exec_chunk (chunk):
-    """@private Execute a sequence of C++-only transformers"""
-    ArrayOfAlgos = c_TransformerPtr * len(chunk)
-    buf = ArrayOfAlgos(*[c.raw_pointer for c in chunk])
-    ret = clib.execute_pipeline (len(chunk), buf)
+    @param algoritms: list of C++ transformers and Python callables;
+    @param loader: optional data loader (e.g. `HepMC2DataLoader`) used by
+      `execute_over_files`;
+    @param instrument: if True, collect per-algorithm performance counters;
+    @param profile: if True, profile the SQL statements of C++ transformers;
+    @param transaction_policy: "transformer", "batch" or the number of 
+      batches committed in a single transaction;
+    @param checkpoint_every: number of batches between checkpoints of the
+      write-ahead log, 0 to rely on the automatic checkpoints of SQLite;
+    @param n_threads: maximum number of C++ transformers run concurrently,
+      requires the "transformer" transaction policy;
+    @param skip_unchanged: if True, skip the C++ transformers whose tables
+      did not change since their previous execution.
+    """
+    if transaction_policy == "transformer":
+      policy = (_PER_TRANSFORMER, 1)
+    elif transaction_policy == "batch":
+      policy = (_PER_BATCH, 1)
+    elif isinstance(transaction_policy, int) and transaction_policy > 0:
+      policy = (_PER_N_BATCHES, transaction_policy)
+    else:
+      raise ValueError(f"Invalid transaction policy {transaction_policy}")
 
-    if ret >= SQL_ERRORSHIFT and ret < SQL_ERRORSHIFT + len(chunk):
-      raise SQLiteError(f"Failed executing {chunk[ret-SQL_ERRORSHIFT]}")
-    elif ret >= LOGIC_ERRORSHIFT and ret < LOGIC_ERRORSHIFT + len(chunk):
-      raise RuntimeError(f"Failed executing {chunk[ret-LOGIC_ERRORSHIFT]}")
-    elif ret != 0:
-      raise Exception("Unknown error code from pipeline exec")
+    self._algorithms = algoritms
+    self._loader = loader
+    self._skip_unchanged = skip_unchanged
 
-  def execute(self):
-    """Execute the list of algorithms"""
     chunk = []
+    self._steps = []
     for alg in self._algorithms:
       if hasattr(alg, '__call__'):
-        self._exec_chunk(chunk)
+        if len(chunk): 
+          self._steps.append(chunk)
+        self._steps.append(alg)
         chunk = []
-        alg()
       elif hasattr(alg, 'raw_pointer'):
         chunk.append(alg)
       else:
@@ -76,6 +371,148 @@ class Pipeline:
             f"Unexpected algorithm {alg} ({alg.__class__.__name__})"
             )
 
-    self._exec_chunk(chunk)
+    if len(chunk):
+      self._steps.append(chunk)
+
+    self._cpp_only = len(self._steps) == 1 and isinstance(self._steps[0], list)
+    self._steps = [
+        _CppChunk(step, loader if self._cpp_only else None) 
+        if isinstance(step, list) else _PyStep(step)
+        for step in self._steps
+    ]
+
+    for step in self._steps:
+      step.set_instrumentation(instrument)
+      if isinstance(step, _CppChunk):
+        step.set_transaction_policy(*policy)
+        step.set_checkpoint_interval(checkpoint_every)
+        step.set_n_threads(n_threads)
+        step.set_skip_unchanged(skip_unchanged)
+        if profile:
+          step.set_profiling(True)
+
+  @property
+  def stats(self) -> List[Dict[str, Any]]:
+    """
+    Performance counters accumulated by each algorithm, in pipeline order.
+    Times are in seconds; SQLite counters are zero for Python algorithms.
+    """
+    return [s for step in self._steps for s in step.stats()]
+
+  @property
+  def stages(self) -> List[List[Any]]:
+    """
+    Algorithms grouped in the stages of the schedule, in execution order.
+    Algorithms of the same stage do not depend on each other.
+    """
+    return [stage for step in self._steps for stage in step.stages()]
+
+  def mark_changed(self, table: Optional[str] = None):
+    """
+    Notify the modification of a table (or of all the tables, if None) 
+    through a connection not used by the C++ transformers, so that those 
+    accessing it are not skipped.
+
+    @param table: name of the modified table.
+    """
+    for step in self._steps:
+      step.mark_changed(table)
+
+  def reset_stats(self):
+    """Reset the performance counters to zero"""
+    for step in self._steps:
+      step.reset_stats()
+
+  def export_stats(self, db: SQLite3DB, table: str = "PipelineStats"):
+    """
+    Write the performance counters to a table of the database, 
+    replacing its content.
+
+    @param db: SQLite3DB reference to an open connection;
+    @param table: name of the output table.
+    """
+    _validate_token(table)
+    py_rows = []
+    first_algorithm = 0
+    for step in self._steps:
+      if isinstance(step, _CppChunk):
+        step.export_stats(db, table, append=first_algorithm > 0, 
+            first_algorithm=first_algorithm)
+      else:
+        if first_algorithm == 0:
+          # The table is created and emptied by a C++ pipeline, even if empty
+          _CppChunk([]).export_stats(db, table, append=False, first_algorithm=0)
+        py_rows += [[first_algorithm, s['name']] + [s[k] for k, _ in c_PipelineStats._fields_]
+            for s in step.stats()]
+      first_algorithm += len(step.stats())
+
+    if len(py_rows):
+      columns = ['algorithm', 'name'] + [k for k, _ in c_PipelineStats._fields_]
+      with db.connect() as c:
+        c.executemany(
+            f"INSERT INTO {table} ({', '.join(columns)}) "
+            f"VALUES ({', '.join(['?'] * len(columns))})",
+            py_rows
+          )
+        c.commit()
+
+  def export_profiles(self, db: SQLite3DB, table: str = "QueryProfiles"):
+    """
+    Write the profiles of the SQL statements to a table of the database,
+    replacing its content. Requires the pipeline to be created with 
+    `profile=True`.
+
+    @param db: SQLite3DB reference to an open connection;
+    @param table: name of the output table.
+    """
+    _validate_token(table)
+    cpp_chunks = [s for s in self._steps if isinstance(s, _CppChunk)]
+    for iChunk, chunk in enumerate(cpp_chunks):
+      chunk.export_profiles(db, table, append=iChunk > 0)
+
+  def execute(self, n_times: int = 1):
+    """
+    Execute the list of algorithms
+
+    @param n_times: number of consecutive executions of the whole sequence
+    """
+    if self._cpp_only:
+      self._steps[0].execute(n_times)
+      return
+
+    for _ in range(n_times):
+      for step in self._steps:
+        step.execute()
+        if self._skip_unchanged and isinstance(step, _PyStep):
+          # Python algorithms write through connections not tracked in C++
+          self.mark_changed()
+
+  def execute_over_files(
+      self, 
+      files: List[str], 
+      run_number: int, 
+      first_evt_number: int = 0
+      ):
+    """
+    Load each file with the data loader and execute the list of algorithms.
+
+    @param files: list of input files (or data source labels, depending on
+      the data loader), each loaded as a separate event;
+    @param run_number: run number assigned to the loaded events;
+    @param first_evt_number: event number of the first file, then incremented.
+    """
+    if self._loader is None:
+      raise ValueError("Pipeline defined without a data loader")
+
+    check_source = getattr(self._loader, 'check_source', None)
+    if check_source is not None:
+      for filename in files:
+        check_source(filename)
 
+    if self._cpp_only:
+      self._steps[0].execute_over_files(files, run_number, first_evt_number)
+      return
 
+    for evt_number, filename in enumerate(files, first_evt_number):
+      self._loader.load(filename, run_number, evt_number)
+      self.execute()
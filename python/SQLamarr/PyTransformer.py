@@ -7,6 +7,8 @@
 # granted to it by virtue of its status as an Intergovernmental Organization  
 # or submit itself to any jurisdiction.
 
+import functools
+
 from SQLamarr.db_functions import SQLite3DB
 
 class PyTransformer:
@@ -50,6 +52,7 @@ class PyTransformer:
 
   def __call__(self, f):
     """@private: Wrap a function in an algorithm"""
+    @functools.wraps(f)
     def wrapped():
       with self._db.connect() as c:
         f (c)
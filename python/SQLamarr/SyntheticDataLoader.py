@@ -0,0 +1,103 @@
+# (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration. 
+#                                                                             
+# This software is distributed under the terms of the GNU General Public
+# Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+#                                                                             
+# In applying this licence, CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization  
+# or submit itself to any jurisdiction.
+
+import ctypes
+from SQLamarr import clib
+
+from SQLamarr.db_functions import SQLite3DB
+
+clib.new_SyntheticDataLoader.argtypes = (
+    ctypes.c_void_p,        # void* db
+    ctypes.c_double,        # double pileup
+    ctypes.c_double,        # double multiplicity
+    ctypes.c_uint,          # unsigned int max_depth
+    ctypes.c_double,        # double decay_probability
+    ctypes.c_uint,          # unsigned int n_daughters
+    ctypes.c_bool,          # bool with_signal
+    )
+clib.new_SyntheticDataLoader.restype = ctypes.c_void_p
+
+clib.del_SyntheticDataLoader.argtypes = (ctypes.c_void_p,)
+
+clib.SyntheticDataLoader_load.argtypes = (
+    ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t
+    ) 
+clib.SyntheticDataLoader_load.restype = ctypes.c_int
+
+class SyntheticDataLoader:
+  """
+  Data loader generating synthetic decay trees directly in the database.
+
+  Python binding of `SQLamarr::SyntheticDataLoader`, intended for load and 
+  scaling tests without input files.
+
+  Example.
+  ```python
+  db = SQLamarr.SQLite3DB().seed(42)
+
+  # Run 3-like pile-up
+  loader = SQLamarr.SyntheticDataLoader(db, pileup=5.5, multiplicity=150)
+
+  pipeline = SQLamarr.Pipeline([
+      SQLamarr.PVFinder(db),
+      SQLamarr.MCParticleSelector(db),
+      SQLamarr.CleanEventStore(db),
+    ], loader=loader)
+
+  pipeline.execute_over_files(["synthetic"] * 1000, runNumber)
+  ```
+  """
+  def __init__(
+      self, 
+      db: SQLite3DB, 
+      pileup: float = 5.5,
+      multiplicity: float = 100.,
+      max_depth: int = 3,
+      decay_probability: float = 0.1,
+      n_daughters: int = 2,
+      with_signal: bool = True,
+      ):
+    """
+    Acquires the reference to an open connection to the DB and configures
+    the generator.
+
+    @param db: SQLite3DB reference to an open connection (must be seeded);
+    @param pileup: mean number of collisions per event;
+    @param multiplicity: mean number of particles produced at each primary vertex;
+    @param max_depth: maximum number of generations in the decay trees;
+    @param decay_probability: probability for each particle to decay;
+    @param n_daughters: number of daughters of each decay;
+    @param with_signal: flag a decaying particle per event with the signal status.
+    """
+    self._db = db
+    self._self = clib.new_SyntheticDataLoader(
+        self._db.get(), 
+        pileup, 
+        multiplicity, 
+        max_depth, 
+        decay_probability, 
+        n_daughters, 
+        with_signal
+        )
+
+  def __del__(self):
+    """@private: Release the bound class instance"""
+    clib.del_SyntheticDataLoader(self._self)
+
+  @property
+  def raw_pointer(self):
+    """@private: Return the raw pointer to the data loader."""
+    return self._self
+
+  def load(self, label: str, runNumber: int, evtNumber: int):
+    """Generate an event, stored with `label` as data source."""
+    if clib.SyntheticDataLoader_load(
+        self._self, label.encode('ascii'), runNumber, evtNumber
+        ) != 0:
+      raise RuntimeError(f"Failed generating the event {label}")
@@ -24,10 +24,24 @@ clib.new_TemporaryTable.argtypes = (
 
 clib.new_TemporaryTable.restype = c_TransformerPtr
 
+clib.TemporaryTable_set_materialization.argtypes = (c_TransformerPtr, ctypes.c_int)
+
+## Values of SQLamarr::TemporaryTable::Materialization
+MATERIALIZATIONS = {'copy': 0, 'view': 1, 'recreate': 2, 'incremental': 3}
+
 class TemporaryTable:
   """Creates a temporary table from an SQL query. Persitency can be enabled.
 
   Python binding of `SQLamarr::TemporaryTable`.
+
+  The `materialization` strategy defines how the output is produced:
+   * `"copy"` (default): the table content is replaced at each execution;
+   * `"view"`: a view is created, evaluated each time it is read. Not suited
+     to random queries or to tables read by several consumers;
+   * `"recreate"`: the table is dropped and created again from the query;
+   * `"incremental"`: the rows of the events loaded since the previous 
+     execution are appended. The queries must select the events with
+     `genevent_id BETWEEN :first_genevent_id AND :last_genevent_id`.
   """
 
   def __init__ (
@@ -37,6 +51,7 @@ class TemporaryTable:
       outputs: List[str],
       query: Union[str, List[str]],
       make_persistent: bool = False,
+      materialization: str = "copy",
       ):
     """
     Acquires the reference to an open connection to the DB and configure the
@@ -46,11 +61,15 @@ class TemporaryTable:
     @param output_table: name of the table where the query output is stored;
     @param outputs: list of the output column names for further reference;
     @param query: SQL query (or queries) defining the output columns;
-    @param make_persistent: mark the TABLE as persistent.
+    @param make_persistent: mark the TABLE as persistent;
+    @param materialization: "copy", "view", "recreate" or "incremental".
     """
     if isinstance(query, str):
       query = [query]
 
+    if materialization not in MATERIALIZATIONS:
+      raise ValueError(f"Invalid materialization {materialization}")
+
     self._self = clib.new_TemporaryTable(
         db.get(),
         output_table.encode('ascii'),
@@ -58,6 +77,11 @@ class TemporaryTable:
         ";".join([q.replace(";", " ") for q in query]).encode('ascii'),
         make_persistent,
         )
+
+    clib.TemporaryTable_set_materialization(
+        self._self, MATERIALIZATIONS[materialization])
+    clib.Transformer_set_incremental(
+        self._self, materialization == "incremental")
   
   def __del__(self):
     """@private: Release the bound class instance"""
@@ -23,6 +23,8 @@ class c_TransformerPtr (ctypes.Structure):
 ## Setup the version of the python package by reading the version of the CDLL
 clib.get_version.restype = ctypes.c_char_p
 clib.del_Transformer.argtypes = (c_TransformerPtr,)
+clib.Transformer_set_incremental.argtypes = (c_TransformerPtr, ctypes.c_bool)
+clib.Transformer_set_incremental.restype = ctypes.c_int
 version = str(clib.get_version(), "ascii")
 
 ## Database 
@@ -30,6 +32,9 @@ from SQLamarr.db_functions import SQLite3DB
 
 ## DataLoaders
 from SQLamarr.HepMC2DataLoader import HepMC2DataLoader
+from SQLamarr.HepMC3DataLoader import HepMC3DataLoader
+from SQLamarr.SyntheticDataLoader import SyntheticDataLoader
+from SQLamarr.BinaryDataLoader import BinaryDataLoader
 
 ## Transformers
 from SQLamarr.PVFinder import PVFinder
@@ -37,10 +42,12 @@ from SQLamarr.MCParticleSelector import MCParticleSelector
 from SQLamarr.PVReconstruction import PVReconstruction
 from SQLamarr.Plugin import Plugin
 from SQLamarr.GenerativePlugin import GenerativePlugin
+from SQLamarr.MultiModelPlugin import MultiModelPlugin
 from SQLamarr.TemporaryTable import TemporaryTable
 from SQLamarr.CleanEventStore import CleanEventStore
 from SQLamarr.EditEventStore import EditEventStore
 from SQLamarr.UpdateDBConnection import UpdateDBConnection
+from SQLamarr.ArrowWriter import ArrowWriter
 
 ## Python Transfomer
 from SQLamarr.PyTransformer import PyTransformer
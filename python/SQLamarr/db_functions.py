@@ -7,11 +7,14 @@
 # granted to it by virtue of its status as an Intergovernmental Organization
 # or submit itself to any jurisdiction.
 
+import os
 import ctypes
 from ctypes import POINTER
 from SQLamarr import clib
 import sqlite3
 import contextlib
+import re
+from typing import Dict, List, Optional
 
 clib.make_database.argtypes = (POINTER(ctypes.c_char),)
 clib.make_database.restype = ctypes.c_void_p
@@ -20,6 +23,79 @@ clib.del_database.argtypes = (ctypes.c_void_p,)
 
 clib.GlobalPRNG_get_or_create.argtypes = (ctypes.c_void_p, ctypes.c_int)
 
+clib.flush_database.argtypes = (ctypes.c_void_p,)
+clib.flush_database.restype = ctypes.c_int
+
+clib.enable_wal_mode.argtypes = (ctypes.c_void_p, ctypes.c_int)
+clib.enable_wal_mode.restype = ctypes.c_int
+
+clib.checkpoint_database.argtypes = (ctypes.c_void_p, ctypes.c_int)
+clib.checkpoint_database.restype = ctypes.c_int
+
+clib.attach_columnar_event_store.argtypes = (ctypes.c_void_p,)
+clib.attach_columnar_event_store.restype = ctypes.c_int
+
+clib.attach_hepmc2_file.argtypes = (
+    ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p)
+clib.attach_hepmc2_file.restype = ctypes.c_int
+
+clib.merge_databases.argtypes = (
+    ctypes.c_void_p,                    # void* db
+    ctypes.c_int,                       # int n_inputs
+    POINTER(ctypes.c_char_p),           # const char** input_paths
+    ctypes.c_int,                       # int n_tables
+    POINTER(ctypes.c_char_p),           # const char** tables
+    )
+clib.merge_databases.restype = ctypes.c_int
+
+clib.new_QueryReader.argtypes = (ctypes.c_void_p, ctypes.c_char_p)
+clib.new_QueryReader.restype = ctypes.c_void_p
+
+clib.del_QueryReader.argtypes = (ctypes.c_void_p,)
+
+clib.QueryReader_column_count.argtypes = (ctypes.c_void_p,)
+clib.QueryReader_column_count.restype = ctypes.c_int
+
+clib.QueryReader_column_name.argtypes = (ctypes.c_void_p, ctypes.c_int)
+clib.QueryReader_column_name.restype = ctypes.c_char_p
+
+clib.QueryReader_column_dtype.argtypes = (ctypes.c_void_p, ctypes.c_int)
+clib.QueryReader_column_dtype.restype = ctypes.c_int
+
+clib.QueryReader_fetch.argtypes = (
+    ctypes.c_void_p,                    # void* self
+    ctypes.c_int,                       # int n_columns
+    POINTER(ctypes.c_int),              # const int* dtypes
+    POINTER(ctypes.c_void_p),           # void** buffers
+    POINTER(ctypes.c_void_p),           # uint8_t** masks
+    ctypes.c_int64,                     # int64_t capacity
+    )
+clib.QueryReader_fetch.restype = ctypes.c_int64
+
+clib.bulk_insert.argtypes = (
+    ctypes.c_void_p,                    # void* db
+    ctypes.c_char_p,                    # const char* table
+    ctypes.c_char_p,                    # const char* columns
+    ctypes.c_int,                       # int n_columns
+    POINTER(ctypes.c_int),              # const int* dtypes
+    POINTER(ctypes.c_void_p),           # void** buffers
+    POINTER(ctypes.c_void_p),           # const uint8_t** masks
+    ctypes.c_int64,                     # int64_t n_rows
+    )
+clib.bulk_insert.restype = ctypes.c_int64
+
+## Checkpoint modes, as SQLITE_CHECKPOINT_* in sqlite3.h
+CHECKPOINT_MODES = {'passive': 0, 'full': 1, 'restart': 2, 'truncate': 3}
+
+## Buffer type codes, as defined in python_bindings.cpp
+BUFFER_DTYPES = {0: 'float64', 1: 'int64'}
+
+
+def _validate_token(token: str):
+    """@private: Python equivalent of SQLamarr::validate_token"""
+    if re.fullmatch(r"[A-Za-z0-9_]+", token) is None:
+        raise ValueError(f"Invalid token {token}")
+
 
 class SQLite3DB:
     """
@@ -81,6 +157,173 @@ class SQLite3DB:
         clib.GlobalPRNG_get_or_create(self._pointer, seed)
         return self
 
+    def flush(self):
+        """
+        Write the pages modified through the C++ connection to disk, without
+        closing and re-opening the connection.
+
+        @returns SQLite3DB (self) instance
+        """
+        if clib.flush_database(self._pointer) != 0:
+            raise RuntimeError("Failed flushing the database")
+        return self
+
+    def enable_wal(self, autocheckpoint: Optional[int] = None):
+        """
+        Switch a file-backed database to the write-ahead log journal, so 
+        that other connections, in this or in other processes, can read 
+        the committed data (see `snapshot`) while the C++ connection keeps 
+        writing, without blocking each other.
+
+        @param autocheckpoint: size of the log (in pages) triggering an 
+          automatic checkpoint when committing, 0 to checkpoint only with 
+          `checkpoint` (or the `checkpoint_every` option of `Pipeline`), 
+          None to keep the SQLite default.
+
+        @returns SQLite3DB (self) instance
+        """
+        if clib.enable_wal_mode(
+            self._pointer, -1 if autocheckpoint is None else autocheckpoint
+            ) != 0:
+            raise RuntimeError(f"Failed enabling the write-ahead log for {self._path}")
+        return self
+
+    def checkpoint(self, mode: str = "passive") -> bool:
+        """
+        Copy the content of the write-ahead log into the database file.
+
+        @param mode: one of "passive" (never waiting for other connections),
+          "full", "restart" or "truncate" (see the SQLite documentation of
+          `sqlite3_wal_checkpoint_v2`).
+
+        @returns True if the whole log was checkpointed, False if readers 
+          using older snapshots prevented it.
+        """
+        if mode not in CHECKPOINT_MODES:
+            raise ValueError(f"Invalid checkpoint mode {mode}")
+
+        ret = clib.checkpoint_database(self._pointer, CHECKPOINT_MODES[mode])
+        if ret < 0:
+            raise RuntimeError("Failed checkpointing the database")
+        return ret == 1
+
+    @contextlib.contextmanager
+    def snapshot(self):
+        """
+        Read-only Python connection to a file-backed database, bound to a
+        consistent snapshot of the committed data for the whole block.
+
+        Unlike `connect`, the connection does not share the cache with 
+        other connections of the process. With the write-ahead log enabled
+        (see `enable_wal`), the C++ pipeline keeps writing while the 
+        snapshot is open.
+
+        Example.
+        ```python
+        db = SQLamarr.SQLite3DB("production.db").enable_wal()
+        ...
+        with db.snapshot() as c:
+          df = pandas.read_sql_query("SELECT * FROM MCParticles", c)
+        ```
+        """
+        base, _, query = self._path.partition('?')
+        options = [o for o in query.split('&') if o != '' and 
+            o.split('=')[0] not in ('cache', 'mode')]
+        if 'mode=memory' in query or base in ("file::memory:", "file:"):
+            raise NotImplementedError("Cannot snapshot an in-memory database")
+
+        uri = f"{base}?{'&'.join(options + ['mode=ro', 'cache=private'])}"
+        db = sqlite3.connect(uri, uri=True, isolation_level=None)
+        try:
+            # The snapshot is taken at the first read of the transaction
+            db.execute("BEGIN")
+            db.execute("SELECT COUNT(*) FROM sqlite_master").fetchone()
+            yield db
+        finally:
+            db.close()
+
+    def use_columnar_event_store(self):
+        """
+        Replace the `GenParticles` and `GenVertices` tables of the C++
+        connection with in-memory columnar tables, avoiding the cost of
+        B-tree insertions and lookups when loading and processing the
+        generator-level data.
+
+        The columnar tables are visible only to the C++ connection: use
+        `query_to_numpy` rather than `connect()` to read them from Python.
+
+        @returns SQLite3DB (self) instance
+        """
+        if clib.attach_columnar_event_store(self._pointer) != 0:
+            raise RuntimeError("Failed attaching the columnar event store")
+        return self
+
+    def attach_hepmc2_file(self, file_path: str, prefix: str = "HepMC"):
+        """
+        Expose an HepMC2 ASCII file to the C++ connection as the read-only
+        tables `temp.<prefix>Events`, `temp.<prefix>Vertices` and
+        `temp.<prefix>Particles`, with the same columns as `GenEvents`,
+        `GenVertices` and `GenParticles`.
+
+        Events are parsed only when a query reaches them, so that selecting
+        a subset of the events by `genevent_id` (the index of the event in 
+        the file, starting from 1) does not require loading the whole file.
+
+        Example.
+        ```python
+        db = SQLamarr.SQLite3DB().attach_hepmc2_file("evt.mc2", "File")
+        columns = db.query_to_numpy(
+            "SELECT * FROM FileParticles WHERE genevent_id = 3")
+        ```
+
+        @param file_path: path to the HepMC2 ASCII file
+        @param prefix: prefix of the names of the tables
+
+        @returns SQLite3DB (self) instance
+        """
+        if not os.path.exists(file_path):
+            raise FileNotFoundError(file_path)
+
+        if clib.attach_hepmc2_file(
+            self._pointer, file_path.encode('utf-8'), prefix.encode('ascii')
+            ) != 0:
+            raise RuntimeError(f"Failed attaching {file_path}")
+        return self
+
+    def merge(self, input_paths: List[str], tables: Optional[List[str]] = None):
+        """
+        Append the tables of other databases, for example the output of 
+        independent jobs, shifting the identifiers of the event store 
+        (`genevent_id`, `mcparticle_id`, ...) after those already stored, 
+        so that the references among the tables remain consistent.
+
+        Example.
+        ```python
+        merged = SQLamarr.SQLite3DB("file:merged.db")
+        merged.merge(["job1.db", "job2.db", "job3.db"])
+        ```
+
+        @param input_paths: paths to the databases to merge
+        @param tables: names of the tables to copy, all the tables if None
+
+        @returns SQLite3DB (self) instance
+        """
+        for input_path in input_paths:
+            if not os.path.exists(input_path):
+                raise FileNotFoundError(input_path)
+
+        tables = tables or []
+        inputs = (ctypes.c_char_p * len(input_paths))(
+            *[p.encode('utf-8') for p in input_paths])
+        names = (ctypes.c_char_p * len(tables))(
+            *[t.encode('ascii') for t in tables])
+
+        if clib.merge_databases(
+            self._pointer, len(input_paths), inputs, len(tables), names
+            ) != 0:
+            raise RuntimeError("Failed merging the databases")
+        return self
+
     @contextlib.contextmanager
     def connect(self):
         """
@@ -111,3 +354,182 @@ class SQLite3DB:
 
         with sqlite3.connect(self._path, uri=True) as db:
             yield db
+
+    def query_to_numpy(
+            self,
+            query: str,
+            dtypes: Optional[Dict[str, str]] = None,
+            chunk_size: int = 65536
+            ):
+        """
+        Execute a query on the C++ connection and return its output as a
+        dictionary of numpy arrays, one per column.
+
+        Rows are copied by the C++ library directly into the numpy buffers,
+        without converting each field into a Python object.
+
+        @param query: SQL SELECT statement;
+        @param dtypes: optional mapping of column names to either `'float64'`
+          or `'int64'`. By default, columns declared with an integer type are
+          read as `int64`, and all the others (including expressions)
+          as `float64` with `NaN` representing `NULL`. Integer columns
+          containing `NULL` values are returned as `numpy.ma.MaskedArray`,
+          with the `NULL` values masked;
+        @param chunk_size: number of rows of the first buffer. If the query
+          returns more rows, further buffers of increasing size are allocated
+          and concatenated.
+
+        @returns Dictionary of numpy arrays, which can be passed as it is to
+          the constructor of a pandas DataFrame.
+
+        Example.
+        ```python
+        db = SQLamarr.SQLite3DB()
+        ...
+        columns = db.query_to_numpy("SELECT mcparticle_id, px, py FROM MCParticles")
+        df = pandas.DataFrame(columns)
+        ```
+        """
+        import numpy as np
+        codes = {v: k for k, v in BUFFER_DTYPES.items()}
+        dtypes = dtypes if dtypes is not None else dict()
+
+        reader = clib.new_QueryReader(self._pointer, query.encode('ascii'))
+        if not reader:
+            raise RuntimeError(f"Failed preparing query:\n{query}")
+
+        try:
+            n_columns = clib.QueryReader_column_count(reader)
+            names = [
+                str(clib.QueryReader_column_name(reader, iCol), 'ascii')
+                for iCol in range(n_columns)
+            ]
+            column_dtypes = [
+                dtypes.get(name, BUFFER_DTYPES[clib.QueryReader_column_dtype(reader, iCol)])
+                for iCol, name in enumerate(names)
+            ]
+            c_dtypes = (ctypes.c_int * n_columns)(*[codes[d] for d in column_dtypes])
+
+            chunks, mask_chunks = [], []
+            capacity = chunk_size
+            while True:
+                arrays = [np.empty(capacity, dtype=d) for d in column_dtypes]
+                masks = [
+                    np.zeros(capacity, dtype='bool') if d == 'int64' else None 
+                    for d in column_dtypes
+                ]
+                buffers = (ctypes.c_void_p * n_columns)(*[a.ctypes.data for a in arrays])
+                c_masks = (ctypes.c_void_p * n_columns)(
+                    *[None if m is None else m.ctypes.data for m in masks])
+                n_rows = clib.QueryReader_fetch(
+                    reader, n_columns, c_dtypes, buffers, c_masks, capacity)
+                if n_rows < 0:
+                    raise RuntimeError(f"Failed executing query:\n{query}")
+
+                chunks.append([a[:n_rows] for a in arrays])
+                mask_chunks.append([None if m is None else m[:n_rows] for m in masks])
+                if n_rows < capacity:
+                    break
+                capacity *= 2
+        finally:
+            clib.del_QueryReader(reader)
+
+        ret = dict()
+        for iCol, name in enumerate(names):
+            if len(chunks) == 1:
+                array, mask = chunks[0][iCol], mask_chunks[0][iCol]
+            else:
+                array = np.concatenate([chunk[iCol] for chunk in chunks])
+                mask = None if mask_chunks[0][iCol] is None else np.concatenate(
+                    [chunk[iCol] for chunk in mask_chunks])
+
+            # Integer columns are masked only if they contain NULL values
+            if mask is not None and mask.any():
+                array = np.ma.MaskedArray(array, mask=mask)
+            ret[name] = array
+
+        return ret
+
+    def table_to_numpy(self, table: str, dtypes: Optional[Dict[str, str]] = None):
+        """
+        Read a whole table from the C++ connection as a dictionary of numpy arrays.
+
+        @param table: name of the table (must be alphanumeric);
+        @param dtypes: optional mapping of column names to numpy dtypes
+          (see `query_to_numpy`).
+        """
+        _validate_token(table)
+        return self.query_to_numpy(f"SELECT * FROM {table}", dtypes)
+
+    def insert_numpy(self, table: str, columns: Dict[str, "numpy.ndarray"]):
+        """
+        Append the content of numpy arrays to a table through the C++ connection.
+
+        All the rows are inserted with a single prepared statement within a
+        savepoint, nested in the open transaction if any, and rolled back if
+        any insertion fails. If the table does not exist, it is created with
+        `INTEGER` or `REAL` columns depending on the array types.
+
+        @param table: name of the target table (must be alphanumeric);
+        @param columns: mapping of column names (must be alphanumeric) to
+          one-dimensional arrays of equal length. Integer and boolean arrays are
+          stored as `int64`, all the others as `float64` with `NaN` mapped to `NULL`.
+          The masked values of `numpy.ma.MaskedArray`s are stored as `NULL`.
+
+        @returns Number of inserted rows.
+
+        Example.
+        ```python
+        db.insert_numpy("Calibration", dict(
+            run=np.array([1, 2, 3]),
+            scale=np.array([1.01, 0.99, 1.00]),
+            ))
+        ```
+        """
+        import numpy as np
+        codes = {v: k for k, v in BUFFER_DTYPES.items()}
+
+        _validate_token(table)
+        for name in columns.keys():
+            _validate_token(name)
+
+        arrays = [
+            np.ascontiguousarray(
+                np.ma.getdata(a), 
+                dtype='int64' if np.asarray(a).dtype.kind in 'biu' else 'float64'
+                )
+            for a in columns.values()
+        ]
+        masks = [
+            None if np.ma.getmask(a) is np.ma.nomask 
+            else np.ascontiguousarray(np.ma.getmaskarray(a), dtype='bool')
+            for a in columns.values()
+        ]
+        if len(arrays) == 0:
+            return 0
+
+        n_rows = len(arrays[0])
+        if any(a.ndim != 1 or len(a) != n_rows for a in arrays):
+            raise ValueError("Arrays must be one-dimensional and of equal length")
+
+        n_columns = len(arrays)
+        c_dtypes = (ctypes.c_int * n_columns)(*[codes[str(a.dtype)] for a in arrays])
+        buffers = (ctypes.c_void_p * n_columns)(*[a.ctypes.data for a in arrays])
+        c_masks = (ctypes.c_void_p * n_columns)(
+            *[None if m is None else m.ctypes.data for m in masks])
+
+        ret = clib.bulk_insert(
+            self._pointer,
+            table.encode('ascii'),
+            ";".join(columns.keys()).encode('ascii'),
+            n_columns,
+            c_dtypes,
+            buffers,
+            c_masks,
+            n_rows
+            )
+
+        if ret < 0:
+            raise RuntimeError(f"Failed inserting data in table {table}")
+
+        return ret
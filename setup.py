@@ -15,8 +15,9 @@ ext = Extension(
     sources=[f for f in glob("src/*.cpp") if "main" not in f],
     include_dirs=["include"],
     language="c++" ,
-    libraries=["m", "dl", "HepMC3", "sqlite3"],
-    extra_compile_args=["-std=c++11"],
+    libraries=["m", "dl", "z", "HepMC3", "sqlite3"],
+    extra_compile_args=["-std=c++11", "-pthread"],
+    extra_link_args=["-pthread"],
     )
 
 setup(ext_modules=[ext])
@@ -9,11 +9,16 @@
 
 
 // STL
+#include <exception>
 #include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 // Local
 #include "SQLamarr/AbsDataLoader.h"
 #include "SQLamarr/db_functions.h"
+#include "SQLamarr/SQLiteError.h"
 #include "SQLamarr/preprocessor_symbols.h"
 
 namespace SQLamarr
@@ -86,6 +91,21 @@ namespace SQLamarr
       bool is_primary
       )
   {
+    ColumnarTable* columnar = columnar_table(false);
+    if (columnar)
+    {
+      ColumnarTable::Value values[8];
+      values[0].i = genevent_id;
+      values[1].i = hepmc_id;
+      values[2].i = status;
+      values[3].d = t;
+      values[4].d = x;
+      values[5].d = y;
+      values[6].d = z;
+      values[7].i = is_primary;
+      return columnar->append(values);
+    }
+
     sqlite3_stmt* stmt = get_statement ("insert_vertex",
         "INSERT INTO GenVertices"
         "  (genevent_id, hepmc_id, status, x, y, z, t, is_primary) "
@@ -123,6 +143,26 @@ namespace SQLamarr
       float m
       )
   {
+    ColumnarTable* columnar = columnar_table(true);
+    if (columnar)
+    {
+      ColumnarTable::Value values[11];
+      values[0].i = genevent_id;
+      values[1].i = hepmc_id;
+      values[2].i = (production_vertex != LAMARR_BAD_INDEX) ? 
+        production_vertex : ColumnarTable::null_integer;
+      values[3].i = (end_vertex != LAMARR_BAD_INDEX) ? 
+        end_vertex : ColumnarTable::null_integer;
+      values[4].i = pid;
+      values[5].i = status;
+      values[6].d = pe;
+      values[7].d = px;
+      values[8].d = py;
+      values[9].d = pz;
+      values[10].d = m;
+      return columnar->append(values);
+    }
+
     sqlite3_stmt* stmt = get_statement ("insert_particle", R"(
         INSERT INTO GenParticles(
             genevent_id, hepmc_id, 
@@ -161,6 +201,379 @@ namespace SQLamarr
 
     return last_insert_row();
   }
-}
 
+  //==========================================================================
+  // VertexMapping: reset
+  //==========================================================================
+  void AbsDataLoader::VertexMapping::reset (HepMC3::GenEvent& evt)
+  {
+    const size_t n_vertices = evt.vertices().size();
+    m_rows.assign(n_vertices, LAMARR_BAD_INDEX);
+    m_primary.assign(n_vertices, 0);
+
+    for (const auto& bp: evt.beams())
+    {
+      const HepMC3::GenVertex* vertex = bp->end_vertex().get();
+      if (vertex && vertex->id() < 0 && size_t(-vertex->id()) <= n_vertices)
+        m_primary[-vertex->id() - 1] = 1;
+    }
+  }
+
+  //==========================================================================
+  // insert_hepmc_collision
+  //==========================================================================
+  int AbsDataLoader::insert_hepmc_collision (
+      int datasource_id,
+      HepMC3::GenEvent& evt
+      )
+  {
+    auto pos = evt.event_pos();
+    const int event_id = insert_collision(
+        datasource_id,
+        evt.event_number(),
+        pos.t(),
+        pos.x(),
+        pos.y(),
+        pos.z()
+        );
+
+    m_vertex_mapping.reset(evt);
+    for (const auto& vertex: evt.vertices())
+    {
+      const int hepmc_id = vertex->id();
+      const HepMC3::FourVector& position = vertex->position();
+      m_vertex_mapping[hepmc_id] = insert_vertex(
+            event_id,
+            hepmc_id,
+            vertex->status(),
+            position.t(),
+            position.x(),
+            position.y(),
+            position.z(),
+            m_vertex_mapping.is_primary(hepmc_id)
+          );
+    }
+
+    for (const auto& particle: evt.particles())
+    {
+      const HepMC3::GenVertex* pv = particle->production_vertex().get();
+      const HepMC3::GenVertex* ev = particle->end_vertex().get();
+      const HepMC3::FourVector& momentum = particle->momentum();
+
+      insert_particle(
+            event_id,
+            particle->id(),
+            (pv ? m_vertex_mapping[pv->id()] : LAMARR_BAD_INDEX),
+            (ev ? m_vertex_mapping[ev->id()] : LAMARR_BAD_INDEX),
+            particle->pid(),
+            particle->status(),
+            momentum.e(),
+            momentum.px(),
+            momentum.py(),
+            momentum.pz(),
+            particle->generated_mass()
+          );
+    }
+
+    return event_id;
+  }
+
+  //==========================================================================
+  // load_hepmc_events
+  //==========================================================================
+  void AbsDataLoader::load_hepmc_events (
+      HepMC3::Reader& reader,
+      const std::string& data_source,
+      size_t run_number,
+      size_t evt_number,
+      size_t skip_events,
+      size_t max_events
+      )
+  {
+    if (skip_events > 0)
+      reader.skip(skip_events);
+
+    // The reader clears the GenEvent, reusing its buffers across collisions
+    HepMC3::GenEvent evt(HepMC3::Units::MEV, HepMC3::Units::MM);
+    if (max_events > 0)
+      reader.read_event(evt);
+
+    // No data source is recorded for a range past the end of the file
+    if (max_events == 0 || reader.failed())
+      return;
+
+    begin_transaction();
+    try
+    {
+      const int ds_id = insert_event(data_source, run_number, evt_number);
+      insert_hepmc_collision(ds_id, evt);
+
+      for (size_t iEvent = 1; iEvent < max_events && !reader.failed(); ++iEvent)
+      {
+        reader.read_event(evt);
+        if (reader.failed())
+          break;
+
+        insert_hepmc_collision(ds_id, evt);
+      }
+    }
+    catch (...)
+    {
+      // The rows inserted so far are discarded with the transaction
+      reset_statements();
+      rollback_transaction();
+      throw;
+    }
+
+    end_transaction();
+  }
+
+  //==========================================================================
+  // load_many
+  //==========================================================================
+  void AbsDataLoader::load_many (
+      const std::vector<std::string>& file_paths,
+      size_t run_number,
+      size_t first_evt_number,
+      unsigned int n_threads
+      )
+  {
+    if (n_threads == 0)
+      n_threads = std::thread::hardware_concurrency();
+    if (n_threads > file_paths.size())
+      n_threads = file_paths.size();
+
+    // Each thread loads a contiguous slice of the list in a shared-cache
+    // in-memory database, which the main connection can attach
+    std::vector<std::string> uris;
+    std::vector<SQLite3DB> shards;
+    std::vector<std::unique_ptr<AbsDataLoader> > loaders;
+    shards.reserve(n_threads); // loaders keep references to the elements
+    for (unsigned int iThread = 0; n_threads > 1 && iThread < n_threads; ++iThread)
+    {
+      std::stringstream uri;
+      uri << "file:sqlamarr_shard_" << this << "_" << iThread 
+          << "?mode=memory&cache=shared";
+      uris.push_back(uri.str());
+      shards.push_back(make_database(uris.back()));
+      loaders.push_back(clone(shards.back()));
+      if (!loaders.back())
+        break;
+    }
+
+    if (loaders.size() < 2 || !loaders.back())
+    {
+      size_t evt_number = first_evt_number;
+      for (const std::string& file_path: file_paths)
+        load(file_path, run_number, evt_number++);
+      return;
+    }
+
+    std::vector<std::exception_ptr> errors (n_threads);
+    std::vector<std::thread> threads;
+    for (unsigned int iThread = 0; iThread < n_threads; ++iThread)
+    {
+      const size_t begin = file_paths.size() * iThread / n_threads;
+      const size_t end = file_paths.size() * (iThread + 1) / n_threads;
+      AbsDataLoader* loader = loaders[iThread].get();
+      std::exception_ptr* error = &errors[iThread];
+
+      threads.push_back(std::thread(
+          [loader, error, &file_paths, begin, end, run_number, first_evt_number]()
+          {
+            try
+            {
+              for (size_t iFile = begin; iFile < end; ++iFile)
+                loader->load(file_paths[iFile], run_number, first_evt_number + iFile);
+              loader->reset_statements();
+            }
+            catch (...)
+            {
+              *error = std::current_exception();
+            }
+          }));
+    }
+
+    for (std::thread& thread: threads)
+      thread.join();
+
+    for (const std::exception_ptr& error: errors)
+      if (error)
+        std::rethrow_exception(error);
+
+    for (unsigned int iThread = 0; iThread < n_threads; ++iThread)
+    {
+      merge_database(uris[iThread]);
+      loaders[iThread].reset();
+      shards[iThread].reset();
+    }
+  }
+
+  //==========================================================================
+  // merge_database
+  //==========================================================================
+  void AbsDataLoader::merge_database (const std::string& uri)
+  {
+    sqlite3* db = m_database.get();
+    const std::string attach = "ATTACH DATABASE '" + uri + "' AS sqlamarr_shard";
+    if (sqlite3_exec(db, attach.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db) << std::endl;
+      throw SQLiteError("Failed attaching a temporary database");
+    }
+
+    bool in_transaction = false;
+    try
+    {
+      ColumnarTable* columnar_vertices = columnar_table(false);
+      ColumnarTable* columnar_particles = columnar_table(true);
+
+      const sqlite3_int64 datasource_offset = 
+        last_id("DataSources", "datasource_id");
+      const sqlite3_int64 genevent_offset = last_id("GenEvents", "genevent_id");
+      const sqlite3_int64 genvertex_offset = columnar_vertices ?
+        columnar_vertices->next_id() - 1 : 
+        last_id("GenVertices", "genvertex_id");
+      const sqlite3_int64 genparticle_offset = columnar_particles ? 
+        columnar_particles->next_id() - 1 : 
+        last_id("GenParticles", "genparticle_id");
+
+      const char* queries[][2] = {
+        {"merge_datasources", R"(
+          INSERT INTO DataSources
+            (datasource_id, datasource, run_number, evt_number)
+          SELECT datasource_id + :datasource, datasource, run_number, evt_number
+          FROM sqlamarr_shard.DataSources
+          ORDER BY datasource_id
+        )"},
+        {"merge_genevents", R"(
+          INSERT INTO GenEvents
+            (genevent_id, collision, datasource_id, t, x, y, z)
+          SELECT 
+            genevent_id + :genevent, collision, datasource_id + :datasource, 
+            t, x, y, z
+          FROM sqlamarr_shard.GenEvents
+          ORDER BY genevent_id
+        )"},
+        {"merge_genvertices", R"(
+          INSERT INTO GenVertices
+            (genvertex_id, genevent_id, hepmc_id, status, t, x, y, z, is_primary)
+          SELECT 
+            genvertex_id + :genvertex, genevent_id + :genevent, hepmc_id, 
+            status, t, x, y, z, is_primary
+          FROM sqlamarr_shard.GenVertices
+          ORDER BY genvertex_id
+        )"},
+        {"merge_genparticles", R"(
+          INSERT INTO GenParticles
+            (genparticle_id, genevent_id, hepmc_id, 
+             production_vertex, end_vertex, pid, status, pe, px, py, pz, m)
+          SELECT 
+            genparticle_id + :genparticle, genevent_id + :genevent, hepmc_id,
+            production_vertex + :genvertex, end_vertex + :genvertex,
+            pid, status, pe, px, py, pz, m
+          FROM sqlamarr_shard.GenParticles
+          ORDER BY genparticle_id
+        )"}
+      };
+
+      begin_transaction();
+      in_transaction = true;
+      for (auto& query: queries)
+      {
+        sqlite3_stmt* stmt = get_statement(query[0], query[1]);
+        const std::pair<const char*, sqlite3_int64> offsets[] = {
+          {":datasource", datasource_offset},
+          {":genevent", genevent_offset},
+          {":genvertex", genvertex_offset},
+          {":genparticle", genparticle_offset}
+        };
+
+        for (auto& offset: offsets)
+        {
+          const int iParam = sqlite3_bind_parameter_index(stmt, offset.first);
+          if (iParam > 0)
+            sqlite3_bind_int64(stmt, iParam, offset.second);
+        }
+
+        exec_stmt(stmt);
+      }
+      in_transaction = false;
+      end_transaction();
+    }
+    catch (...)
+    {
+      // The shard is detached, as by merge_databases, before rethrowing
+      reset_statements();
+      if (in_transaction)
+        rollback_transaction();
+      sqlite3_exec(db, "DETACH DATABASE sqlamarr_shard", 
+          nullptr, nullptr, nullptr);
+      throw;
+    }
+
+    reset_statements();
+    if (sqlite3_exec(db, "DETACH DATABASE sqlamarr_shard", 
+          nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db) << std::endl;
+      throw SQLiteError("Failed detaching a temporary database");
+    }
+  }
+
+  //==========================================================================
+  // last_id
+  //==========================================================================
+  sqlite3_int64 AbsDataLoader::last_id (
+      const std::string& table, 
+      const std::string& id
+      )
+  {
+    // AUTOINCREMENT identifiers of deleted rows are not reused
+    sqlite3_stmt* stmt = get_statement("last_id_" + table, 
+        "SELECT MAX("
+        "  IFNULL((SELECT seq FROM main.sqlite_sequence WHERE name = '" 
+        + table + "'), 0), "
+        "  IFNULL((SELECT MAX(" + id + ") FROM " + table + "), 0)"
+        ")"
+        );
+
+    if (!exec_stmt(stmt))
+      throw SQLiteError("Failed retrieving the last identifier of " + table);
 
+    const sqlite3_int64 ret = sqlite3_column_int64(stmt, 0);
+    sqlite3_reset(stmt);
+    return ret;
+  }
+
+  //==========================================================================
+  // columnar_table
+  //==========================================================================
+  ColumnarTable* AbsDataLoader::columnar_table (bool particles)
+  {
+    if (m_database.get() != m_columnar_db || 
+        ColumnarEventStore::generation() != m_columnar_generation)
+    {
+      m_columnar_db = m_database.get();
+      m_columnar_generation = ColumnarEventStore::generation();
+      m_columnar_store = ColumnarEventStore::get(m_columnar_db);
+    }
+
+    if (m_columnar_store == nullptr)
+      return nullptr;
+
+    ColumnarTable& table = particles ? 
+      m_columnar_store->particles() : m_columnar_store->vertices();
+
+    if (!table.created())
+      return nullptr;
+
+    // The rows appended directly are reverted with the open transaction 
+    // only if the virtual table joined it, as done by a writing statement
+    if (!table.in_transaction() && !sqlite3_get_autocommit(m_database.get()))
+      exec_stmt(get_statement("enroll_" + table.name(), 
+            "DELETE FROM temp." + table.name() + " WHERE 0"));
+
+    return &table;
+  }
+}
@@ -0,0 +1,626 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// STL
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+// SQLamarr
+#include "SQLamarr/ArrowWriter.h"
+
+namespace
+{
+  // Identifiers defined in the flatbuffers schemas of the Arrow format
+  // (Schema.fbs, Message.fbs and File.fbs)
+  const int16_t METADATA_V5 = 4;
+  const uint8_t TYPE_INT = 2;
+  const uint8_t TYPE_FLOATING_POINT = 3;
+  const uint8_t TYPE_UTF8 = 5;
+  const int16_t PRECISION_DOUBLE = 2;
+  const uint8_t HEADER_SCHEMA = 1;
+  const uint8_t HEADER_RECORD_BATCH = 3;
+
+  const char ARROW_MAGIC[8] = "ARROW1";
+  const uint32_t CONTINUATION = 0xFFFFFFFF;
+
+  /** Minimal builder of flatbuffers, as used by the Arrow metadata.
+   *
+   * As in the reference implementation, the buffer is built back to front,
+   * so that the objects are created before the tables referring to them
+   * with (positive) offsets. References are the distances of the objects
+   * from the end of the buffer, whose size is eventually padded to a
+   * multiple of 8 bytes, so that aligning the distances aligns the objects.
+   */
+  class FlatBufferBuilder
+  {
+    public:
+      FlatBufferBuilder (): m_buffer(), m_fields(), m_table_start(0) {}
+
+      /// Current size, i.e. reference to the last object created
+      uint32_t size () const { return m_buffer.size(); }
+
+      /// Pad so that `n_bytes` prepended next end up aligned
+      void pad_for (size_t n_bytes, size_t alignment)
+      {
+        const size_t n_pad = (alignment - (size() + n_bytes) % alignment)
+          % alignment;
+        m_buffer.insert(0, n_pad, '\0');
+      }
+
+      /// Prepend raw bytes
+      void prepend_bytes (const void* data, size_t n_bytes)
+      { m_buffer.insert(0, reinterpret_cast<const char*>(data), n_bytes); }
+
+      /// Prepend an aligned scalar
+      template <class T>
+      void prepend (T value)
+      {
+        pad_for(sizeof(T), sizeof(T));
+        prepend_bytes(&value, sizeof(T));
+      }
+
+      /// Prepend an offset to a previously created object
+      void prepend_offset (uint32_t ref)
+      {
+        pad_for(sizeof(uint32_t), sizeof(uint32_t));
+        prepend<uint32_t>(size() + sizeof(uint32_t) - ref);
+      }
+
+      /// Create a null-terminated string
+      uint32_t create_string (const std::string& s)
+      {
+        pad_for(s.size() + 1, sizeof(uint32_t));
+        prepend_bytes(s.c_str(), s.size() + 1);
+        prepend<uint32_t>(s.size());
+        return size();
+      }
+
+      /// Create a vector of scalars or structs
+      uint32_t create_vector (
+          const void* data, size_t n, size_t elem_size, size_t alignment)
+      {
+        pad_for(n * elem_size, std::max(alignment, sizeof(uint32_t)));
+        prepend_bytes(data, n * elem_size);
+        prepend<uint32_t>(n);
+        return size();
+      }
+
+      /// Create a vector of tables or strings
+      uint32_t create_offset_vector (const std::vector<uint32_t>& refs)
+      {
+        for (auto ref = refs.rbegin(); ref != refs.rend(); ++ref)
+          prepend_offset(*ref);
+        prepend<uint32_t>(refs.size());
+        return size();
+      }
+
+      /// Start a table, whose fields must be added before any other object
+      void start_table ()
+      {
+        m_fields.clear();
+        m_table_start = size();
+      }
+
+      /// Add a scalar field to the current table
+      template <class T>
+      void add_field (uint16_t id, T value)
+      {
+        prepend<T>(value);
+        m_fields.push_back(std::make_pair(id, size()));
+      }
+
+      /// Add a field referring to a previously created object
+      void add_offset (uint16_t id, uint32_t ref)
+      {
+        prepend_offset(ref);
+        m_fields.push_back(std::make_pair(id, size()));
+      }
+
+      /// Complete the table with its vtable
+      uint32_t end_table ()
+      {
+        prepend<int32_t>(0);
+        const uint32_t table = size();
+
+        uint16_t n_fields = 0;
+        for (auto& field: m_fields)
+          n_fields = std::max<uint16_t>(n_fields, field.first + 1);
+
+        std::vector<uint16_t> vtable (2 + n_fields, 0);
+        vtable[0] = vtable.size() * sizeof(uint16_t);
+        vtable[1] = table - m_table_start;
+        for (auto& field: m_fields)
+          vtable[2 + field.first] = table - field.second;
+
+        prepend_bytes(vtable.data(), vtable.size() * sizeof(uint16_t));
+
+        // The table starts with the (signed) distance to its vtable
+        const int32_t vtable_offset = size() - table;
+        std::memcpy(&m_buffer[m_buffer.size() - table], &vtable_offset,
+            sizeof(int32_t));
+
+        return table;
+      }
+
+      /// Complete the buffer with the offset to the root table
+      std::string finish (uint32_t root)
+      {
+        pad_for(sizeof(uint32_t), 8);
+        prepend_offset(root);
+        return m_buffer;
+      }
+
+    private:
+      std::string m_buffer;
+      std::vector<std::pair<uint16_t, uint32_t> > m_fields;
+      uint32_t m_table_start;
+  };
+
+  //============================================================================
+  // arrow_type: Arrow type of an output column, from the SQLite type affinity.
+  // Columns without a declared type (expressions) are resolved from their 
+  // values, 0 is returned.
+  //============================================================================
+  uint8_t arrow_type (const char* declared)
+  {
+    std::string type (declared ? declared : "");
+    std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+
+    if (type.empty())
+      return 0;
+
+    if (type.find("INT") != std::string::npos)
+      return TYPE_INT;
+
+    if (type.find("CHAR") != std::string::npos ||
+        type.find("CLOB") != std::string::npos ||
+        type.find("TEXT") != std::string::npos)
+      return TYPE_UTF8;
+
+    return TYPE_FLOATING_POINT;
+  }
+
+  //============================================================================
+  // create_schema: Schema table describing a list of columns
+  //============================================================================
+  template <class Column>
+  uint32_t create_schema (FlatBufferBuilder& fbb, const std::vector<Column>& columns)
+  {
+    std::vector<uint32_t> fields;
+    for (const Column& column: columns)
+    {
+      const uint8_t type_id = static_cast<uint8_t>(column.type);
+      const uint32_t name = fbb.create_string(column.name);
+      const uint32_t children = fbb.create_offset_vector({});
+
+      fbb.start_table();
+      if (type_id == TYPE_INT)
+      {
+        fbb.add_field<int32_t>(0, 64);  // bitWidth
+        fbb.add_field<uint8_t>(1, 1);   // is_signed
+      }
+      else if (type_id == TYPE_FLOATING_POINT)
+        fbb.add_field<int16_t>(0, PRECISION_DOUBLE);
+      const uint32_t type = fbb.end_table();
+
+      fbb.start_table();
+      fbb.add_offset(0, name);
+      fbb.add_offset(3, type);
+      fbb.add_offset(5, children);
+      fbb.add_field<uint8_t>(1, 1);     // nullable
+      fbb.add_field<uint8_t>(2, type_id);
+      fields.push_back(fbb.end_table());
+    }
+
+    const uint32_t field_vector = fbb.create_offset_vector(fields);
+    fbb.start_table();
+    fbb.add_offset(1, field_vector);
+    return fbb.end_table();
+  }
+
+  //============================================================================
+  // padded: size rounded up to a multiple of 8 bytes
+  //============================================================================
+  size_t padded (size_t size)
+  {
+    return (size + 7) / 8 * 8;
+  }
+}
+
+namespace SQLamarr
+{
+  //============================================================================
+  // Constructor
+  //============================================================================
+  ArrowWriter::ArrowWriter (
+      SQLite3DB& db,
+      const std::string& file_path,
+      const std::string& query,
+      size_t batch_size
+      )
+    : BaseSqlInterface (db)
+    , m_file_path (file_path)
+    , m_query (query)
+    , m_batch_size (batch_size)
+    , m_file ()
+    , m_file_offset (0)
+    , m_closed (false)
+    , m_schema_written (false)
+    , m_failed (false)
+    , m_columns ()
+    , m_n_rows (0)
+    , m_batches ()
+  {
+    if (m_batch_size == 0)
+      throw std::logic_error("ArrowWriter: batch size must be positive");
+  }
+
+  //============================================================================
+  // Destructor
+  //============================================================================
+  ArrowWriter::~ArrowWriter ()
+  {
+    // Files never opened are not created at destruction, when the 
+    // database may be no longer available
+    try
+    {
+      if (m_file.is_open())
+        close();
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+    }
+  }
+
+  //============================================================================
+  // open
+  //============================================================================
+  void ArrowWriter::open ()
+  {
+    sqlite3_stmt* stmt = get_statement("query", m_query);
+    const int n_columns = sqlite3_column_count(stmt);
+
+    for (int iCol = 0; iCol < n_columns; ++iCol)
+    {
+      Column column = Column();
+      column.name = sqlite3_column_name(stmt, iCol);
+      column.type = static_cast<ColumnType>(
+          arrow_type(sqlite3_column_decltype(stmt, iCol)));
+      column.inferred = (column.type == Undefined);
+      column.offsets.push_back(0);
+      m_columns.push_back(column);
+    }
+
+    m_file.open(m_file_path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+      throw std::logic_error("ArrowWriter: cannot open " + m_file_path);
+
+    write_bytes(ARROW_MAGIC, sizeof(ARROW_MAGIC));
+  }
+
+  //============================================================================
+  // write_schema
+  //============================================================================
+  void ArrowWriter::write_schema ()
+  {
+    // Columns with NULL values only in the first batch are floating point
+    for (Column& column: m_columns)
+      if (column.type == Undefined)
+        set_type(column, Float64, m_n_rows);
+
+    m_schema_written = true;
+
+    FlatBufferBuilder fbb;
+    const uint32_t schema = create_schema(fbb, m_columns);
+    fbb.start_table();
+    fbb.add_offset(2, schema);
+    fbb.add_field<int16_t>(0, METADATA_V5);
+    fbb.add_field<uint8_t>(1, HEADER_SCHEMA);
+
+    write_message(fbb.finish(fbb.end_table()), std::string());
+  }
+
+  //============================================================================
+  // set_type
+  //============================================================================
+  void ArrowWriter::set_type (Column& column, ColumnType type, int64_t n_rows)
+  {
+    if (m_schema_written)
+      throw std::logic_error("ArrowWriter: type of " + column.name + 
+          " defined after the first batch");
+
+    // The rows buffered before are NULL, their values are placeholders
+    column.type = type;
+    if (type == Utf8)
+      column.offsets.resize(n_rows + 1, 0);
+    else
+      column.values.append(n_rows * sizeof(int64_t), '\0');
+  }
+
+  //============================================================================
+  // execute
+  //============================================================================
+  void ArrowWriter::execute ()
+  {
+    if (m_closed)
+      throw std::logic_error("ArrowWriter: " + m_file_path + " already closed");
+
+    if (m_failed)
+      throw std::logic_error("ArrowWriter: " + m_file_path + 
+          " not written after a previous failure");
+
+    if (!m_file.is_open())
+      open();
+
+    sqlite3_stmt* stmt = get_statement("query", m_query);
+    try
+    {
+      while (exec_stmt(stmt))
+      {
+        append_row(stmt);
+        if (static_cast<size_t>(m_n_rows) == m_batch_size)
+          write_batch();
+      }
+    }
+    catch (...)
+    {
+      m_failed = true;
+      throw;
+    }
+  }
+
+  //============================================================================
+  // append_row
+  //============================================================================
+  void ArrowWriter::append_row (sqlite3_stmt* stmt)
+  {
+    const size_t n_columns = m_columns.size();
+    const int64_t iRow = m_n_rows;
+
+    // Types of the whole row are checked before appending any value, so 
+    // that an inconsistent value leaves the buffers unchanged
+    std::vector<ColumnType> types (n_columns);
+    for (size_t iCol = 0; iCol < n_columns; ++iCol)
+    {
+      const Column& column = m_columns[iCol];
+      const int value_type = sqlite3_column_type(stmt, iCol);
+      types[iCol] = column.type;
+      if (!column.inferred || value_type == SQLITE_NULL)
+        continue;
+
+      // Columns without declared type take the type of the first value
+      if (column.type == Undefined)
+        switch (value_type)
+        {
+          case SQLITE_INTEGER: types[iCol] = Int64; break;
+          case SQLITE_FLOAT: types[iCol] = Float64; break;
+          case SQLITE_TEXT: types[iCol] = Utf8; break;
+          default:
+            throw std::logic_error(
+                "ArrowWriter: unsupported value type in " + column.name);
+        }
+      else if (!(
+            (column.type == Int64 && value_type == SQLITE_INTEGER) ||
+            (column.type == Float64 && value_type == SQLITE_FLOAT) ||
+            (column.type == Float64 && value_type == SQLITE_INTEGER) ||
+            (column.type == Utf8 && value_type == SQLITE_TEXT)))
+        throw std::logic_error("ArrowWriter: value of " + column.name + 
+            " inconsistent with the type of the previous values");
+    }
+
+    for (size_t iCol = 0; iCol < n_columns; ++iCol)
+      if (types[iCol] != m_columns[iCol].type)
+        set_type(m_columns[iCol], types[iCol], iRow);
+
+    ++m_n_rows;
+    for (size_t iCol = 0; iCol < n_columns; ++iCol)
+    {
+      Column& column = m_columns[iCol];
+      const bool is_null = (sqlite3_column_type(stmt, iCol) == SQLITE_NULL);
+
+      if (iRow % 8 == 0)
+        column.validity.push_back('\0');
+      if (is_null)
+        column.null_count++;
+      else
+        column.validity.back() |= static_cast<char>(1 << (iRow % 8));
+
+      if (column.type == Int64)
+      {
+        const int64_t value = is_null ? 0 : sqlite3_column_int64(stmt, iCol);
+        column.values.append(reinterpret_cast<const char*>(&value),
+            sizeof(value));
+      }
+      else if (column.type == Float64)
+      {
+        const double value = is_null ?
+          std::numeric_limits<double>::quiet_NaN() :
+          sqlite3_column_double(stmt, iCol);
+        column.values.append(reinterpret_cast<const char*>(&value),
+            sizeof(value));
+      }
+      else if (column.type == Utf8)
+      {
+        const unsigned char* text = sqlite3_column_text(stmt, iCol);
+        if (text)
+          column.values.append(reinterpret_cast<const char*>(text),
+              sqlite3_column_bytes(stmt, iCol));
+        column.offsets.push_back(column.values.size());
+      }
+    }
+  }
+
+  //============================================================================
+  // write_batch
+  //============================================================================
+  void ArrowWriter::write_batch ()
+  {
+    if (!m_schema_written)
+      write_schema();
+
+    // Buffers of the body, in the order defined by the Arrow columnar format
+    std::vector<std::pair<const char*, size_t> > buffers;
+    std::vector<int64_t> nodes;
+    for (const Column& column: m_columns)
+    {
+      nodes.push_back(m_n_rows);
+      nodes.push_back(column.null_count);
+
+      // The validity bitmap can be omitted if there are no NULL values
+      buffers.push_back(std::make_pair(column.validity.data(),
+            column.null_count ? column.validity.size() : 0));
+
+      if (column.type == Utf8)
+        buffers.push_back(std::make_pair(
+              reinterpret_cast<const char*>(column.offsets.data()),
+              column.offsets.size() * sizeof(int32_t)));
+
+      buffers.push_back(std::make_pair(
+            column.values.data(), column.values.size()));
+    }
+
+    std::string body;
+    std::vector<int64_t> buffer_specs;
+    for (auto& buffer: buffers)
+    {
+      buffer_specs.push_back(body.size());
+      buffer_specs.push_back(buffer.second);
+      body.append(buffer.first, buffer.second);
+      body.append(padded(body.size()) - body.size(), '\0');
+    }
+
+    FlatBufferBuilder fbb;
+    const uint32_t node_vector = fbb.create_vector(
+        nodes.data(), nodes.size() / 2, 2 * sizeof(int64_t), sizeof(int64_t));
+    const uint32_t buffer_vector = fbb.create_vector(
+        buffer_specs.data(), buffer_specs.size() / 2,
+        2 * sizeof(int64_t), sizeof(int64_t));
+
+    fbb.start_table();
+    fbb.add_field<int64_t>(0, m_n_rows);
+    fbb.add_offset(1, node_vector);
+    fbb.add_offset(2, buffer_vector);
+    const uint32_t record_batch = fbb.end_table();
+
+    fbb.start_table();
+    fbb.add_field<int64_t>(3, body.size());
+    fbb.add_offset(2, record_batch);
+    fbb.add_field<int16_t>(0, METADATA_V5);
+    fbb.add_field<uint8_t>(1, HEADER_RECORD_BATCH);
+    const std::string metadata = fbb.finish(fbb.end_table());
+
+    m_batches.push_back(write_message(metadata, body));
+
+    // Reset the column buffers, preserving their capacity
+    m_n_rows = 0;
+    for (Column& column: m_columns)
+    {
+      column.validity.clear();
+      column.values.clear();
+      column.offsets.resize(1);
+      column.null_count = 0;
+    }
+  }
+
+  //============================================================================
+  // close
+  //============================================================================
+  void ArrowWriter::close ()
+  {
+    if (m_closed)
+      return;
+
+    if (!m_file.is_open())
+      open();
+
+    // After a failure, the rows of the pending batch are discarded
+    if (m_n_rows > 0 && !m_failed)
+      write_batch();
+
+    if (!m_schema_written)
+      write_schema();
+
+    // End-of-stream marker
+    const uint32_t eos[2] = {CONTINUATION, 0};
+    write_bytes(eos, sizeof(eos));
+
+    // The footer repeats the schema and indexes the record batches
+    FlatBufferBuilder fbb;
+    std::vector<char> blocks (m_batches.size() * 24, '\0');
+    for (size_t iBatch = 0; iBatch < m_batches.size(); ++iBatch)
+    {
+      char* block = &blocks[iBatch * 24];
+      std::memcpy(block, &m_batches[iBatch].offset, sizeof(int64_t));
+      std::memcpy(block + 8, &m_batches[iBatch].metadata_length, sizeof(int32_t));
+      std::memcpy(block + 16, &m_batches[iBatch].body_length, sizeof(int64_t));
+    }
+
+    const uint32_t batch_vector = fbb.create_vector(
+        blocks.data(), m_batches.size(), 24, sizeof(int64_t));
+    const uint32_t dictionary_vector = fbb.create_vector(
+        nullptr, 0, 24, sizeof(int64_t));
+    const uint32_t schema = create_schema(fbb, m_columns);
+
+    fbb.start_table();
+    fbb.add_offset(1, schema);
+    fbb.add_offset(2, dictionary_vector);
+    fbb.add_offset(3, batch_vector);
+    fbb.add_field<int16_t>(0, METADATA_V5);
+    const std::string footer = fbb.finish(fbb.end_table());
+
+    const int32_t footer_length = footer.size();
+    write_bytes(footer.data(), footer.size());
+    write_bytes(&footer_length, sizeof(footer_length));
+    write_bytes(ARROW_MAGIC, 6);
+
+    m_file.close();
+    m_closed = true;
+    if (!m_file)
+      throw std::logic_error("ArrowWriter: failed writing " + m_file_path);
+  }
+
+  //============================================================================
+  // write_message
+  //============================================================================
+  ArrowWriter::Block ArrowWriter::write_message (
+      const std::string& metadata,
+      const std::string& body
+      )
+  {
+    Block block;
+    block.offset = m_file_offset;
+    block.metadata_length = 2 * sizeof(uint32_t) + metadata.size();
+    block.body_length = body.size();
+
+    const int32_t metadata_size = metadata.size();
+    write_bytes(&CONTINUATION, sizeof(CONTINUATION));
+    write_bytes(&metadata_size, sizeof(metadata_size));
+    write_bytes(metadata.data(), metadata.size());
+    write_bytes(body.data(), body.size());
+
+    return block;
+  }
+
+  //============================================================================
+  // write_bytes
+  //============================================================================
+  void ArrowWriter::write_bytes (const void* data, size_t size)
+  {
+    m_file.write(reinterpret_cast<const char*>(data), size);
+    m_file_offset += size;
+
+    if (!m_file)
+      throw std::logic_error("ArrowWriter: failed writing " + m_file_path);
+  }
+}
@@ -13,6 +13,63 @@
 #include "SQLamarr/SQLiteError.h"
 #include "sqlite3.h"
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <mutex>
+
+namespace
+{
+  // Profiled statements of all the interfaces, shared by the trace callbacks
+  std::mutex s_profiled_mutex;
+  std::unordered_map<sqlite3_stmt*, SQLamarr::StatementProfile*> s_profiled;
+
+  //==========================================================================
+  // trace_profile: callback of sqlite3_trace_v2 with SQLITE_TRACE_PROFILE
+  //==========================================================================
+  int trace_profile (unsigned int, void*, void* stmt, void* nanoseconds)
+  {
+    std::lock_guard<std::mutex> lock (s_profiled_mutex);
+    auto profile = s_profiled.find(reinterpret_cast<sqlite3_stmt*>(stmt));
+    if (profile != s_profiled.end())
+    {
+      profile->second->executions++;
+      profile->second->time += 
+        *reinterpret_cast<sqlite3_int64*>(nanoseconds) * 1e-9;
+    }
+
+    return 0;
+  }
+
+  //==========================================================================
+  // explain_query_plan: indented output of EXPLAIN QUERY PLAN
+  //==========================================================================
+  std::string explain_query_plan (sqlite3* db, sqlite3_stmt* stmt)
+  {
+    sqlite3_stmt* explain;
+    const std::string query = 
+      std::string("EXPLAIN QUERY PLAN ") + sqlite3_sql(stmt);
+
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, &explain, nullptr) != SQLITE_OK)
+      return std::string("Query plan unavailable: ") + sqlite3_errmsg(db);
+
+    std::string ret;
+    std::map<int, int> depth;
+    while (sqlite3_step(explain) == SQLITE_ROW)
+    {
+      const int id = sqlite3_column_int(explain, 0);
+      const int parent = sqlite3_column_int(explain, 1);
+      const char* detail = 
+        reinterpret_cast<const char*>(sqlite3_column_text(explain, 3));
+
+      depth[id] = depth.count(parent) ? depth[parent] + 1 : 0;
+      ret += std::string(2*depth[id], ' ') + (detail ? detail : "") + "\n";
+    }
+
+    sqlite3_finalize(explain);
+    return ret;
+  }
+}
 
 namespace SQLamarr
 {
@@ -23,6 +80,16 @@ namespace SQLamarr
   : m_database (db)
   , m_queries ()
   , m_cached_raw_ptr (nullptr)
+  , m_n_rows_returned (0)
+  , m_n_statements_prepared (0)
+  , m_profiling (false)
+  , m_profiles ()
+  , m_incremental (false)
+  , m_last_genevent_id (0)
+  , m_nested_transactions ()
+  , m_table_tracking (false)
+  , m_tables_read ()
+  , m_tables_written ()
   {
     sqlamarr_create_sql_functions(db.get());
   }
@@ -32,6 +99,7 @@ namespace SQLamarr
   //==========================================================================
   BaseSqlInterface::~BaseSqlInterface()
   {
+    set_profiling(false);
     invalidate_cache();
   }
 
@@ -41,11 +109,29 @@ namespace SQLamarr
   void BaseSqlInterface::invalidate_cache(void)
   {
     for (auto q = m_queries.begin(); q != m_queries.end(); ++q)
+    {
+      if (m_profiling)
+      {
+        collect_stmt_status(q->first, q->second);
+        std::lock_guard<std::mutex> lock (s_profiled_mutex);
+        s_profiled.erase(q->second);
+      }
+
       sqlite3_finalize(q->second);
+    }
     
     m_queries.clear();  // Cache invalidation
   }
 
+  //==========================================================================
+  // reset_statements
+  //==========================================================================
+  void BaseSqlInterface::reset_statements(void)
+  {
+    for (auto q = m_queries.begin(); q != m_queries.end(); ++q)
+      sqlite3_reset(q->second);
+  }
+
   //==========================================================================
   // get_statement
   //==========================================================================
@@ -61,12 +147,265 @@ namespace SQLamarr
     }
 
     if (m_queries.find(name) == m_queries.end())
-      m_queries[name] = prepare_statement(m_database, query);
+    {
+      if (!m_table_tracking)
+        m_queries[name] = prepare_statement(m_database, query);
+      else
+      {
+        // Replaces any authorizer of the application (see set_table_tracking)
+        sqlite3_set_authorizer(m_database.get(), record_table_access, this);
+        try
+        {
+          m_queries[name] = prepare_statement(m_database, query);
+        }
+        catch (...)
+        {
+          sqlite3_set_authorizer(m_database.get(), nullptr, nullptr);
+          throw;
+        }
+        sqlite3_set_authorizer(m_database.get(), nullptr, nullptr);
+      }
+      m_n_statements_prepared++;
+
+      if (m_profiling)
+        register_profile(name, m_queries[name]);
+    }
 
     sqlite3_reset(m_queries[name]);
     return m_queries[name];
   }
 
+  //==========================================================================
+  // record_table_access
+  //==========================================================================
+  int BaseSqlInterface::record_table_access (
+      void* self, 
+      int action, 
+      const char* arg1, 
+      const char*, 
+      const char*, 
+      const char*
+      )
+  {
+    std::set<std::string>* tables = nullptr;
+    BaseSqlInterface* interface = reinterpret_cast<BaseSqlInterface*>(self);
+    switch (action)
+    {
+      case SQLITE_READ:
+        tables = &interface->m_tables_read;
+        break;
+      case SQLITE_INSERT:
+      case SQLITE_UPDATE:
+      case SQLITE_DELETE:
+      case SQLITE_CREATE_TABLE:
+      case SQLITE_CREATE_TEMP_TABLE:
+      case SQLITE_CREATE_VIEW:
+      case SQLITE_CREATE_TEMP_VIEW:
+      case SQLITE_DROP_TABLE:
+      case SQLITE_DROP_TEMP_TABLE:
+      case SQLITE_DROP_VIEW:
+      case SQLITE_DROP_TEMP_VIEW:
+        tables = &interface->m_tables_written;
+        break;
+      default:
+        return SQLITE_OK;
+    }
+
+    if (arg1 == nullptr)
+      return SQLITE_OK;
+
+    std::string table (arg1);
+    std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+
+    // Internal tables (schema, sequences, statistics) are not tracked
+    if (table.compare(0, 7, "sqlite_") != 0)
+      tables->insert(table);
+
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // set_table_tracking
+  //==========================================================================
+  void BaseSqlInterface::set_table_tracking (bool enabled)
+  {
+    if (enabled == m_table_tracking)
+      return;
+
+    // Statements compiled before are compiled again to record their tables
+    m_table_tracking = enabled;
+    if (enabled)
+      invalidate_cache();
+  }
+
+  //==========================================================================
+  // declare_tables
+  //==========================================================================
+  void BaseSqlInterface::declare_tables (
+      const std::vector<std::string>& read,
+      const std::vector<std::string>& written
+      )
+  {
+    for (std::string table: read)
+    {
+      std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+      m_tables_read.insert(table);
+    }
+
+    for (std::string table: written)
+    {
+      std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+      m_tables_written.insert(table);
+    }
+  }
+
+  //==========================================================================
+  // set_profiling
+  //==========================================================================
+  void BaseSqlInterface::set_profiling(bool enabled)
+  {
+    if (enabled == m_profiling)
+      return;
+
+    m_profiling = enabled;
+    for (auto q = m_queries.begin(); q != m_queries.end(); ++q)
+    {
+      if (enabled)
+      {
+        sqlite3_stmt_status(q->second, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+        sqlite3_stmt_status(q->second, SQLITE_STMTSTATUS_SORT, 1);
+        sqlite3_stmt_status(q->second, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+        sqlite3_stmt_status(q->second, SQLITE_STMTSTATUS_VM_STEP, 1);
+        register_profile(q->first, q->second);
+      }
+      else
+      {
+        collect_stmt_status(q->first, q->second);
+        std::lock_guard<std::mutex> lock (s_profiled_mutex);
+        s_profiled.erase(q->second);
+      }
+    }
+
+    // Remove the trace callback once no statement of the connection is profiled
+    if (!enabled && m_database.get() != nullptr)
+    {
+      std::lock_guard<std::mutex> lock (s_profiled_mutex);
+      for (auto p = s_profiled.begin(); p != s_profiled.end(); ++p)
+        if (sqlite3_db_handle(p->first) == m_database.get())
+          return;
+
+      sqlite3_trace_v2(m_database.get(), 0, nullptr, nullptr);
+    }
+  }
+
+  //==========================================================================
+  // register_profile
+  //==========================================================================
+  void BaseSqlInterface::register_profile(
+      const std::string& name, 
+      sqlite3_stmt* stmt
+      )
+  {
+    StatementProfile& profile = m_profiles[name];
+    if (profile.name.empty())
+    {
+      profile = StatementProfile();
+      profile.name = name;
+      profile.sql = sqlite3_sql(stmt);
+      profile.query_plan = explain_query_plan(m_database.get(), stmt);
+    }
+
+    sqlite3_trace_v2(
+        m_database.get(), SQLITE_TRACE_PROFILE, trace_profile, nullptr);
+
+    std::lock_guard<std::mutex> lock (s_profiled_mutex);
+    s_profiled[stmt] = &profile;
+  }
+
+  //==========================================================================
+  // collect_stmt_status
+  //==========================================================================
+  void BaseSqlInterface::collect_stmt_status(
+      const std::string& name, 
+      sqlite3_stmt* stmt
+      )
+  {
+    StatementProfile& profile = m_profiles[name];
+    profile.fullscan_steps += 
+      sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    profile.sorts += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 1);
+    profile.autoindex += 
+      sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+    profile.vm_steps += sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+  }
+
+  //==========================================================================
+  // statement_profiles
+  //==========================================================================
+  std::vector<StatementProfile> BaseSqlInterface::statement_profiles(void)
+  {
+    if (m_profiling)
+      for (auto q = m_queries.begin(); q != m_queries.end(); ++q)
+        collect_stmt_status(q->first, q->second);
+
+    std::vector<StatementProfile> ret;
+    {
+      std::lock_guard<std::mutex> lock (s_profiled_mutex);
+      for (auto p = m_profiles.begin(); p != m_profiles.end(); ++p)
+        ret.push_back(p->second);
+    }
+
+    std::sort(ret.begin(), ret.end(), 
+        [](const StatementProfile& a, const StatementProfile& b) 
+        { return a.name < b.name; }
+        );
+
+    return ret;
+  }
+
+  //==========================================================================
+  // reset_profiles
+  //==========================================================================
+  void BaseSqlInterface::reset_profiles(void)
+  {
+    if (m_profiling)
+      for (auto q = m_queries.begin(); q != m_queries.end(); ++q)
+        collect_stmt_status(q->first, q->second);
+
+    std::lock_guard<std::mutex> lock (s_profiled_mutex);
+    for (auto p = m_profiles.begin(); p != m_profiles.end(); ++p)
+    {
+      StatementProfile& profile = p->second;
+      profile.executions = 0;
+      profile.time = 0.;
+      profile.fullscan_steps = 0;
+      profile.sorts = 0;
+      profile.autoindex = 0;
+      profile.vm_steps = 0;
+    }
+  }
+
+  //==========================================================================
+  // genevent_range
+  //==========================================================================
+  std::pair<sqlite3_int64, sqlite3_int64> BaseSqlInterface::genevent_range(void)
+  {
+    sqlite3_stmt* max_genevent_id = get_statement("BaseSqlInterface::max_genevent_id",
+        "SELECT IFNULL(MAX(genevent_id), 0) FROM GenEvents");
+
+    if (!exec_stmt(max_genevent_id))
+      throw SQLiteError("Failed retrieving the last genevent_id");
+
+    const sqlite3_int64 last = sqlite3_column_int64(max_genevent_id, 0);
+    sqlite3_reset(max_genevent_id);
+
+    // A smaller genevent_id (AUTOINCREMENT) implies a different event store
+    if (!m_incremental || last < m_last_genevent_id)
+      m_last_genevent_id = 0;
+
+    return std::make_pair(m_last_genevent_id + 1, last);
+  }
+
   //==========================================================================
   // create_sql_function
   //==========================================================================
@@ -83,6 +422,83 @@ namespace SQLamarr
         );
   }
 
+  //==========================================================================
+  // begin_transaction
+  //==========================================================================
+  void BaseSqlInterface::begin_transaction (bool exclusive)
+  {
+    const bool nested = !sqlite3_get_autocommit(m_database.get());
+    m_nested_transactions.push_back(nested);
+
+    const char* query = nested ? "SAVEPOINT sqlamarr" : 
+      (exclusive ? "BEGIN EXCLUSIVE" : "BEGIN IMMEDIATE");
+
+    if (sqlite3_exec(m_database.get(), query, 0, 0, 0) != SQLITE_OK)
+    {
+      m_nested_transactions.pop_back();
+      std::cerr << sqlite3_errmsg(m_database.get()) << std::endl;
+      throw SQLiteError("Failed to begin a transaction");
+    }
+  }
+
+  //==========================================================================
+  // end_transaction
+  //==========================================================================
+  void BaseSqlInterface::end_transaction ()
+  {
+    bool nested = false;
+    if (!m_nested_transactions.empty())
+    {
+      nested = m_nested_transactions.back();
+      m_nested_transactions.pop_back();
+    }
+
+    // Nothing to commit if the transaction was closed in the meanwhile
+    if (sqlite3_get_autocommit(m_database.get()))
+      return;
+
+    const char* query = nested ? "RELEASE sqlamarr" : "COMMIT";
+    if (sqlite3_exec(m_database.get(), query, 0, 0, 0) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(m_database.get()) << std::endl;
+      throw SQLiteError("Failed to end a transaction");
+    }
+  }
+
+  //==========================================================================
+  // rollback_transaction
+  //==========================================================================
+  void BaseSqlInterface::rollback_transaction ()
+  {
+    bool nested = false;
+    if (!m_nested_transactions.empty())
+    {
+      nested = m_nested_transactions.back();
+      m_nested_transactions.pop_back();
+    }
+
+    // Nothing to roll back if the transaction was closed in the meanwhile
+    if (sqlite3_get_autocommit(m_database.get()))
+      return;
+
+    const char* query = nested ? 
+      "ROLLBACK TO sqlamarr; RELEASE sqlamarr" : "ROLLBACK";
+    if (sqlite3_exec(m_database.get(), query, 0, 0, 0) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(m_database.get()) << std::endl;
+      throw SQLiteError("Failed to roll back a transaction");
+    }
+  }
+
+  //==========================================================================
+  // rollback_transactions
+  //==========================================================================
+  void BaseSqlInterface::rollback_transactions ()
+  {
+    while (!m_nested_transactions.empty())
+      rollback_transaction();
+  }
+
   //==========================================================================
   // exec_stmt
   //==========================================================================
@@ -91,7 +507,7 @@ namespace SQLamarr
     switch (sqlite3_step(stmt))
     {
       case SQLITE_DONE: return false;
-      case SQLITE_ROW:  return true;
+      case SQLITE_ROW:  m_n_rows_returned++; return true;
       default:
         std::cerr << sqlite3_errmsg(m_database.get()) << std::endl;
         throw SQLiteError("SQL Error");
@@ -0,0 +1,109 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+// STL
+#include <vector>
+
+// Local
+#include "SQLamarr/BinaryDataLoader.h"
+#include "SQLamarr/BinaryEventFile.h"
+#include "SQLamarr/preprocessor_symbols.h"
+
+namespace SQLamarr
+{
+  //==========================================================================
+  // load
+  //==========================================================================
+  void BinaryDataLoader::load (
+      const std::string& file_path, 
+      size_t run_number, 
+      size_t evt_number
+      )
+  {
+    using namespace BinaryEventFormat;
+    const BinaryEventFile file(file_path);
+
+    const int32_t* collision = file.integers(CollisionNumber);
+    const float* ct = file.reals(CollisionT);
+    const float* cx = file.reals(CollisionX);
+    const float* cy = file.reals(CollisionY);
+    const float* cz = file.reals(CollisionZ);
+    const int32_t* first_vertex = file.integers(FirstVertex);
+    const int32_t* first_particle = file.integers(FirstParticle);
+
+    const int32_t* v_hepmc_id = file.integers(VertexHepmcId);
+    const int32_t* v_status = file.integers(VertexStatus);
+    const int32_t* v_is_primary = file.integers(VertexIsPrimary);
+    const float* vt = file.reals(VertexT);
+    const float* vx = file.reals(VertexX);
+    const float* vy = file.reals(VertexY);
+    const float* vz = file.reals(VertexZ);
+
+    const int32_t* p_hepmc_id = file.integers(ParticleHepmcId);
+    const int32_t* p_production_vertex = file.integers(ParticleProductionVertex);
+    const int32_t* p_end_vertex = file.integers(ParticleEndVertex);
+    const int32_t* p_pid = file.integers(ParticlePid);
+    const int32_t* p_status = file.integers(ParticleStatus);
+    const float* pe = file.reals(ParticlePe);
+    const float* px = file.reals(ParticlePx);
+    const float* py = file.reals(ParticlePy);
+    const float* pz = file.reals(ParticlePz);
+    const float* pm = file.reals(ParticleM);
+
+    begin_transaction();
+    try
+    {
+      const int ds_id = insert_event(file_path, run_number, evt_number);
+
+      std::vector<int> vtx_ids;
+      for (size_t iColl = 0; iColl < file.n_collisions(); ++iColl)
+      {
+        const int event_id = insert_collision(
+            ds_id, collision[iColl], ct[iColl], cx[iColl], cy[iColl], cz[iColl]);
+
+        vtx_ids.clear();
+        for (int iVtx = first_vertex[iColl]; iVtx < first_vertex[iColl+1]; ++iVtx)
+          vtx_ids.push_back(insert_vertex(
+                event_id,
+                v_hepmc_id[iVtx],
+                v_status[iVtx],
+                vt[iVtx], vx[iVtx], vy[iVtx], vz[iVtx],
+                v_is_primary[iVtx]
+                ));
+
+        const int n_vertices = vtx_ids.size();
+        for (int iP = first_particle[iColl]; iP < first_particle[iColl+1]; ++iP)
+        {
+          const int pv = p_production_vertex[iP];
+          const int ev = p_end_vertex[iP];
+
+          insert_particle(
+                event_id,
+                p_hepmc_id[iP],
+                (pv >= 0 && pv < n_vertices ? vtx_ids[pv] : LAMARR_BAD_INDEX),
+                (ev >= 0 && ev < n_vertices ? vtx_ids[ev] : LAMARR_BAD_INDEX),
+                p_pid[iP],
+                p_status[iP],
+                pe[iP], px[iP], py[iP], pz[iP], pm[iP]
+              );
+        }
+      }
+    }
+    catch (...)
+    {
+      // The rows inserted so far are discarded with the transaction
+      reset_statements();
+      rollback_transaction();
+      throw;
+    }
+
+    end_transaction();
+  }
+}
@@ -0,0 +1,235 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Standard C
+#include <string.h>
+
+// STL
+#include <fstream>
+#include <stdexcept>
+
+// SQLamarr
+#include "SQLamarr/BinaryEventFile.h"
+
+namespace SQLamarr
+{
+  namespace
+  {
+    using namespace BinaryEventFormat;
+
+    const char magic[8] = "SQLMEVT";
+
+    /// Number of entries of a column
+    uint64_t column_size (int column, const Header& header)
+    {
+      if (column < FirstVertex)
+        return header.n_collisions;
+      if (column <= FirstParticle)
+        return header.n_collisions + 1;
+      if (column < ParticleHepmcId)
+        return header.n_vertices;
+
+      return header.n_particles;
+    }
+
+    /// Size in bytes of a column, including the padding
+    uint64_t column_bytes (int column, const Header& header)
+    {
+      return (column_size(column, header) * 4 + 7) & ~uint64_t(7);
+    }
+  }
+
+  //==========================================================================
+  // BinaryEventWriter: constructor
+  //==========================================================================
+  BinaryEventWriter::BinaryEventWriter (const std::string& file_path)
+    : m_file_path (file_path)
+  {
+    Field zero;
+    zero.i = 0;
+    m_columns[FirstVertex].push_back(zero);
+    m_columns[FirstParticle].push_back(zero);
+  }
+
+  //==========================================================================
+  // BinaryEventWriter: add_collision
+  //==========================================================================
+  void BinaryEventWriter::add_collision (
+      int collision, float t, float x, float y, float z)
+  {
+    Field f;
+    f.i = collision; m_columns[CollisionNumber].push_back(f);
+    f.f = t; m_columns[CollisionT].push_back(f);
+    f.f = x; m_columns[CollisionX].push_back(f);
+    f.f = y; m_columns[CollisionY].push_back(f);
+    f.f = z; m_columns[CollisionZ].push_back(f);
+
+    // Boundaries of the new collision, updated as rows are added
+    m_columns[FirstVertex].push_back(m_columns[FirstVertex].back());
+    m_columns[FirstParticle].push_back(m_columns[FirstParticle].back());
+  }
+
+  //==========================================================================
+  // BinaryEventWriter: add_vertex
+  //==========================================================================
+  int BinaryEventWriter::add_vertex (
+      int hepmc_id, int status, float t, float x, float y, float z,
+      bool is_primary)
+  {
+    if (m_columns[CollisionNumber].empty())
+      throw std::logic_error("Vertex added before any collision");
+
+    Field f;
+    f.i = hepmc_id; m_columns[VertexHepmcId].push_back(f);
+    f.i = status; m_columns[VertexStatus].push_back(f);
+    f.i = is_primary; m_columns[VertexIsPrimary].push_back(f);
+    f.f = t; m_columns[VertexT].push_back(f);
+    f.f = x; m_columns[VertexX].push_back(f);
+    f.f = y; m_columns[VertexY].push_back(f);
+    f.f = z; m_columns[VertexZ].push_back(f);
+
+    const int first = m_columns[FirstVertex].end()[-2].i;
+    return m_columns[FirstVertex].back().i++ - first;
+  }
+
+  //==========================================================================
+  // BinaryEventWriter: add_particle
+  //==========================================================================
+  void BinaryEventWriter::add_particle (
+      int hepmc_id, int production_vertex, int end_vertex, int pid,
+      int status, float pe, float px, float py, float pz, float m)
+  {
+    if (m_columns[CollisionNumber].empty())
+      throw std::logic_error("Particle added before any collision");
+
+    Field f;
+    f.i = hepmc_id; m_columns[ParticleHepmcId].push_back(f);
+    f.i = production_vertex; m_columns[ParticleProductionVertex].push_back(f);
+    f.i = end_vertex; m_columns[ParticleEndVertex].push_back(f);
+    f.i = pid; m_columns[ParticlePid].push_back(f);
+    f.i = status; m_columns[ParticleStatus].push_back(f);
+    f.f = pe; m_columns[ParticlePe].push_back(f);
+    f.f = px; m_columns[ParticlePx].push_back(f);
+    f.f = py; m_columns[ParticlePy].push_back(f);
+    f.f = pz; m_columns[ParticlePz].push_back(f);
+    f.f = m; m_columns[ParticleM].push_back(f);
+
+    m_columns[FirstParticle].back().i++;
+  }
+
+  //==========================================================================
+  // BinaryEventWriter: write
+  //==========================================================================
+  void BinaryEventWriter::write ()
+  {
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.n_columns = NColumns;
+    header.n_collisions = m_columns[CollisionNumber].size();
+    header.n_vertices = m_columns[VertexHepmcId].size();
+    header.n_particles = m_columns[ParticleHepmcId].size();
+
+    std::ofstream out (m_file_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const char padding[8] = {0};
+    for (int iCol = 0; iCol < NColumns; ++iCol)
+    {
+      const uint64_t n_bytes = m_columns[iCol].size() * sizeof(Field);
+      out.write(reinterpret_cast<const char*>(m_columns[iCol].data()), n_bytes);
+      out.write(padding, column_bytes(iCol, header) - n_bytes);
+    }
+
+    if (!out)
+      throw std::runtime_error("Failed writing " + m_file_path);
+  }
+
+
+  //==========================================================================
+  // BinaryEventFile: constructor
+  //==========================================================================
+  BinaryEventFile::BinaryEventFile (const std::string& file_path)
+    : m_data (MAP_FAILED)
+    , m_size (0)
+    , m_header (nullptr)
+  {
+    const int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::invalid_argument("Cannot open " + file_path);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= off_t(sizeof(Header)))
+    {
+      m_size = st.st_size;
+      m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (m_data == MAP_FAILED)
+      throw std::invalid_argument("Cannot map " + file_path);
+
+    m_header = static_cast<const Header*>(m_data);
+    if (memcmp(m_header->magic, magic, sizeof(magic)) != 0 ||
+        m_header->version != version ||
+        m_header->byte_order != byte_order_mark ||
+        m_header->n_columns != NColumns ||
+        m_header->n_collisions >= m_size ||
+        m_header->n_vertices >= m_size ||
+        m_header->n_particles >= m_size)
+    {
+      munmap(m_data, m_size);
+      throw std::invalid_argument("Not a binary event file: " + file_path);
+    }
+
+    uint64_t offset = sizeof(Header);
+    for (int iCol = 0; iCol < NColumns; ++iCol)
+    {
+      m_columns[iCol] = static_cast<const char*>(m_data) + offset;
+      offset += column_bytes(iCol, *m_header);
+    }
+
+    if (offset > m_size || !valid_boundaries(FirstVertex, n_vertices()) ||
+        !valid_boundaries(FirstParticle, n_particles()))
+    {
+      munmap(m_data, m_size);
+      throw std::invalid_argument("Corrupted binary event file: " + file_path);
+    }
+  }
+
+  //==========================================================================
+  // BinaryEventFile: valid_boundaries
+  //==========================================================================
+  bool BinaryEventFile::valid_boundaries (
+      BinaryEventFormat::Column column, size_t n_rows) const
+  {
+    const int32_t* first = integers(column);
+    for (size_t iColl = 0; iColl < n_collisions(); ++iColl)
+      if (first[iColl] < 0 || first[iColl] > first[iColl + 1])
+        return false;
+
+    return uint64_t(first[n_collisions()]) == n_rows;
+  }
+
+  //==========================================================================
+  // BinaryEventFile: destructor
+  //==========================================================================
+  BinaryEventFile::~BinaryEventFile ()
+  {
+    munmap(m_data, m_size);
+  }
+}
@@ -28,7 +28,8 @@ namespace SQLamarr
   void CleanEventStore::execute()
   {
     sqlite3_stmt* list_tables = get_statement("list_tables",
-        "SELECT name FROM sqlite_master WHERE type='table'");
+        "SELECT name FROM sqlite_master "
+        "WHERE type='table' AND name <> 'sqlite_sequence'");
     sqlite3_stmt* list_temp_tables = get_statement("list_temp_tables",
         "SELECT name FROM sqlite_temp_master WHERE type='table'");
 
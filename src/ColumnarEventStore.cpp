@@ -0,0 +1,1023 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// Standard C
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+
+// SQLamarr
+#include "SQLamarr/ColumnarEventStore.h"
+#include "SQLamarr/SQLiteError.h"
+
+namespace SQLamarr
+{
+  //==========================================================================
+  // Arena: constructor and destructor
+  //==========================================================================
+  Arena::Arena (size_t block_size)
+    : m_block_size (block_size)
+    , m_blocks ()
+    , m_current (0)
+    , m_offset (0)
+  {}
+
+  Arena::~Arena ()
+  {
+    for (Block& block: m_blocks)
+      free(block.data);
+  }
+
+  //==========================================================================
+  // Arena: allocate
+  //==========================================================================
+  void* Arena::allocate (size_t n_bytes)
+  {
+    n_bytes = (n_bytes + 15) & ~size_t(15);
+
+    for (; m_current < m_blocks.size(); ++m_current, m_offset = 0)
+      if (m_blocks[m_current].size - m_offset >= n_bytes)
+      {
+        void* ret = m_blocks[m_current].data + m_offset;
+        m_offset += n_bytes;
+        return ret;
+      }
+
+    Block block;
+    block.size = std::max(m_block_size, n_bytes);
+    block.data = static_cast<char*>(malloc(block.size));
+    if (block.data == nullptr)
+      throw std::bad_alloc();
+
+    m_blocks.push_back(block);
+    m_current = m_blocks.size() - 1;
+    m_offset = n_bytes;
+    return block.data;
+  }
+
+  //==========================================================================
+  // Arena: capacity
+  //==========================================================================
+  size_t Arena::capacity () const
+  {
+    size_t ret = 0;
+    for (const Block& block: m_blocks)
+      ret += block.size;
+
+    return ret;
+  }
+
+
+  //==========================================================================
+  // ColumnarTable: constructor
+  //==========================================================================
+  const int64_t ColumnarTable::null_integer =
+    std::numeric_limits<int64_t>::min();
+
+  ColumnarTable::ColumnarTable (
+      const std::string& name,
+      const std::vector<Column>& columns
+      )
+    : m_name (name)
+    , m_columns (columns)
+    , m_arena ()
+    , m_chunks ()
+    , m_size (0)
+    , m_n_live (0)
+    , m_next_id (1)
+    , m_dense_ids (true)
+    , m_indices (columns.size())
+    , m_checkpoints ()
+    , m_undo ()
+    , m_created (false)
+  {}
+
+  //==========================================================================
+  // ColumnarTable: declaration
+  //==========================================================================
+  std::string ColumnarTable::declaration () const
+  {
+    std::string ret = "CREATE TABLE x(";
+    for (size_t iCol = 0; iCol < m_columns.size(); ++iCol)
+      ret += (iCol ? ", " : "") + m_columns[iCol].name +
+        (m_columns[iCol].type == Integer ? " INTEGER" : " REAL");
+
+    return ret + ")";
+  }
+
+  //==========================================================================
+  // ColumnarTable: append
+  //==========================================================================
+  int64_t ColumnarTable::append (const Value* values, int64_t id)
+  {
+    if (id <= 0)
+      id = m_next_id;
+    else if (id < m_next_id)
+      throw std::logic_error("Identifiers must be inserted in ascending order");
+
+    if (m_size > 0 && id != this->id(0) + int64_t(m_size))
+      m_dense_ids = false;
+    else if (m_size == 0)
+      m_dense_ids = true;
+
+    const int n_columns = m_columns.size();
+    if (m_size == m_chunks.size() * chunk_rows)
+      m_chunks.push_back(static_cast<Value*>(
+          m_arena.allocate((n_columns + 1) * chunk_rows * sizeof(Value))
+          ));
+
+    const size_t row = m_size++;
+    cell(row, 0).i = id;
+    for (int iCol = 1; iCol < n_columns; ++iCol)
+      cell(row, iCol) = values[iCol - 1];
+    cell(row, n_columns).i = 0; // deleted flag
+
+    m_n_live++;
+    m_next_id = id + 1;
+
+    return id;
+  }
+
+  //==========================================================================
+  // ColumnarTable: remove
+  //==========================================================================
+  void ColumnarTable::remove (size_t row)
+  {
+    Value& flag = cell(row, int(m_columns.size()));
+    if (flag.i)
+      return;
+
+    record_undo(row, int(m_columns.size()));
+    flag.i = 1;
+
+    // In a transaction, the rows may be restored until the commit
+    if (--m_n_live == 0 && !in_transaction())
+      release();
+  }
+
+  //==========================================================================
+  // ColumnarTable: update
+  //==========================================================================
+  void ColumnarTable::update (size_t row, int column, Value value)
+  {
+    if (column == 0)
+      throw std::logic_error("Cannot update the identifier of a row");
+
+    record_undo(row, column);
+    cell(row, column) = value;
+    m_indices[column].permutation.reset();
+  }
+
+  //==========================================================================
+  // ColumnarTable: lower_bound
+  //==========================================================================
+  size_t ColumnarTable::lower_bound (int64_t id) const
+  {
+    if (m_size == 0 || id <= this->id(0))
+      return 0;
+
+    if (m_dense_ids)
+      return static_cast<size_t>(
+          std::min<uint64_t>(m_size, uint64_t(id - this->id(0)))
+          );
+
+    size_t first = 0, count = m_size;
+    while (count > 0)
+    {
+      const size_t step = count / 2;
+      if (this->id(first + step) < id)
+      {
+        first += step + 1;
+        count -= step + 1;
+      }
+      else
+        count = step;
+    }
+
+    return first;
+  }
+
+  //==========================================================================
+  // ColumnarTable: index
+  //==========================================================================
+  ColumnarTable::Index ColumnarTable::index (int column)
+  {
+    SortedIndex& index = m_indices[column];
+    auto less = [this, column](uint32_t a, uint32_t b)
+    {
+      const int64_t va = cell(a, column).i, vb = cell(b, column).i;
+      return va < vb || (va == vb && a < b);
+    };
+
+    if (!index.permutation)
+    {
+      index.permutation = std::make_shared<std::vector<uint32_t>>();
+      index.n_rows = 0;
+    }
+    else if (index.n_rows == m_size)
+      return index.permutation;
+    else if (index.permutation.use_count() > 1) // Copy on write
+      index.permutation = std::make_shared<std::vector<uint32_t>>(
+          *index.permutation);
+
+    // Rows appended since the last search, merged in the permutation.
+    // Deleted rows already indexed are skipped while iterating.
+    std::vector<uint32_t>& permutation = *index.permutation;
+    const size_t n_indexed = permutation.size();
+    for (size_t row = index.n_rows; row < m_size; ++row)
+      if (!deleted(row))
+        permutation.push_back(row);
+
+    std::sort(permutation.begin() + n_indexed, permutation.end(), less);
+    if (n_indexed > 0 && permutation.size() > n_indexed &&
+        less(permutation[n_indexed], permutation[n_indexed - 1]))
+      std::inplace_merge(permutation.begin(),
+          permutation.begin() + n_indexed, permutation.end(), less);
+
+    index.n_rows = m_size;
+    return index.permutation;
+  }
+
+  //==========================================================================
+  // ColumnarTable: release
+  //==========================================================================
+  void ColumnarTable::release ()
+  {
+    m_arena.release();
+    m_chunks.clear();
+    m_size = 0;
+    m_n_live = 0;
+    m_dense_ids = true;
+
+    for (SortedIndex& index: m_indices)
+      index.permutation.reset();
+  }
+
+  //==========================================================================
+  // ColumnarTable: begin
+  //==========================================================================
+  void ColumnarTable::begin ()
+  {
+    Checkpoint checkpoint;
+    checkpoint.size = m_size;
+    checkpoint.n_live = m_n_live;
+    checkpoint.next_id = m_next_id;
+    checkpoint.dense_ids = m_dense_ids;
+    checkpoint.n_undo = 0;
+
+    m_undo.clear();
+    m_checkpoints.assign(1, checkpoint);
+  }
+
+  //==========================================================================
+  // ColumnarTable: savepoint
+  //==========================================================================
+  void ColumnarTable::savepoint (int level)
+  {
+    if (!in_transaction())
+      begin();
+
+    // Savepoints opened before the table joined the transaction share the
+    // state at the beginning of the transaction
+    m_checkpoints.resize(level + 1, m_checkpoints.back());
+
+    Checkpoint checkpoint;
+    checkpoint.size = m_size;
+    checkpoint.n_live = m_n_live;
+    checkpoint.next_id = m_next_id;
+    checkpoint.dense_ids = m_dense_ids;
+    checkpoint.n_undo = m_undo.size();
+    m_checkpoints.push_back(checkpoint);
+  }
+
+  //==========================================================================
+  // ColumnarTable: rollback_to
+  //==========================================================================
+  void ColumnarTable::rollback_to (int level)
+  {
+    if (!in_transaction())
+      return;
+
+    const size_t iCheckpoint = std::min<size_t>(level + 1, 
+        m_checkpoints.size() - 1);
+    m_checkpoints.resize(iCheckpoint + 1);
+    restore(m_checkpoints.back());
+  }
+
+  //==========================================================================
+  // ColumnarTable: release_savepoint
+  //==========================================================================
+  void ColumnarTable::release_savepoint (int level)
+  {
+    if (in_transaction())
+      m_checkpoints.resize(std::min<size_t>(level + 1, m_checkpoints.size()));
+  }
+
+  //==========================================================================
+  // ColumnarTable: commit
+  //==========================================================================
+  void ColumnarTable::commit ()
+  {
+    m_checkpoints.clear();
+    m_undo.clear();
+
+    if (m_n_live == 0 && m_size > 0)
+      release();
+  }
+
+  //==========================================================================
+  // ColumnarTable: rollback
+  //==========================================================================
+  void ColumnarTable::rollback ()
+  {
+    if (in_transaction())
+      restore(m_checkpoints.front());
+
+    commit();
+  }
+
+  //==========================================================================
+  // ColumnarTable: record_undo
+  //==========================================================================
+  void ColumnarTable::record_undo (size_t row, int column)
+  {
+    // Rows appended after the last checkpoint are truncated by the rollback
+    if (!in_transaction() || row >= m_checkpoints.back().size)
+      return;
+
+    Undo undo;
+    undo.row = row;
+    undo.column = column;
+    undo.value = cell(row, column);
+    m_undo.push_back(undo);
+  }
+
+  //==========================================================================
+  // ColumnarTable: restore
+  //==========================================================================
+  void ColumnarTable::restore (const Checkpoint& checkpoint)
+  {
+    for (size_t iUndo = m_undo.size(); iUndo > checkpoint.n_undo; --iUndo)
+    {
+      const Undo& undo = m_undo[iUndo - 1];
+      if (undo.row < checkpoint.size)
+        cell(undo.row, undo.column) = undo.value;
+    }
+    m_undo.resize(checkpoint.n_undo);
+
+    // The chunks of the truncated rows are kept for the next appends
+    m_size = checkpoint.size;
+    m_n_live = checkpoint.n_live;
+    m_next_id = checkpoint.next_id;
+    m_dense_ids = checkpoint.dense_ids;
+
+    for (SortedIndex& index: m_indices)
+      index.permutation.reset();
+  }
+}
+
+
+namespace
+{
+  using SQLamarr::ColumnarTable;
+  using SQLamarr::ColumnarEventStore;
+  using SQLamarr::lower_bound_of;
+  using SQLamarr::upper_bound_of;
+
+  // Stores attached to the connections
+  std::mutex s_stores_mutex;
+  std::unordered_map<sqlite3*, ColumnarEventStore*> s_stores;
+  std::atomic<unsigned int> s_generation (0);
+
+  // Encoding of the search strategy in idxNum
+  const int COLUMN_MASK = 0xFF;
+  const int HAS_EQ = 1 << 8;
+  const int HAS_LO = 1 << 9;
+  const int LO_STRICT = 1 << 10;
+  const int HAS_HI = 1 << 11;
+  const int HI_STRICT = 1 << 12;
+
+  // Nominal number of rows, used to estimate costs independently of the
+  // content of the table when statements are prepared
+  const double NOMINAL_ROWS = 1e6;
+
+  struct ColumnarVtab
+  {
+    sqlite3_vtab base;
+    ColumnarTable* table;
+  };
+
+  struct ColumnarCursor
+  {
+    sqlite3_vtab_cursor base;
+    ColumnarTable* table;
+    ColumnarTable::Index index;  // null if iterating over rows
+    size_t pos;
+    size_t end;
+  };
+
+  //==========================================================================
+  // Helpers
+  //==========================================================================
+  ColumnarTable* table_of (sqlite3_vtab_cursor* cur)
+  {
+    return reinterpret_cast<ColumnarCursor*>(cur)->table;
+  }
+
+  size_t current_row (const ColumnarCursor* cursor)
+  {
+    return cursor->index ? (*cursor->index)[cursor->pos] : cursor->pos;
+  }
+
+  void skip_deleted (ColumnarCursor* cursor)
+  {
+    // Rows beyond the size of the table were released during the scan
+    while (cursor->pos < cursor->end && (
+          current_row(cursor) >= cursor->table->size() ||
+          cursor->table->deleted(current_row(cursor))
+          ))
+      cursor->pos++;
+  }
+
+  ColumnarTable::Value to_value (sqlite3_value* v, ColumnarTable::ColumnType t)
+  {
+    ColumnarTable::Value ret;
+    if (t == ColumnarTable::Integer)
+      ret.i = sqlite3_value_type(v) == SQLITE_NULL ?
+        ColumnarTable::null_integer : sqlite3_value_int64(v);
+    else
+      ret.d = sqlite3_value_type(v) == SQLITE_NULL ?
+        std::numeric_limits<double>::quiet_NaN() : sqlite3_value_double(v);
+
+    return ret;
+  }
+
+  //==========================================================================
+  // xConnect, xCreate
+  //==========================================================================
+  int columnar_connect (
+      sqlite3* db, void* aux, int argc, const char* const* argv,
+      sqlite3_vtab** ppVtab, char** pzErr
+      )
+  {
+    ColumnarTable* table = (argc > 2) ?
+      reinterpret_cast<ColumnarEventStore*>(aux)->table(argv[2]) : nullptr;
+
+    if (table == nullptr)
+    {
+      *pzErr = sqlite3_mprintf("No columnar table named %s",
+          argc > 2 ? argv[2] : "");
+      return SQLITE_ERROR;
+    }
+
+    const int rc = sqlite3_declare_vtab(db, table->declaration().c_str());
+    if (rc != SQLITE_OK)
+      return rc;
+
+    ColumnarVtab* vtab = new ColumnarVtab();
+    vtab->table = table;
+    *ppVtab = &vtab->base;
+    return SQLITE_OK;
+  }
+
+  int columnar_create (
+      sqlite3* db, void* aux, int argc, const char* const* argv,
+      sqlite3_vtab** ppVtab, char** pzErr
+      )
+  {
+    const int rc = columnar_connect(db, aux, argc, argv, ppVtab, pzErr);
+    if (rc == SQLITE_OK)
+      reinterpret_cast<ColumnarVtab*>(*ppVtab)->table->set_created(true);
+
+    return rc;
+  }
+
+  //==========================================================================
+  // xDisconnect, xDestroy
+  //==========================================================================
+  int columnar_disconnect (sqlite3_vtab* pVtab)
+  {
+    delete reinterpret_cast<ColumnarVtab*>(pVtab);
+    return SQLITE_OK;
+  }
+
+  int columnar_destroy (sqlite3_vtab* pVtab)
+  {
+    ColumnarTable* table = reinterpret_cast<ColumnarVtab*>(pVtab)->table;
+    table->release();
+    table->set_created(false);
+    return columnar_disconnect(pVtab);
+  }
+
+  //==========================================================================
+  // xBestIndex
+  //==========================================================================
+  int columnar_best_index (sqlite3_vtab* pVtab, sqlite3_index_info* info)
+  {
+    const ColumnarTable* table = reinterpret_cast<ColumnarVtab*>(pVtab)->table;
+    const std::vector<ColumnarTable::Column>& columns = table->columns();
+
+    // Usable constraints per column: [eq, lo, hi]
+    std::vector<std::vector<int>> usable (columns.size(), {-1, -1, -1});
+    for (int iCons = 0; iCons < info->nConstraint; ++iCons)
+    {
+      const sqlite3_index_info::sqlite3_index_constraint& c =
+        info->aConstraint[iCons];
+      const int column = c.iColumn < 0 ? 0 : c.iColumn;
+
+      if (!c.usable || !(column == 0 || columns[column].indexed))
+        continue;
+
+      switch (c.op)
+      {
+        case SQLITE_INDEX_CONSTRAINT_EQ:
+          usable[column][0] = iCons; break;
+        case SQLITE_INDEX_CONSTRAINT_GT:
+        case SQLITE_INDEX_CONSTRAINT_GE:
+          usable[column][1] = iCons; break;
+        case SQLITE_INDEX_CONSTRAINT_LT:
+        case SQLITE_INDEX_CONSTRAINT_LE:
+          usable[column][2] = iCons; break;
+      }
+    }
+
+    // Select the most selective strategy
+    int best_column = 0;
+    int best_flags = 0;
+    double best_cost = NOMINAL_ROWS;
+    double best_rows = NOMINAL_ROWS;
+    for (size_t column = 0; column < columns.size(); ++column)
+    {
+      const std::vector<int>& cons = usable[column];
+      const double penalty = (column == 0) ? 1. : 2.;
+      int flags = 0;
+      double rows = NOMINAL_ROWS;
+      if (cons[0] >= 0)
+      {
+        flags = HAS_EQ;
+        rows = (column == 0) ? 1. : 10.;
+      }
+      else if (cons[1] >= 0 || cons[2] >= 0)
+      {
+        flags = (cons[1] >= 0 ? HAS_LO : 0) | (cons[2] >= 0 ? HAS_HI : 0);
+        rows = NOMINAL_ROWS / ((cons[1] >= 0 && cons[2] >= 0) ? 100. : 3.);
+      }
+      else
+        continue;
+
+      const double cost = penalty * (rows + log(NOMINAL_ROWS));
+      if (cost < best_cost)
+      {
+        best_column = column;
+        best_flags = flags;
+        best_cost = cost;
+        best_rows = rows;
+      }
+    }
+
+    int argv_index = 1;
+    const std::vector<int>& cons = usable[best_column];
+    if (best_flags & HAS_EQ)
+      info->aConstraintUsage[cons[0]].argvIndex = argv_index++;
+
+    if (best_flags & HAS_LO)
+    {
+      info->aConstraintUsage[cons[1]].argvIndex = argv_index++;
+      if (info->aConstraint[cons[1]].op == SQLITE_INDEX_CONSTRAINT_GT)
+        best_flags |= LO_STRICT;
+    }
+
+    if (best_flags & HAS_HI)
+    {
+      info->aConstraintUsage[cons[2]].argvIndex = argv_index++;
+      if (info->aConstraint[cons[2]].op == SQLITE_INDEX_CONSTRAINT_LT)
+        best_flags |= HI_STRICT;
+    }
+
+    info->idxNum = best_column | best_flags;
+    info->estimatedCost = best_cost;
+    info->estimatedRows = static_cast<sqlite3_int64>(best_rows);
+    if (best_column == 0 && (best_flags & HAS_EQ))
+      info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+
+    // Rows are visited by ascending value of the searched column
+    if (info->nOrderBy == 1 && !info->aOrderBy[0].desc)
+    {
+      const int order_column = info->aOrderBy[0].iColumn < 0 ?
+        0 : info->aOrderBy[0].iColumn;
+      if (order_column == best_column)
+        info->orderByConsumed = 1;
+    }
+
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xOpen, xClose
+  //==========================================================================
+  int columnar_open (sqlite3_vtab* pVtab, sqlite3_vtab_cursor** ppCursor)
+  {
+    ColumnarCursor* cursor = new ColumnarCursor();
+    cursor->table = reinterpret_cast<ColumnarVtab*>(pVtab)->table;
+    cursor->pos = cursor->end = 0;
+    *ppCursor = &cursor->base;
+    return SQLITE_OK;
+  }
+
+  int columnar_close (sqlite3_vtab_cursor* cur)
+  {
+    delete reinterpret_cast<ColumnarCursor*>(cur);
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xFilter
+  //==========================================================================
+  int columnar_filter (
+      sqlite3_vtab_cursor* cur, int idxNum, const char*,
+      int argc, sqlite3_value** argv
+      )
+  {
+    ColumnarCursor* cursor = reinterpret_cast<ColumnarCursor*>(cur);
+    ColumnarTable* table = cursor->table;
+    const int column = idxNum & COLUMN_MASK;
+
+    sqlite3_int64 lo = std::numeric_limits<sqlite3_int64>::min();
+    sqlite3_int64 hi = std::numeric_limits<sqlite3_int64>::max();
+    bool valid = true;
+    int iArg = 0;
+    if ((idxNum & HAS_EQ) && iArg < argc)
+    {
+      valid &= lower_bound_of(argv[iArg], false, lo);
+      valid &= upper_bound_of(argv[iArg++], false, hi);
+    }
+    if ((idxNum & HAS_LO) && iArg < argc)
+      valid &= lower_bound_of(argv[iArg++], idxNum & LO_STRICT, lo);
+    if ((idxNum & HAS_HI) && iArg < argc)
+      valid &= upper_bound_of(argv[iArg++], idxNum & HI_STRICT, hi);
+
+    cursor->index.reset();
+    if (!valid || lo > hi)
+    {
+      cursor->pos = cursor->end = 0;
+    }
+    else if (column == 0)
+    {
+      cursor->pos = table->lower_bound(lo);
+      cursor->end = (hi == std::numeric_limits<int64_t>::max()) ?
+        table->size() : table->lower_bound(hi + 1);
+    }
+    else
+    {
+      cursor->index = table->index(column);
+      const std::vector<uint32_t>& index = *cursor->index;
+      cursor->pos = std::lower_bound(index.begin(), index.end(), lo,
+          [table, column](uint32_t row, int64_t value)
+          { return table->get(row, column).i < value; }
+          ) - index.begin();
+      cursor->end = std::upper_bound(index.begin(), index.end(), hi,
+          [table, column](int64_t value, uint32_t row)
+          { return value < table->get(row, column).i; }
+          ) - index.begin();
+    }
+
+    skip_deleted(cursor);
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xNext, xEof, xColumn, xRowid
+  //==========================================================================
+  int columnar_next (sqlite3_vtab_cursor* cur)
+  {
+    ColumnarCursor* cursor = reinterpret_cast<ColumnarCursor*>(cur);
+    cursor->pos++;
+    skip_deleted(cursor);
+    return SQLITE_OK;
+  }
+
+  int columnar_eof (sqlite3_vtab_cursor* cur)
+  {
+    ColumnarCursor* cursor = reinterpret_cast<ColumnarCursor*>(cur);
+    return cursor->pos >= cursor->end;
+  }
+
+  int columnar_column (sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int i)
+  {
+    const ColumnarCursor* cursor = reinterpret_cast<ColumnarCursor*>(cur);
+    const ColumnarTable* table = cursor->table;
+    const ColumnarTable::Value value = table->get(current_row(cursor), i);
+
+    if (table->columns()[i].type == ColumnarTable::Integer)
+    {
+      if (value.i == ColumnarTable::null_integer)
+        sqlite3_result_null(ctx);
+      else
+        sqlite3_result_int64(ctx, value.i);
+    }
+    else
+      sqlite3_result_double(ctx, value.d); // NaN is returned as NULL
+
+    return SQLITE_OK;
+  }
+
+  int columnar_rowid (sqlite3_vtab_cursor* cur, sqlite3_int64* pRowid)
+  {
+    const ColumnarCursor* cursor = reinterpret_cast<ColumnarCursor*>(cur);
+    *pRowid = table_of(cur)->id(current_row(cursor));
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xUpdate
+  //==========================================================================
+  int columnar_update (
+      sqlite3_vtab* pVtab, int argc, sqlite3_value** argv,
+      sqlite3_int64* pRowid
+      )
+  {
+    ColumnarTable* table = reinterpret_cast<ColumnarVtab*>(pVtab)->table;
+    const std::vector<ColumnarTable::Column>& columns = table->columns();
+
+    // Row identified by the rowid in argv[0], if any
+    size_t row = table->size();
+    if (sqlite3_value_type(argv[0]) != SQLITE_NULL)
+    {
+      const int64_t id = sqlite3_value_int64(argv[0]);
+      row = table->lower_bound(id);
+      if (row >= table->size() || table->id(row) != id || table->deleted(row))
+        return SQLITE_OK;
+    }
+
+    // DELETE
+    if (argc == 1)
+    {
+      table->remove(row);
+      return SQLITE_OK;
+    }
+
+    try
+    {
+      // INSERT
+      if (sqlite3_value_type(argv[0]) == SQLITE_NULL)
+      {
+        int64_t id = 0;
+        if (sqlite3_value_type(argv[1]) != SQLITE_NULL)
+          id = sqlite3_value_int64(argv[1]);
+        else if (sqlite3_value_type(argv[2]) != SQLITE_NULL)
+          id = sqlite3_value_int64(argv[2]);
+
+        std::vector<ColumnarTable::Value> values (columns.size() - 1);
+        for (size_t iCol = 1; iCol < columns.size(); ++iCol)
+          values[iCol - 1] = to_value(argv[2 + iCol], columns[iCol].type);
+
+        *pRowid = table->append(values.data(), id);
+        return SQLITE_OK;
+      }
+
+      // UPDATE
+      const int64_t id = sqlite3_value_int64(argv[0]);
+      if (sqlite3_value_int64(argv[1]) != id ||
+          (sqlite3_value_type(argv[2]) != SQLITE_NULL &&
+           sqlite3_value_int64(argv[2]) != id))
+        throw std::logic_error("Cannot update the identifier of a row");
+
+      for (size_t iCol = 1; iCol < columns.size(); ++iCol)
+      {
+        const ColumnarTable::Value value =
+          to_value(argv[2 + iCol], columns[iCol].type);
+        const ColumnarTable::Value old = table->get(row, iCol);
+        if (memcmp(&value, &old, sizeof(value)) != 0)
+          table->update(row, iCol, value);
+      }
+    }
+    catch (const std::logic_error& e)
+    {
+      sqlite3_free(pVtab->zErrMsg);
+      pVtab->zErrMsg = sqlite3_mprintf("%s: %s", table->name().c_str(), e.what());
+      return SQLITE_CONSTRAINT;
+    }
+
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xBegin, xSync, xCommit, xRollback
+  //==========================================================================
+  int columnar_begin (sqlite3_vtab* pVtab)
+  {
+    reinterpret_cast<ColumnarVtab*>(pVtab)->table->begin();
+    return SQLITE_OK;
+  }
+
+  int columnar_sync (sqlite3_vtab*)
+  {
+    return SQLITE_OK;
+  }
+
+  int columnar_commit (sqlite3_vtab* pVtab)
+  {
+    reinterpret_cast<ColumnarVtab*>(pVtab)->table->commit();
+    return SQLITE_OK;
+  }
+
+  int columnar_rollback (sqlite3_vtab* pVtab)
+  {
+    reinterpret_cast<ColumnarVtab*>(pVtab)->table->rollback();
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xSavepoint, xRelease, xRollbackTo
+  //==========================================================================
+  int columnar_savepoint (sqlite3_vtab* pVtab, int level)
+  {
+    reinterpret_cast<ColumnarVtab*>(pVtab)->table->savepoint(level);
+    return SQLITE_OK;
+  }
+
+  int columnar_release (sqlite3_vtab* pVtab, int level)
+  {
+    reinterpret_cast<ColumnarVtab*>(pVtab)->table->release_savepoint(level);
+    return SQLITE_OK;
+  }
+
+  int columnar_rollback_to (sqlite3_vtab* pVtab, int level)
+  {
+    reinterpret_cast<ColumnarVtab*>(pVtab)->table->rollback_to(level);
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // Module definition
+  //==========================================================================
+  sqlite3_module make_columnar_module ()
+  {
+    sqlite3_module module;
+    memset(&module, 0, sizeof(module));
+    module.iVersion = 2;
+    module.xCreate = columnar_create;
+    module.xConnect = columnar_connect;
+    module.xBestIndex = columnar_best_index;
+    module.xDisconnect = columnar_disconnect;
+    module.xDestroy = columnar_destroy;
+    module.xOpen = columnar_open;
+    module.xClose = columnar_close;
+    module.xFilter = columnar_filter;
+    module.xNext = columnar_next;
+    module.xEof = columnar_eof;
+    module.xColumn = columnar_column;
+    module.xRowid = columnar_rowid;
+    module.xUpdate = columnar_update;
+    module.xBegin = columnar_begin;
+    module.xSync = columnar_sync;
+    module.xCommit = columnar_commit;
+    module.xRollback = columnar_rollback;
+    module.xSavepoint = columnar_savepoint;
+    module.xRelease = columnar_release;
+    module.xRollbackTo = columnar_rollback_to;
+    return module;
+  }
+
+  const sqlite3_module s_columnar_module = make_columnar_module();
+
+  //==========================================================================
+  // destroy_store: destructor of the module client data
+  //==========================================================================
+  void destroy_store (void* p)
+  {
+    ColumnarEventStore* store = reinterpret_cast<ColumnarEventStore*>(p);
+    {
+      std::lock_guard<std::mutex> lock (s_stores_mutex);
+      for (auto it = s_stores.begin(); it != s_stores.end(); )
+        it = (it->second == store) ? s_stores.erase(it) : std::next(it);
+    }
+
+    delete store;
+    s_generation++;
+  }
+}
+
+
+namespace SQLamarr
+{
+  //==========================================================================
+  // ColumnarEventStore: constructor
+  //==========================================================================
+  ColumnarEventStore::ColumnarEventStore ()
+    : m_particles ("GenParticles", {
+        {"genparticle_id",    ColumnarTable::Integer, false},
+        {"genevent_id",       ColumnarTable::Integer, true},
+        {"hepmc_id",          ColumnarTable::Integer, false},
+        {"production_vertex", ColumnarTable::Integer, true},
+        {"end_vertex",        ColumnarTable::Integer, true},
+        {"pid",               ColumnarTable::Integer, false},
+        {"status",            ColumnarTable::Integer, false},
+        {"pe",                ColumnarTable::Real,    false},
+        {"px",                ColumnarTable::Real,    false},
+        {"py",                ColumnarTable::Real,    false},
+        {"pz",                ColumnarTable::Real,    false},
+        {"m",                 ColumnarTable::Real,    false}
+      })
+    , m_vertices ("GenVertices", {
+        {"genvertex_id",      ColumnarTable::Integer, false},
+        {"genevent_id",       ColumnarTable::Integer, true},
+        {"hepmc_id",          ColumnarTable::Integer, false},
+        {"status",            ColumnarTable::Integer, false},
+        {"t",                 ColumnarTable::Real,    false},
+        {"x",                 ColumnarTable::Real,    false},
+        {"y",                 ColumnarTable::Real,    false},
+        {"z",                 ColumnarTable::Real,    false},
+        {"is_primary",        ColumnarTable::Integer, false}
+      })
+  {}
+
+  //==========================================================================
+  // ColumnarEventStore: table
+  //==========================================================================
+  ColumnarTable* ColumnarEventStore::table (const std::string& name)
+  {
+    if (sqlite3_stricmp(name.c_str(), m_particles.name().c_str()) == 0)
+      return &m_particles;
+
+    if (sqlite3_stricmp(name.c_str(), m_vertices.name().c_str()) == 0)
+      return &m_vertices;
+
+    return nullptr;
+  }
+
+  //==========================================================================
+  // ColumnarEventStore: attach
+  //==========================================================================
+  ColumnarEventStore* ColumnarEventStore::attach (SQLite3DB& db)
+  {
+    ColumnarEventStore* store = get(db.get());
+    if (store != nullptr)
+      return store;
+
+    store = new ColumnarEventStore();
+    {
+      std::lock_guard<std::mutex> lock (s_stores_mutex);
+      s_stores[db.get()] = store;
+    }
+
+    // On failure, the store is deleted by sqlite3_create_module_v2
+    if (sqlite3_create_module_v2(db.get(), "sqlamarr_columnar",
+          &s_columnar_module, store, destroy_store) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+      throw SQLiteError("Failed registering the columnar event store");
+    }
+    s_generation++;
+
+    char* zErrMsg = nullptr;
+    if (sqlite3_exec(db.get(),
+          "CREATE VIRTUAL TABLE IF NOT EXISTS temp.GenVertices "
+          "  USING sqlamarr_columnar; "
+          "CREATE VIRTUAL TABLE IF NOT EXISTS temp.GenParticles "
+          "  USING sqlamarr_columnar; ",
+          nullptr, nullptr, &zErrMsg) != SQLITE_OK)
+    {
+      std::cerr << zErrMsg << std::endl;
+      sqlite3_free(zErrMsg);
+      throw SQLiteError("Failed creating the columnar tables");
+    }
+
+    return store;
+  }
+
+  //==========================================================================
+  // ColumnarEventStore: get
+  //==========================================================================
+  ColumnarEventStore* ColumnarEventStore::get (sqlite3* db)
+  {
+    std::lock_guard<std::mutex> lock (s_stores_mutex);
+    auto it = s_stores.find(db);
+    return (it == s_stores.end()) ? nullptr : it->second;
+  }
+
+  //==========================================================================
+  // ColumnarEventStore: generation
+  //==========================================================================
+  unsigned int ColumnarEventStore::generation ()
+  {
+    return s_generation.load();
+  }
+}
@@ -38,14 +38,14 @@ namespace SQLamarr
   {
     int counter = 0;
     char buffer[1024];
-    exec_stmt(get_statement("BEGIN", "BEGIN EXCLUSIVE TRANSACTION"));
+    begin_transaction(/*exclusive*/ true);
     for (auto& query: m_queries)
     {
       sprintf(buffer, "EditEventStore%02d", counter++);
       exec_stmt(get_statement(buffer, query.c_str()));
     }
       
-    exec_stmt(get_statement("COMMIT", "COMMIT TRANSACTION"));
+    end_transaction();
   }
 }
 
@@ -0,0 +1,149 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// POSIX
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Standard C
+#include <stdio.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+// SQLamarr
+#include "SQLamarr/EventIndex.h"
+
+namespace SQLamarr
+{
+  namespace
+  {
+    const char magic[8] = "SQLMIDX";
+
+    struct CacheHeader
+    {
+      char magic[8];
+      uint64_t file_size;
+      int64_t file_mtime;
+      uint64_t n_offsets;
+    };
+  }
+
+  //==========================================================================
+  // constructor
+  //==========================================================================
+  EventIndex::EventIndex (const std::string& file_path)
+    : m_offsets ()
+    , m_file_size (0)
+    , m_file_mtime (0)
+    , m_cached (false)
+  {
+    struct stat st;
+    if (stat(file_path.c_str(), &st) != 0)
+      throw std::invalid_argument("Cannot index " + file_path);
+
+    m_file_size = st.st_size;
+    m_file_mtime = st.st_mtime;
+
+    m_cached = read_cache(file_path);
+    if (!m_cached)
+    {
+      build(file_path);
+      write_cache(file_path);
+    }
+  }
+
+  //==========================================================================
+  // read_cache
+  //==========================================================================
+  bool EventIndex::read_cache (const std::string& file_path)
+  {
+    std::ifstream cache (cache_path(file_path), std::ios::binary);
+    CacheHeader header;
+    if (!cache.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+        header.file_size != m_file_size ||
+        header.file_mtime != m_file_mtime ||
+        header.n_offsets == 0 || header.n_offsets > m_file_size + 1)
+      return false;
+
+    m_offsets.resize(header.n_offsets);
+    if (!cache.read(reinterpret_cast<char*>(m_offsets.data()), 
+          m_offsets.size() * sizeof(uint64_t)))
+    {
+      m_offsets.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  //==========================================================================
+  // build
+  //==========================================================================
+  void EventIndex::build (const std::string& file_path)
+  {
+    std::ifstream file (file_path, std::ios::binary);
+    if (!file.is_open())
+      throw std::invalid_argument("Cannot index " + file_path);
+
+    m_offsets.clear();
+    uint64_t pos = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+      if (line.compare(0, 2, "E ") == 0)
+        m_offsets.push_back(pos);
+      else if (!m_offsets.empty() && line.compare(0, 7, "HepMC::") == 0)
+        break; // End of the event listing
+
+      pos += line.size() + 1;
+    }
+
+    m_offsets.push_back(std::min(pos, m_file_size));
+  }
+
+  //==========================================================================
+  // write_cache
+  //==========================================================================
+  void EventIndex::write_cache (const std::string& file_path) const
+  {
+    // Written to a temporary file and renamed, so that concurrent workers
+    // never read a partially written cache
+    const std::string path = cache_path(file_path);
+    const std::string tmp_path = path + ".tmp" + 
+      std::to_string(getpid()) + "_" +
+      std::to_string(reinterpret_cast<uintptr_t>(this));
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(magic));
+    header.file_size = m_file_size;
+    header.file_mtime = m_file_mtime;
+    header.n_offsets = m_offsets.size();
+
+    {
+      std::ofstream cache (tmp_path, std::ios::binary | std::ios::trunc);
+      cache.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      cache.write(reinterpret_cast<const char*>(m_offsets.data()), 
+          m_offsets.size() * sizeof(uint64_t));
+      if (!cache)
+      {
+        remove(tmp_path.c_str());
+        return;
+      }
+    }
+
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+      remove(tmp_path.c_str());
+  }
+}
@@ -10,10 +10,11 @@
 
 // STL
 #include <iostream>
-#include <algorithm>
 
 // Local
 #include "SQLamarr/HepMC2DataLoader.h"
+#include "SQLamarr/BinaryEventFile.h"
+#include "SQLamarr/input_streams.h"
 #include "SQLamarr/db_functions.h"
 #include "SQLamarr/preprocessor_symbols.h"
 
@@ -28,66 +29,88 @@ namespace SQLamarr
       size_t evt_number
       )
   {
-    begin_transaction();
-    const int ds_id = insert_event(file_path, run_number, evt_number);
+    load(file_path, run_number, evt_number, 0, all_events);
+  }
 
-    HepMC3::ReaderAsciiHepMC2 reader(file_path.c_str());
+  //==========================================================================
+  // load (range of events)
+  //==========================================================================
+  void HepMC2DataLoader::load (
+      const std::string& file_path, 
+      size_t run_number, 
+      size_t evt_number,
+      size_t first_event,
+      size_t max_events
+      )
+  {
+    std::shared_ptr<std::istream> stream = 
+      open_input_stream(file_path, first_event);
+    HepMC3::ReaderAsciiHepMC2 reader(*stream);
+    load_hepmc_events(reader, file_path, run_number, evt_number, 
+        first_event, max_events);
+  }
+
+  //==========================================================================
+  // convert_to_binary
+  //==========================================================================
+  void HepMC2DataLoader::convert_to_binary (
+      const std::string& file_path, 
+      const std::string& output_path
+      )
+  {
+    BinaryEventWriter writer(output_path);
+
+    std::shared_ptr<std::istream> stream = open_input_stream(file_path);
+    HepMC3::ReaderAsciiHepMC2 reader(*stream);
+    VertexMapping vertex_mapping;
+    HepMC3::GenEvent evt(HepMC3::Units::MEV, HepMC3::Units::MM);
     while ( !reader.failed() ) 
     {
-      HepMC3::GenEvent evt(HepMC3::Units::MEV, HepMC3::Units::MM);
       reader.read_event(evt);
+      if (reader.failed())
+        break;
 
       auto pos = evt.event_pos();
-      const int event_id = insert_collision(
-          ds_id,
-          evt.event_number(),
-          pos.t(),
-          pos.x(),
-          pos.y(),
-          pos.z()
-          );
+      writer.add_collision(
+          evt.event_number(), pos.t(), pos.x(), pos.y(), pos.z());
 
-      std::vector<int> pvs;
-      for (auto& bp: evt.beams())
-        if (bp->end_vertex())
-          pvs.push_back(bp->end_vertex()->id());
-
-      std::unordered_map<int, int> vtxid_mapping;
-      for (auto vertex: evt.vertices())
-        vtxid_mapping[vertex->id()] = insert_vertex(
-              event_id,
-              vertex->id(),
+      vertex_mapping.reset(evt);
+      for (const auto& vertex: evt.vertices())
+      {
+        const int hepmc_id = vertex->id();
+        const HepMC3::FourVector& position = vertex->position();
+        vertex_mapping[hepmc_id] = writer.add_vertex(
+              hepmc_id,
               vertex->status(),
-              vertex->position().t(),
-              vertex->position().x(),
-              vertex->position().y(),
-              vertex->position().z(),
-              (std::find(pvs.begin(), pvs.end(), vertex->id()) != pvs.end())
+              position.t(),
+              position.x(),
+              position.y(),
+              position.z(),
+              vertex_mapping.is_primary(hepmc_id)
             );
+      }
 
-      for (auto particle: evt.particles())
+      for (const auto& particle: evt.particles())
       {
-        auto pv = particle->production_vertex();
-        auto ev = particle->end_vertex();
+        const HepMC3::GenVertex* pv = particle->production_vertex().get();
+        const HepMC3::GenVertex* ev = particle->end_vertex().get();
+        const HepMC3::FourVector& momentum = particle->momentum();
 
-
-        insert_particle(
-              event_id,
+        writer.add_particle(
               particle->id(),
-              (pv ? vtxid_mapping[pv->id()] : LAMARR_BAD_INDEX),
-              (ev ? vtxid_mapping[ev->id()] : LAMARR_BAD_INDEX),
+              (pv ? vertex_mapping[pv->id()] : -1),
+              (ev ? vertex_mapping[ev->id()] : -1),
               particle->pid(),
               particle->status(),
-              particle->momentum().e(),
-              particle->momentum().px(),
-              particle->momentum().py(),
-              particle->momentum().pz(),
+              momentum.e(),
+              momentum.px(),
+              momentum.py(),
+              momentum.pz(),
               particle->generated_mass()
             );
       }
     }
 
-    end_transaction();
+    writer.write();
   }
 }
-
@@ -0,0 +1,752 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// Standard C
+#include <math.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// HepMC3
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/GenVertex.h"
+#include "HepMC3/ReaderAsciiHepMC2.h"
+
+// SQLamarr
+#include "SQLamarr/HepMC2VirtualTable.h"
+#include "SQLamarr/SQLiteError.h"
+#include "SQLamarr/preprocessor_symbols.h"
+
+namespace
+{
+  using SQLamarr::HepMC2VirtualTable;
+  using SQLamarr::lower_bound_of;
+  using SQLamarr::upper_bound_of;
+
+  /// Event parsed from the file, with the flags of the primary vertices
+  struct ParsedEvent
+  {
+    ParsedEvent () : evt (HepMC3::Units::MEV, HepMC3::Units::MM) {}
+    HepMC3::GenEvent evt;
+    std::vector<HepMC3::GenVertexPtr> vertices;
+    std::vector<HepMC3::GenParticlePtr> particles;
+    std::vector<int> pvs;
+  };
+
+  typedef std::shared_ptr<ParsedEvent> EventPtr;
+
+  //==========================================================================
+  // HepMC2File: lazily indexed HepMC2 ASCII file
+  //==========================================================================
+  class HepMC2File
+  {
+    public:
+      HepMC2File (const std::string& file_path);
+
+      /// True if the file contains the `index`-th event (0-based)
+      bool has_event (size_t index);
+
+      /// Parse the `index`-th event (0-based), or return it from the cache
+      EventPtr event (size_t index);
+
+    private:
+      /// Read the next line of the file, recording the events found.
+      /// Returns false if the end of the event listing was reached.
+      bool scan_line ();
+
+    private:
+      const std::string m_file_path;
+      std::ifstream m_scan;
+      std::ifstream m_read;
+      std::vector<std::streamoff> m_offsets;
+      std::streamoff m_pos;
+      bool m_complete;
+      std::vector<std::pair<size_t, EventPtr>> m_cache;
+
+      static const size_t cache_size = 4;
+  };
+
+  HepMC2File::HepMC2File (const std::string& file_path)
+    : m_file_path (file_path)
+    , m_scan (file_path, std::ios::binary)
+    , m_read (file_path, std::ios::binary)
+    , m_offsets ()
+    , m_pos (0)
+    , m_complete (false)
+    , m_cache ()
+  {
+    if (!m_scan.is_open() || !m_read.is_open())
+      throw std::runtime_error("Cannot open " + file_path);
+  }
+
+  bool HepMC2File::scan_line ()
+  {
+    std::string line;
+    if (m_complete || !std::getline(m_scan, line))
+    {
+      m_complete = true;
+      return false;
+    }
+
+    if (line.compare(0, 2, "E ") == 0)
+      m_offsets.push_back(m_pos);
+    else if (line.compare(0, 30, "HepMC::IO_GenEvent-END_EVENT_L") == 0)
+    {
+      m_complete = true;
+      return false;
+    }
+
+    m_pos += line.size() + 1;
+    return true;
+  }
+
+  bool HepMC2File::has_event (size_t index)
+  {
+    // The event is complete when the next one is found
+    while (m_offsets.size() < index + 2 && scan_line());
+    return index < m_offsets.size();
+  }
+
+  EventPtr HepMC2File::event (size_t index)
+  {
+    for (size_t iEntry = 0; iEntry < m_cache.size(); ++iEntry)
+      if (m_cache[iEntry].first == index)
+      {
+        std::rotate(m_cache.begin() + iEntry, m_cache.begin() + iEntry + 1,
+            m_cache.end());
+        return m_cache.back().second;
+      }
+
+    if (!has_event(index))
+      throw std::out_of_range("Event not found in " + m_file_path);
+
+    const std::streamoff begin = m_offsets[index];
+    const std::streamoff end =
+      (index + 1 < m_offsets.size()) ? m_offsets[index + 1] : m_pos;
+
+    std::string text (end - begin, '\0');
+    m_read.clear();
+    m_read.seekg(begin);
+    m_read.read(&text[0], text.size());
+    if (!m_read)
+      throw std::runtime_error("Failed reading " + m_file_path);
+
+    std::istringstream stream (text);
+    HepMC3::ReaderAsciiHepMC2 reader (stream);
+    EventPtr ret = std::make_shared<ParsedEvent>();
+    if (!reader.read_event(ret->evt))
+      throw std::runtime_error("Failed parsing an event of " + m_file_path);
+
+    for (auto vertex: ret->evt.vertices())
+      ret->vertices.push_back(vertex);
+
+    for (auto particle: ret->evt.particles())
+      ret->particles.push_back(particle);
+
+    for (auto& bp: ret->evt.beams())
+      if (bp->end_vertex())
+        ret->pvs.push_back(bp->end_vertex()->id());
+
+    if (m_cache.size() == cache_size)
+      m_cache.erase(m_cache.begin());
+    m_cache.push_back(std::make_pair(index, ret));
+
+    return ret;
+  }
+
+
+  //==========================================================================
+  // Module state
+  //==========================================================================
+  enum TableKind { Events, Vertices, Particles };
+
+  /// Files opened by the tables of a connection, shared by name
+  struct ModuleData
+  {
+    std::map<std::string, std::weak_ptr<HepMC2File>> files;
+  };
+
+  std::mutex s_modules_mutex;
+  std::unordered_map<sqlite3*, ModuleData*> s_modules;
+
+  // Encoding of the search strategy in idxNum
+  const int BY_ID = 1 << 0;
+  const int HAS_EQ = 1 << 1;
+  const int HAS_LO = 1 << 2;
+  const int LO_STRICT = 1 << 3;
+  const int HAS_HI = 1 << 4;
+  const int HI_STRICT = 1 << 5;
+
+  // Nominal size of the files, used to estimate costs independently of the
+  // content of the file when statements are prepared
+  const double NOMINAL_EVENTS = 1e4;
+  const double NOMINAL_ROWS_PER_EVENT = 1e3;
+
+  const char* const DECLARATIONS[] = {
+    "CREATE TABLE x(genevent_id INTEGER, collision INTEGER, "
+      "datasource_id INTEGER, t REAL, x REAL, y REAL, z REAL)",
+    "CREATE TABLE x(genvertex_id INTEGER, genevent_id INTEGER, "
+      "hepmc_id INTEGER, status INTEGER, t REAL, x REAL, y REAL, z REAL, "
+      "is_primary INTEGER)",
+    "CREATE TABLE x(genparticle_id INTEGER, genevent_id INTEGER, "
+      "hepmc_id INTEGER, production_vertex INTEGER, end_vertex INTEGER, "
+      "pid INTEGER, status INTEGER, pe REAL, px REAL, py REAL, pz REAL, "
+      "m REAL)"
+  };
+
+  struct HepMC2Vtab
+  {
+    sqlite3_vtab base;
+    TableKind kind;
+    std::shared_ptr<HepMC2File> file;
+  };
+
+  struct HepMC2Cursor
+  {
+    sqlite3_vtab_cursor base;
+    TableKind kind;
+    std::shared_ptr<HepMC2File> file;
+    EventPtr event;             // null if the cursor reached the end
+    sqlite3_int64 genevent_id;  // 1-based index of the current event
+    sqlite3_int64 last_event;
+    size_t row;                 // 0-based index of the row in the event
+    size_t end_row;             // one past the last row of the event to visit
+  };
+
+  //==========================================================================
+  // Helpers
+  //==========================================================================
+  std::string unquote (const std::string& arg)
+  {
+    std::string ret = arg;
+    ret.erase(0, ret.find_first_not_of(" \t\n"));
+    ret.erase(ret.find_last_not_of(" \t\n") + 1);
+
+    if (ret.size() >= 2 && (ret[0] == '\'' || ret[0] == '"') &&
+        ret[ret.size() - 1] == ret[0])
+    {
+      const char quote = ret[0];
+      ret = ret.substr(1, ret.size() - 2);
+      const std::string doubled (2, quote);
+      for (size_t pos = ret.find(doubled); pos != std::string::npos;
+          pos = ret.find(doubled, pos + 1))
+        ret.erase(pos, 1);
+    }
+
+    return ret;
+  }
+
+  size_t n_rows (TableKind kind, const ParsedEvent& event)
+  {
+    switch (kind)
+    {
+      case Events: return 1;
+      case Vertices: return event.vertices.size();
+      case Particles: return event.particles.size();
+    }
+    return 0;
+  }
+
+  /// Set the identifier of a vertex as the result, NULL if missing
+  void result_vertex_id (sqlite3_context* ctx, sqlite3_int64 genevent_id,
+      const HepMC3::ConstGenVertexPtr& vertex)
+  {
+    if (!vertex)
+    {
+      sqlite3_result_null(ctx);
+      return;
+    }
+
+    // HepMC3 numbers the vertices of an event as -1, -2, ...
+    sqlite3_result_int64(ctx, 
+        HepMC2VirtualTable::make_id(genevent_id, -vertex->id()));
+  }
+
+  /// Move the cursor to the first row to visit, starting from the current one
+  void seek_row (HepMC2Cursor* cursor)
+  {
+    while (cursor->genevent_id <= cursor->last_event)
+    {
+      const size_t index = cursor->genevent_id - 1;
+      if (!cursor->file->has_event(index))
+        break;
+
+      cursor->event = cursor->file->event(index);
+      if (cursor->row < std::min(cursor->end_row,
+            n_rows(cursor->kind, *cursor->event)))
+        return;
+
+      cursor->genevent_id++;
+      cursor->row = 0;
+    }
+
+    cursor->event.reset();
+  }
+
+  //==========================================================================
+  // xConnect, xCreate
+  //==========================================================================
+  int hepmc2_connect (
+      sqlite3* db, void* aux, int argc, const char* const* argv,
+      sqlite3_vtab** ppVtab, char** pzErr
+      )
+  {
+    if (argc != 5)
+    {
+      *pzErr = sqlite3_mprintf(
+          "Usage: sqlamarr_hepmc2(<file path>, "
+          "GenEvents|GenVertices|GenParticles)");
+      return SQLITE_ERROR;
+    }
+
+    TableKind kind;
+    const std::string table = unquote(argv[4]);
+    if (sqlite3_stricmp(table.c_str(), "GenEvents") == 0)
+      kind = Events;
+    else if (sqlite3_stricmp(table.c_str(), "GenVertices") == 0)
+      kind = Vertices;
+    else if (sqlite3_stricmp(table.c_str(), "GenParticles") == 0)
+      kind = Particles;
+    else
+    {
+      *pzErr = sqlite3_mprintf("Unknown HepMC2 table %s", table.c_str());
+      return SQLITE_ERROR;
+    }
+
+    const std::string file_path = unquote(argv[3]);
+    ModuleData* data = reinterpret_cast<ModuleData*>(aux);
+    std::shared_ptr<HepMC2File> file = data->files[file_path].lock();
+    if (!file)
+    {
+      try
+      {
+        file = std::make_shared<HepMC2File>(file_path);
+      }
+      catch (const std::exception& e)
+      {
+        *pzErr = sqlite3_mprintf("%s", e.what());
+        return SQLITE_ERROR;
+      }
+      data->files[file_path] = file;
+    }
+
+    const int rc = sqlite3_declare_vtab(db, DECLARATIONS[kind]);
+    if (rc != SQLITE_OK)
+      return rc;
+
+    HepMC2Vtab* vtab = new HepMC2Vtab();
+    vtab->kind = kind;
+    vtab->file = file;
+    *ppVtab = &vtab->base;
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xDisconnect
+  //==========================================================================
+  int hepmc2_disconnect (sqlite3_vtab* pVtab)
+  {
+    delete reinterpret_cast<HepMC2Vtab*>(pVtab);
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xBestIndex
+  //==========================================================================
+  int hepmc2_best_index (sqlite3_vtab* pVtab, sqlite3_index_info* info)
+  {
+    const TableKind kind = reinterpret_cast<HepMC2Vtab*>(pVtab)->kind;
+    const int event_column = (kind == Events) ? 0 : 1;
+    const double rows_per_event =
+      (kind == Events) ? 1. : NOMINAL_ROWS_PER_EVENT;
+
+    // Usable constraints: [row id, event eq, event lo, event hi]
+    int usable[4] = {-1, -1, -1, -1};
+    for (int iCons = 0; iCons < info->nConstraint; ++iCons)
+    {
+      const sqlite3_index_info::sqlite3_index_constraint& c =
+        info->aConstraint[iCons];
+      const int column = c.iColumn < 0 ? 0 : c.iColumn;
+
+      if (!c.usable)
+        continue;
+
+      if (column == 0 && kind != Events && c.op == SQLITE_INDEX_CONSTRAINT_EQ)
+        usable[0] = iCons;
+      else if (column == event_column)
+        switch (c.op)
+        {
+          case SQLITE_INDEX_CONSTRAINT_EQ:
+            usable[1] = iCons; break;
+          case SQLITE_INDEX_CONSTRAINT_GT:
+          case SQLITE_INDEX_CONSTRAINT_GE:
+            usable[2] = iCons; break;
+          case SQLITE_INDEX_CONSTRAINT_LT:
+          case SQLITE_INDEX_CONSTRAINT_LE:
+            usable[3] = iCons; break;
+        }
+    }
+
+    // Parsing an event costs much more than returning one of its rows
+    int flags = 0;
+    double events = NOMINAL_EVENTS;
+    double rows = NOMINAL_EVENTS * rows_per_event;
+    if (usable[0] >= 0)
+    {
+      flags = BY_ID;
+      info->aConstraintUsage[usable[0]].argvIndex = 1;
+      events = 1.;
+      rows = 1.;
+    }
+    else if (usable[1] >= 0)
+    {
+      flags = HAS_EQ;
+      info->aConstraintUsage[usable[1]].argvIndex = 1;
+      events = 1.;
+      rows = rows_per_event;
+    }
+    else if (usable[2] >= 0 || usable[3] >= 0)
+    {
+      int argv_index = 1;
+      if (usable[2] >= 0)
+      {
+        flags |= HAS_LO;
+        info->aConstraintUsage[usable[2]].argvIndex = argv_index++;
+        if (info->aConstraint[usable[2]].op == SQLITE_INDEX_CONSTRAINT_GT)
+          flags |= LO_STRICT;
+      }
+      if (usable[3] >= 0)
+      {
+        flags |= HAS_HI;
+        info->aConstraintUsage[usable[3]].argvIndex = argv_index++;
+        if (info->aConstraint[usable[3]].op == SQLITE_INDEX_CONSTRAINT_LT)
+          flags |= HI_STRICT;
+      }
+
+      events = NOMINAL_EVENTS / ((usable[2] >= 0 && usable[3] >= 0) ? 100. : 3.);
+      rows = events * rows_per_event;
+    }
+
+    info->idxNum = flags;
+    info->estimatedCost = 10. * rows_per_event * events + rows;
+    info->estimatedRows = static_cast<sqlite3_int64>(rows);
+    if (flags & BY_ID)
+      info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+
+    // Rows are visited by ascending identifier and genevent_id
+    if (info->nOrderBy == 1 && !info->aOrderBy[0].desc)
+    {
+      const int order_column = info->aOrderBy[0].iColumn < 0 ?
+        0 : info->aOrderBy[0].iColumn;
+      if (order_column == 0 || order_column == event_column)
+        info->orderByConsumed = 1;
+    }
+
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xOpen, xClose
+  //==========================================================================
+  int hepmc2_open (sqlite3_vtab* pVtab, sqlite3_vtab_cursor** ppCursor)
+  {
+    HepMC2Vtab* vtab = reinterpret_cast<HepMC2Vtab*>(pVtab);
+    HepMC2Cursor* cursor = new HepMC2Cursor();
+    cursor->kind = vtab->kind;
+    cursor->file = vtab->file;
+    cursor->genevent_id = cursor->last_event = 0;
+    cursor->row = cursor->end_row = 0;
+    *ppCursor = &cursor->base;
+    return SQLITE_OK;
+  }
+
+  int hepmc2_close (sqlite3_vtab_cursor* cur)
+  {
+    delete reinterpret_cast<HepMC2Cursor*>(cur);
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xFilter
+  //==========================================================================
+  int hepmc2_filter (
+      sqlite3_vtab_cursor* cur, int idxNum, const char*,
+      int argc, sqlite3_value** argv
+      )
+  {
+    HepMC2Cursor* cursor = reinterpret_cast<HepMC2Cursor*>(cur);
+
+    sqlite3_int64 lo = 1;
+    sqlite3_int64 hi = std::numeric_limits<sqlite3_int64>::max();
+    size_t first_row = 0;
+    size_t end_row = std::numeric_limits<size_t>::max();
+    bool valid = true;
+    int iArg = 0;
+    if ((idxNum & BY_ID) && iArg < argc)
+    {
+      sqlite3_int64 id = 0;
+      valid &= lower_bound_of(argv[iArg], false, id);
+      valid &= upper_bound_of(argv[iArg++], false, id) && id > 0;
+      lo = hi = id >> HepMC2VirtualTable::row_bits;
+      first_row = (id & ((1 << HepMC2VirtualTable::row_bits) - 1)) - 1;
+      end_row = first_row + 1;
+    }
+    if ((idxNum & HAS_EQ) && iArg < argc)
+    {
+      valid &= lower_bound_of(argv[iArg], false, lo);
+      valid &= upper_bound_of(argv[iArg++], false, hi);
+    }
+    if ((idxNum & HAS_LO) && iArg < argc)
+      valid &= lower_bound_of(argv[iArg++], idxNum & LO_STRICT, lo);
+    if ((idxNum & HAS_HI) && iArg < argc)
+      valid &= upper_bound_of(argv[iArg++], idxNum & HI_STRICT, hi);
+
+    cursor->genevent_id = std::max<sqlite3_int64>(lo, 1);
+    cursor->last_event = hi;
+    cursor->row = first_row;
+    cursor->end_row = end_row;
+    cursor->event.reset();
+
+    if (!valid || cursor->genevent_id > cursor->last_event)
+      return SQLITE_OK;
+
+    try
+    {
+      seek_row(cursor);
+    }
+    catch (const std::exception& e)
+    {
+      sqlite3_free(cur->pVtab->zErrMsg);
+      cur->pVtab->zErrMsg = sqlite3_mprintf("%s", e.what());
+      return SQLITE_ERROR;
+    }
+
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // xNext, xEof, xColumn, xRowid
+  //==========================================================================
+  int hepmc2_next (sqlite3_vtab_cursor* cur)
+  {
+    HepMC2Cursor* cursor = reinterpret_cast<HepMC2Cursor*>(cur);
+    cursor->row++;
+
+    try
+    {
+      seek_row(cursor);
+    }
+    catch (const std::exception& e)
+    {
+      sqlite3_free(cur->pVtab->zErrMsg);
+      cur->pVtab->zErrMsg = sqlite3_mprintf("%s", e.what());
+      return SQLITE_ERROR;
+    }
+
+    return SQLITE_OK;
+  }
+
+  int hepmc2_eof (sqlite3_vtab_cursor* cur)
+  {
+    return reinterpret_cast<HepMC2Cursor*>(cur)->event == nullptr;
+  }
+
+  int hepmc2_column (sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int i)
+  {
+    const HepMC2Cursor* cursor = reinterpret_cast<HepMC2Cursor*>(cur);
+    const ParsedEvent& event = *cursor->event;
+    const sqlite3_int64 genevent_id = cursor->genevent_id;
+    const int row_id = static_cast<int>(cursor->row) + 1;
+
+    if (cursor->kind == Events)
+    {
+      const HepMC3::FourVector& pos = event.evt.event_pos();
+      switch (i)
+      {
+        case 0: sqlite3_result_int64(ctx, genevent_id); break;
+        case 1: sqlite3_result_int(ctx, event.evt.event_number()); break;
+        case 2: sqlite3_result_null(ctx); break;
+        case 3: sqlite3_result_double(ctx, pos.t()); break;
+        case 4: sqlite3_result_double(ctx, pos.x()); break;
+        case 5: sqlite3_result_double(ctx, pos.y()); break;
+        case 6: sqlite3_result_double(ctx, pos.z()); break;
+      }
+    }
+    else if (cursor->kind == Vertices)
+    {
+      const HepMC3::GenVertexPtr& vertex = event.vertices[cursor->row];
+      const HepMC3::FourVector& pos = vertex->position();
+      switch (i)
+      {
+        case 0: result_vertex_id(ctx, genevent_id, vertex); break;
+        case 1: sqlite3_result_int64(ctx, genevent_id); break;
+        case 2: sqlite3_result_int(ctx, vertex->id()); break;
+        case 3: sqlite3_result_int(ctx, vertex->status()); break;
+        case 4: sqlite3_result_double(ctx, pos.t()); break;
+        case 5: sqlite3_result_double(ctx, pos.x()); break;
+        case 6: sqlite3_result_double(ctx, pos.y()); break;
+        case 7: sqlite3_result_double(ctx, pos.z()); break;
+        case 8:
+          sqlite3_result_int(ctx, std::find(event.pvs.begin(), event.pvs.end(),
+                vertex->id()) != event.pvs.end());
+          break;
+      }
+    }
+    else
+    {
+      const HepMC3::GenParticlePtr& particle = event.particles[cursor->row];
+      switch (i)
+      {
+        case 0:
+          sqlite3_result_int64(ctx,
+              HepMC2VirtualTable::make_id(genevent_id, row_id));
+          break;
+        case 1: sqlite3_result_int64(ctx, genevent_id); break;
+        case 2: sqlite3_result_int(ctx, particle->id()); break;
+        case 3:
+          result_vertex_id(ctx, genevent_id, particle->production_vertex());
+          break;
+        case 4:
+          result_vertex_id(ctx, genevent_id, particle->end_vertex());
+          break;
+        case 5: sqlite3_result_int(ctx, particle->pid()); break;
+        case 6: sqlite3_result_int(ctx, particle->status()); break;
+        case 7: sqlite3_result_double(ctx, particle->momentum().e()); break;
+        case 8: sqlite3_result_double(ctx, particle->momentum().px()); break;
+        case 9: sqlite3_result_double(ctx, particle->momentum().py()); break;
+        case 10: sqlite3_result_double(ctx, particle->momentum().pz()); break;
+        case 11: sqlite3_result_double(ctx, particle->generated_mass()); break;
+      }
+    }
+
+    return SQLITE_OK;
+  }
+
+  int hepmc2_rowid (sqlite3_vtab_cursor* cur, sqlite3_int64* pRowid)
+  {
+    const HepMC2Cursor* cursor = reinterpret_cast<HepMC2Cursor*>(cur);
+    *pRowid = (cursor->kind == Events) ? cursor->genevent_id :
+      HepMC2VirtualTable::make_id(cursor->genevent_id, cursor->row + 1);
+    return SQLITE_OK;
+  }
+
+  //==========================================================================
+  // Module definition
+  //==========================================================================
+  sqlite3_module make_hepmc2_module ()
+  {
+    sqlite3_module module;
+    memset(&module, 0, sizeof(module));
+    module.iVersion = 1;
+    module.xCreate = hepmc2_connect;
+    module.xConnect = hepmc2_connect;
+    module.xBestIndex = hepmc2_best_index;
+    module.xDisconnect = hepmc2_disconnect;
+    module.xDestroy = hepmc2_disconnect;
+    module.xOpen = hepmc2_open;
+    module.xClose = hepmc2_close;
+    module.xFilter = hepmc2_filter;
+    module.xNext = hepmc2_next;
+    module.xEof = hepmc2_eof;
+    module.xColumn = hepmc2_column;
+    module.xRowid = hepmc2_rowid;
+    return module;
+  }
+
+  const sqlite3_module s_hepmc2_module = make_hepmc2_module();
+
+  //==========================================================================
+  // destroy_module_data: destructor of the module client data
+  //==========================================================================
+  void destroy_module_data (void* p)
+  {
+    ModuleData* data = reinterpret_cast<ModuleData*>(p);
+    {
+      std::lock_guard<std::mutex> lock (s_modules_mutex);
+      for (auto it = s_modules.begin(); it != s_modules.end(); )
+        it = (it->second == data) ? s_modules.erase(it) : std::next(it);
+    }
+
+    delete data;
+  }
+}
+
+
+namespace SQLamarr
+{
+  //==========================================================================
+  // HepMC2VirtualTable: register_module
+  //==========================================================================
+  void HepMC2VirtualTable::register_module (SQLite3DB& db)
+  {
+    ModuleData* data = new ModuleData();
+    {
+      std::lock_guard<std::mutex> lock (s_modules_mutex);
+      if (s_modules.count(db.get()))
+      {
+        delete data;
+        return;
+      }
+      s_modules[db.get()] = data;
+    }
+
+    // On failure, the data is deleted by sqlite3_create_module_v2
+    if (sqlite3_create_module_v2(db.get(), "sqlamarr_hepmc2",
+          &s_hepmc2_module, data, destroy_module_data) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+      throw SQLiteError("Failed registering the HepMC2 module");
+    }
+  }
+
+  //==========================================================================
+  // HepMC2VirtualTable: attach
+  //==========================================================================
+  void HepMC2VirtualTable::attach (
+      SQLite3DB& db,
+      const std::string& file_path,
+      const std::string& prefix
+      )
+  {
+    validate_token(prefix);
+    register_module(db);
+
+    char* path = sqlite3_mprintf("%Q", file_path.c_str());
+    const std::string query =
+      "CREATE VIRTUAL TABLE temp." + prefix + "Events "
+      "  USING sqlamarr_hepmc2(" + path + ", GenEvents); "
+      "CREATE VIRTUAL TABLE temp." + prefix + "Vertices "
+      "  USING sqlamarr_hepmc2(" + path + ", GenVertices); "
+      "CREATE VIRTUAL TABLE temp." + prefix + "Particles "
+      "  USING sqlamarr_hepmc2(" + path + ", GenParticles); ";
+    sqlite3_free(path);
+
+    char* zErrMsg = nullptr;
+    if (sqlite3_exec(db.get(), query.c_str(), nullptr, nullptr, &zErrMsg)
+        != SQLITE_OK)
+    {
+      std::cerr << zErrMsg << std::endl;
+      sqlite3_free(zErrMsg);
+      throw SQLiteError("Failed creating the HepMC2 tables");
+    }
+  }
+}
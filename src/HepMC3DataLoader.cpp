@@ -0,0 +1,46 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+// Local
+#include "SQLamarr/HepMC3DataLoader.h"
+#include "SQLamarr/input_streams.h"
+
+namespace SQLamarr
+{
+  //==========================================================================
+  // load
+  //==========================================================================
+  void HepMC3DataLoader::load (
+      const std::string& file_path, 
+      size_t run_number, 
+      size_t evt_number
+      )
+  {
+    load(file_path, run_number, evt_number, 0, all_events);
+  }
+
+  //==========================================================================
+  // load (range of events)
+  //==========================================================================
+  void HepMC3DataLoader::load (
+      const std::string& file_path, 
+      size_t run_number, 
+      size_t evt_number,
+      size_t first_event,
+      size_t max_events
+      )
+  {
+    std::shared_ptr<std::istream> stream = 
+      open_input_stream(file_path, first_event);
+    HepMC3::ReaderAscii reader(stream);
+    load_hepmc_events(reader, file_path, run_number, evt_number, 
+        first_event, max_events);
+  }
+}
@@ -38,9 +38,15 @@ namespace SQLamarr
         FROM GenParticles AS p 
         INNER JOIN GenVertices AS v ON v.genvertex_id = p.production_vertex 
         INNER JOIN MCVertices AS mcv ON p.genevent_id = mcv.genevent_id 
-        WHERE v.is_primary == TRUE AND mcv.is_primary == TRUE 
+        WHERE 
+          v.is_primary == TRUE AND mcv.is_primary == TRUE 
+          AND p.genevent_id BETWEEN ? AND ?
         )");
 
+    const auto events = genevent_range();
+    sqlite3_bind_int64(get_root, 1, events.first);
+    sqlite3_bind_int64(get_root, 2, events.second);
+
     begin_transaction();
     bool traversal_status = true;
 
@@ -54,6 +60,8 @@ namespace SQLamarr
 
     if (!traversal_status)
       throw SQLiteError("Graph traversal failed.");
+
+    set_processed(events.second);
   }
 
   //============================================================================
@@ -0,0 +1,378 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+// Standard C
+#include <dlfcn.h>
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+// SQLite3
+#include "sqlite3.h"
+
+// SQLamarr
+#include "SQLamarr/MultiModelPlugin.h"
+#include "SQLamarr/GlobalPRNG.h"
+
+namespace SQLamarr
+{
+  //============================================================================
+  // Constructor
+  //============================================================================
+  MultiModelPlugin::MultiModelPlugin(
+          SQLite3DB& db,
+          const std::string& select_query,
+          const std::vector<std::string> reference_keys
+      )
+    : BaseSqlInterface(db)
+    , m_select_query (select_query)
+    , m_refkeys (reference_keys)
+    , m_selection ()
+    , m_handles ()
+    , m_models ()
+    , m_tables ()
+  {
+    // Throw an error if tokens are not alphanumeric (possible SQL injection)
+    for (const std::string& t: m_refkeys) validate_token(t);
+  }
+
+  //============================================================================
+  // Destructor
+  //============================================================================
+  MultiModelPlugin::~MultiModelPlugin()
+  {
+    for (auto& handle: m_handles)
+      dlclose(handle.second);
+  }
+
+  //============================================================================
+  // set_selection
+  //============================================================================
+  void MultiModelPlugin::set_selection(const std::string& column)
+  {
+    validate_token(column);
+    m_selection = column;
+  }
+
+  //============================================================================
+  // add_model
+  //============================================================================
+  void MultiModelPlugin::add_model(
+      const std::string& library,
+      const std::string& function_name,
+      const std::string& output_table,
+      const std::vector<std::string>& outputs,
+      unsigned int n_random,
+      const std::vector<std::string>& inputs,
+      const std::vector<int64_t>& selected_values
+      )
+  {
+    validate_token(output_table);
+    for (const std::string& t: outputs) validate_token(t);
+    for (const std::string& t: inputs) validate_token(t);
+
+    // Libraries shared by multiple models are linked once
+    if (m_handles.find(library) == m_handles.end())
+    {
+      void* handle = dlopen(library.c_str(), RTLD_LAZY);
+      if (!handle)
+      {
+        std::cerr << "Failure while loading " << library << std::endl;
+        throw std::runtime_error("Failed loading library");
+      }
+      m_handles[library] = handle;
+    }
+
+    Model model;
+    model.function = dlsym(m_handles[library], function_name.c_str());
+    if (!model.function)
+    {
+      std::cerr << "Failure while loading " << function_name << std::endl;
+      throw std::runtime_error("Failed loading function");
+    }
+
+    auto table = std::find_if(m_tables.begin(), m_tables.end(),
+        [&output_table](const OutputTable& t) { return t.name == output_table; }
+        );
+    if (table == m_tables.end())
+    {
+      OutputTable new_table;
+      new_table.name = output_table;
+      table = m_tables.insert(m_tables.end(), new_table);
+    }
+
+    model.n_random = n_random;
+    model.inputs = inputs;
+    model.selected_values = selected_values;
+    model.table = table - m_tables.begin();
+    model.first_output = table->outputs.size();
+    model.n_outputs = outputs.size();
+
+    // Models evaluated on disjoint selections share the columns of the table
+    for (const Model& other: m_models)
+    {
+      if (other.table != model.table || selected_values.empty() ||
+          other.selected_values.empty() || other.n_outputs != outputs.size() ||
+          !std::equal(outputs.begin(), outputs.end(), 
+            table->outputs.begin() + other.first_output))
+        continue;
+
+      for (int64_t value: selected_values)
+        if (std::count(
+              other.selected_values.begin(), other.selected_values.end(), value))
+          throw std::logic_error(
+              "Value " + std::to_string(value) + " selected twice for the "
+              "outputs of " + output_table);
+
+      model.first_output = other.first_output;
+    }
+
+    if (model.first_output == table->outputs.size())
+    {
+      for (const std::string& output: outputs)
+        if (
+            std::count(table->outputs.begin(), table->outputs.end(), output) ||
+            std::count(m_refkeys.begin(), m_refkeys.end(), output)
+           )
+          throw std::logic_error(
+              "Column " + output + " defined twice in " + output_table);
+
+      table->outputs.insert(table->outputs.end(), outputs.begin(), outputs.end());
+    }
+
+    m_models.push_back(model);
+
+    // The statements are composed again including the new model
+    invalidate_cache();
+  }
+
+  //============================================================================
+  // compose_create_query. Internal.
+  //============================================================================
+  std::string MultiModelPlugin::compose_create_query(
+      const OutputTable& table) const
+  {
+    std::stringstream s;
+    s << "CREATE TEMPORARY TABLE IF NOT EXISTS " << table.name << "(";
+
+    for (auto c: m_refkeys)
+      s << c << " INTEGER, ";
+
+    for (size_t iOutput = 0; iOutput < table.outputs.size(); ++iOutput)
+      s << (iOutput ? ", " : "") << table.outputs[iOutput] << " REAL";
+
+    s << ");";
+    return s.str();
+  }
+
+  //============================================================================
+  // compose_insert_query. Internal.
+  //============================================================================
+  std::string MultiModelPlugin::compose_insert_query(
+      const OutputTable& table) const
+  {
+    std::vector<std::string> columns (m_refkeys);
+    columns.insert(columns.end(), table.outputs.begin(), table.outputs.end());
+
+    std::stringstream s;
+    s << "INSERT INTO " << table.name << " (";
+    for (size_t iCol = 0; iCol < columns.size(); ++iCol)
+      s << (iCol ? ", " : "") << columns[iCol];
+
+    s << ") VALUES (";
+    for (size_t iCol = 0; iCol < columns.size(); ++iCol)
+      s << (iCol ? ", ?" : "?");
+    s << ");";
+
+    return s.str();
+  }
+
+  //============================================================================
+  // execute
+  //============================================================================
+  void MultiModelPlugin::execute ()
+  {
+    if (m_models.empty())
+      throw std::logic_error("MultiModelPlugin executed without models");
+
+    sqlite3_stmt* select_input = get_statement("select_input", m_select_query);
+
+    // Map the columns of the query to the reference keys and model inputs
+    const int nCols = sqlite3_column_count(select_input);
+    std::vector<std::string> columns;
+    for (int iCol = 0; iCol < nCols; ++iCol)
+      columns.push_back(sqlite3_column_name(select_input, iCol));
+
+    std::vector<int> key_columns;
+    for (const std::string& key: m_refkeys)
+    {
+      auto column = std::find(columns.begin(), columns.end(), key);
+      if (column == columns.end())
+        throw std::logic_error("Reference key " + key + " not selected");
+
+      key_columns.push_back(column - columns.begin());
+    }
+
+    int selection_column = -1;
+    if (!m_selection.empty())
+    {
+      auto column = std::find(columns.begin(), columns.end(), m_selection);
+      if (column == columns.end())
+        throw std::logic_error("Selection column " + m_selection + " not selected");
+
+      selection_column = column - columns.begin();
+    }
+
+    std::vector<int> default_inputs;
+    for (int iCol = 0; iCol < nCols; ++iCol)
+      if (!std::count(m_refkeys.begin(), m_refkeys.end(), columns[iCol]) &&
+          iCol != selection_column)
+        default_inputs.push_back(iCol);
+
+    std::vector<std::vector<int> > input_columns;
+    for (const Model& model: m_models)
+    {
+      if (!model.selected_values.empty() && selection_column < 0)
+        throw std::logic_error("Models selecting rows need a selection column");
+
+      if (model.inputs.empty())
+      {
+        input_columns.push_back(default_inputs);
+        continue;
+      }
+
+      input_columns.push_back(std::vector<int>());
+      for (const std::string& input: model.inputs)
+      {
+        auto column = std::find(columns.begin(), columns.end(), input);
+        if (column == columns.end())
+          throw std::logic_error("Input column " + input + " not selected");
+
+        input_columns.back().push_back(column - columns.begin());
+      }
+    }
+
+    begin_transaction();
+
+    // Prepare the queries and initialize the output tables
+    std::vector<sqlite3_stmt*> inserts;
+    for (size_t iTable = 0; iTable < m_tables.size(); ++iTable)
+    {
+      const OutputTable& table = m_tables[iTable];
+      const std::string suffix = std::to_string(iTable);
+
+      exec_stmt(get_statement(
+            "create_output_table_" + suffix, compose_create_query(table)));
+
+      exec_stmt(get_statement(
+            "delete_output_table_" + suffix, "DELETE FROM " + table.name + ";"));
+
+      inserts.push_back(get_statement(
+            "insert_in_output_table_" + suffix, compose_insert_query(table)));
+    }
+
+    // Columns converted to float once per row, whichever model uses them
+    std::vector<int> used_columns;
+    for (int iCol = 0; iCol < nCols; ++iCol)
+      for (const std::vector<int>& model_columns: input_columns)
+        if (std::count(model_columns.begin(), model_columns.end(), iCol))
+        {
+          used_columns.push_back(iCol);
+          break;
+        }
+
+    // Buffers for the row, the model inputs and outputs
+    std::vector<float> row (nCols);
+    std::vector<float> input, rnd;
+    std::vector<std::vector<float> > outputs;
+    for (const OutputTable& table: m_tables)
+      outputs.push_back(std::vector<float>(table.outputs.size()));
+
+    // Tables with at least one model evaluated on the current row
+    std::vector<bool> filled (m_tables.size());
+
+    std::normal_distribution<float> gaussian;
+
+    // Main loop on selected rows, each read once for all the models
+    while (exec_stmt(select_input))
+    {
+      for (int iCol: used_columns)
+        row[iCol] = read_as_float(select_input, iCol);
+
+      const int64_t selection = (selection_column < 0) ? 0 :
+        sqlite3_column_int64(select_input, selection_column);
+
+      // Outputs of the models not evaluated are stored as NULL
+      for (std::vector<float>& table_outputs: outputs)
+        std::fill(table_outputs.begin(), table_outputs.end(), 
+            std::numeric_limits<float>::quiet_NaN());
+      std::fill(filled.begin(), filled.end(), false);
+
+      for (size_t iModel = 0; iModel < m_models.size(); ++iModel)
+      {
+        const Model& model = m_models[iModel];
+        if (!model.selected_values.empty() && !std::count(
+              model.selected_values.begin(), model.selected_values.end(), 
+              selection))
+          continue;
+
+        filled[model.table] = true;
+        input.clear();
+        for (int iCol: input_columns[iModel])
+          input.push_back(row[iCol]);
+
+        float* output = outputs[model.table].data() + model.first_output;
+        if (model.n_random == 0)
+          reinterpret_cast<mlfunc>(model.function)(output, input.data());
+        else
+        {
+          auto generator = GlobalPRNG::get_or_create(m_database.get());
+          rnd.resize(model.n_random);
+          for (float& r: rnd)
+            r = gaussian(*generator);
+
+          reinterpret_cast<genfunc>(model.function)(
+              output, input.data(), rnd.data());
+        }
+      }
+
+      // Fill the output tables with the reference keys and the outputs
+      for (size_t iTable = 0; iTable < m_tables.size(); ++iTable)
+      {
+        if (!filled[iTable])
+          continue;
+
+        sqlite3_stmt* insert = inserts[iTable];
+        sqlite3_reset(insert);
+
+        for (size_t iKey = 0; iKey < key_columns.size(); ++iKey)
+          sqlite3_bind_int64(insert, iKey + 1,
+              sqlite3_column_int64(select_input, key_columns[iKey]));
+
+        for (size_t iOutput = 0; iOutput < outputs[iTable].size(); ++iOutput)
+          if (std::isnan(outputs[iTable][iOutput]))
+            sqlite3_bind_null(insert, key_columns.size() + iOutput + 1);
+          else
+            sqlite3_bind_double(insert, key_columns.size() + iOutput + 1,
+                outputs[iTable][iOutput]);
+
+        exec_stmt(insert);
+      }
+    }
+
+    end_transaction();
+  }
+}
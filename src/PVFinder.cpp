@@ -21,80 +21,45 @@ namespace SQLamarr
 
   void PVFinder::execute(void) 
   {
-    sqlite3_stmt* make_pv_from_signal = get_statement("make_pv_from_signal", R"(
-      WITH noPV_events
+    // Only the events in the range to be processed are considered, 
+    // relying on the genevent_id indices (see genevent_range).
+    sqlite3_stmt* make_pv = get_statement("make_pv", R"(
+      WITH new_events
       AS (
         SELECT genevent_id
-        FROM GenVertices 
-        GROUP BY genevent_id
-        HAVING 
-          SUM(is_primary) = 0
+        FROM GenEvents
+        WHERE genevent_id BETWEEN :first_genevent_id AND :last_genevent_id
       ),
-      signal_root
-      AS
-      (
-        SELECT 
-          genevent_id, 
-          FIRST_VALUE(production_vertex) 
-            OVER (PARTITION BY genevent_id ORDER BY hepmc_id ASC) AS root_vtx
-        FROM GenParticles 
-        WHERE status==?
-        GROUP BY genevent_id
-      ),
-      selected_vertices 
-      AS
-      (
-        SELECT genvertex_id 
-        FROM GenVertices AS v
-        INNER JOIN noPV_events AS pv ON v.genevent_id = pv.genevent_id
-        INNER JOIN signal_root AS p ON p.root_vtx = v.genvertex_id
-      )
-      UPDATE GenVertices
-      SET 
-        is_primary = TRUE
-      WHERE EXISTS (
-        SELECT NULL FROM selected_vertices 
-        WHERE selected_vertices.genvertex_id = GenVertices.genvertex_id
-        );
-    )");
-
-    sqlite3_stmt* make_pv_from_barcode = get_statement("make_pv_from_barcode", R"(
-      WITH noPV_events
+      noPV_events
       AS (
-        SELECT genevent_id
-        FROM GenVertices 
-        GROUP BY genevent_id
-        HAVING 
-          SUM(is_primary) = 0
-      ),
-      signal_root
-      AS
-      (
-        SELECT 
-          genevent_id, 
-          FIRST_VALUE(production_vertex) 
-            OVER (PARTITION BY genevent_id ORDER BY hepmc_id ASC) AS root_vtx
-        FROM GenParticles 
-        GROUP BY genevent_id
-      ),
-      selected_vertices 
-      AS
-      (
-        SELECT genvertex_id 
-        FROM GenVertices AS v
-        INNER JOIN noPV_events AS pv ON v.genevent_id = pv.genevent_id
-        INNER JOIN signal_root AS p ON p.root_vtx = v.genvertex_id
+        SELECT genevent_id 
+        FROM new_events AS e
+        WHERE NOT EXISTS (
+          SELECT NULL FROM GenVertices AS v 
+          WHERE v.genevent_id = e.genevent_id AND v.is_primary == TRUE
+          )
       )
       UPDATE GenVertices
       SET 
         is_primary = TRUE
-      WHERE EXISTS (
-        SELECT NULL FROM selected_vertices 
-        WHERE selected_vertices.genvertex_id = GenVertices.genvertex_id
+      WHERE genvertex_id IN (
+        SELECT 
+          COALESCE(
+            (
+              SELECT production_vertex FROM GenParticles AS p
+              WHERE p.genevent_id = e.genevent_id AND p.status == :signal_status
+              ORDER BY p.hepmc_id ASC LIMIT 1
+            ),
+            (
+              SELECT production_vertex FROM GenParticles AS p
+              WHERE p.genevent_id = e.genevent_id 
+              ORDER BY p.hepmc_id ASC LIMIT 1
+            )
+          )
+        FROM noPV_events AS e
         );
     )");
 
-
     sqlite3_stmt* import_pv = get_statement("import_pv", R"(
       INSERT INTO MCVertices (
         genvertex_id, genevent_id, 
@@ -108,37 +73,33 @@ namespace SQLamarr
         v.x + e.x, 
         v.y + e.y, 
         v.z + e.z 
-      FROM GenVertices AS v
-      INNER JOIN GenEvents AS e ON e.genevent_id = v.genevent_id
+      FROM GenEvents AS e
+      INNER JOIN GenVertices AS v ON v.genvertex_id = (
+          SELECT genvertex_id FROM GenVertices
+          WHERE genevent_id = e.genevent_id AND is_primary == TRUE
+          ORDER BY hepmc_id DESC LIMIT 1
+          )
       WHERE 
-        v.is_primary == TRUE
-      GROUP BY v.genevent_id
-      HAVING 
-        v.hepmc_id == MAX(v.hepmc_id);
+        e.genevent_id BETWEEN :first_genevent_id AND :last_genevent_id
+      ORDER BY e.genevent_id;
       )");
 
-
-    sqlite3_stmt* count_missing_PVs = get_statement("count_missing_PVs", R"(
-        SELECT COUNT(genevent_id)
-        FROM GenVertices 
-        GROUP BY genevent_id
-        HAVING 
-          SUM(is_primary) = 0
-      )");
-
-    exec_stmt(count_missing_PVs);
-    if (sqlite3_column_int(count_missing_PVs, 0))
+    const auto events = genevent_range();
+    for (sqlite3_stmt* stmt: {make_pv, import_pv})
     {
-      sqlite3_bind_int(make_pv_from_signal, 1, m_signal_status_code);
-      exec_stmt(make_pv_from_signal);
+      sqlite3_bind_int64(stmt, 
+          sqlite3_bind_parameter_index(stmt, ":first_genevent_id"), events.first);
+      sqlite3_bind_int64(stmt, 
+          sqlite3_bind_parameter_index(stmt, ":last_genevent_id"), events.second);
     }
 
-    sqlite3_reset(count_missing_PVs);
-
-    if (sqlite3_column_int(count_missing_PVs, 0))
-      exec_stmt(make_pv_from_barcode);
+    sqlite3_bind_int(make_pv, 
+        sqlite3_bind_parameter_index(make_pv, ":signal_status"), 
+        m_signal_status_code);
 
+    exec_stmt(make_pv);
     exec_stmt(import_pv);
 
+    set_processed(events.second);
   }
 }
@@ -179,7 +179,9 @@ namespace SQLamarr
         ? AS sigma_y,
         ? AS sigma_z
       FROM MCVertices AS mcv
-      WHERE mcv.is_primary == TRUE
+      WHERE 
+        mcv.is_primary == TRUE
+        AND mcv.genevent_id BETWEEN ? AND ?
       )");
 
     int slot_id = 1;
@@ -206,6 +208,11 @@ namespace SQLamarr
       sqlite3_bind_double(reco_pv, slot_id++, min_sigma);
     }
 
+    const auto events = genevent_range();
+    sqlite3_bind_int64(reco_pv, slot_id++, events.first);
+    sqlite3_bind_int64(reco_pv, slot_id++, events.second);
+
     exec_stmt(reco_pv);
+    set_processed(events.second);
   }
 }
@@ -0,0 +1,871 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+// STL
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <typeinfo>
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <iostream>
+
+// SQLamarr
+#include "SQLamarr/Pipeline.h"
+#include "SQLamarr/UpdateDBConnection.h"
+#include "SQLamarr/SQLiteError.h"
+
+namespace
+{
+  /// Time (ms) an algorithm run concurrently waits for the locks of the others
+  const int s_busy_timeout = 60000;
+
+  //============================================================================
+  // intersect: true if two sets of tables have a table in common
+  //============================================================================
+  bool intersect (
+      const std::set<std::string>& a, 
+      const std::set<std::string>& b
+      )
+  {
+    for (const std::string& table: a)
+      if (b.count(table))
+        return true;
+
+    return false;
+  }
+
+  //============================================================================
+  // demangled_name: human-readable class name of a polymorphic object
+  //============================================================================
+  template <class T>
+  std::string demangled_name (const T& obj)
+  {
+    int status;
+    char* demangled = abi::__cxa_demangle(
+        typeid(obj).name(), nullptr, nullptr, &status);
+    const std::string ret = (status == 0) ? demangled : typeid(obj).name();
+    free(demangled);
+    return ret;
+  }
+}
+
+namespace SQLamarr
+{
+  //============================================================================
+  // Constructor
+  //============================================================================
+  Pipeline::Pipeline(
+      const std::vector<Transformer*>& algorithms,
+      AbsDataLoader* loader
+      )
+    : m_algorithms (algorithms)
+    , m_sql_interfaces ()
+    , m_updates_connection ()
+    , m_loader (loader)
+    , m_current_algorithm (-1)
+    , m_instrumented (false)
+    , m_stats ()
+    , m_transaction_policy (PerTransformer)
+    , m_batches_per_transaction (1)
+    , m_batches_in_transaction (0)
+    , m_transaction_db (nullptr)
+    , m_checkpoint_interval (0)
+    , m_batches_since_checkpoint (0)
+    , m_n_threads (1)
+    , m_stages ()
+    , m_stages_statements (0)
+    , m_skip_unchanged (false)
+    , m_changes_mutex ()
+    , m_n_changes (0)
+    , m_all_changed (0)
+    , m_table_changes ()
+    , m_last_execution (algorithms.size(), 0)
+    , m_total_changes ()
+  {
+    for (Transformer* algorithm: m_algorithms)
+    {
+      TransformerStats stats = TransformerStats();
+      stats.name = demangled_name(*algorithm);
+      m_stats.push_back(stats);
+
+      m_sql_interfaces.push_back(dynamic_cast<BaseSqlInterface*>(algorithm));
+      m_updates_connection.push_back(
+          dynamic_cast<UpdateDBConnection*>(algorithm) != nullptr
+          );
+    }
+  }
+
+  //============================================================================
+  // execute
+  //============================================================================
+  void Pipeline::execute(size_t n_times)
+  {
+    try
+    {
+      for (size_t iExec = 0; iExec < n_times; ++iExec)
+      {
+        begin_batch();
+        execute_once();
+        end_batch();
+      }
+    }
+    catch (...)
+    {
+      // Discard the updates of the failed batch, with its savepoints
+      reset_statements();
+      rollback_transaction();
+      throw;
+    }
+
+    commit_transaction();
+  }
+
+  //============================================================================
+  // execute_over_files
+  //============================================================================
+  void Pipeline::execute_over_files(
+      const std::vector<std::string>& file_paths,
+      size_t run_number,
+      size_t first_evt_number
+      )
+  {
+    if (m_loader == nullptr)
+      throw std::logic_error("Pipeline configured without a data loader");
+
+    size_t evt_number = first_evt_number;
+    try
+    {
+      for (const std::string& file_path: file_paths)
+      {
+        m_current_algorithm = -1;
+        begin_batch();
+        m_loader->load(file_path, run_number, evt_number++);
+        m_loader->reset_statements();
+        record_execution(-1);
+        check_external_changes(false);
+        execute_once();
+        end_batch();
+      }
+    }
+    catch (...)
+    {
+      // Discard the updates of the failed batch, with its savepoints
+      reset_statements();
+      rollback_transaction();
+      throw;
+    }
+
+    commit_transaction();
+  }
+
+  //============================================================================
+  // set_transaction_policy
+  //============================================================================
+  void Pipeline::set_transaction_policy(
+      TransactionPolicy policy, 
+      size_t n_batches
+      )
+  {
+    if (policy == PerNBatches && n_batches == 0)
+      throw std::logic_error("Transactions must include at least one batch");
+
+    commit_transaction();
+    m_transaction_policy = policy;
+    m_batches_per_transaction = (policy == PerNBatches) ? n_batches : 1;
+  }
+
+  //============================================================================
+  // begin_batch
+  //============================================================================
+  void Pipeline::begin_batch()
+  {
+    if (m_transaction_policy == PerTransformer || m_transaction_db != nullptr)
+      return;
+
+    sqlite3* db = connection();
+    if (db == nullptr)
+      return;
+
+    if (sqlite3_exec(db, "SAVEPOINT sqlamarr_pipeline", 0, 0, 0) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db) << std::endl;
+      throw SQLiteError("Failed to begin the pipeline transaction");
+    }
+
+    m_transaction_db = db;
+    m_batches_in_transaction = 0;
+  }
+
+  //============================================================================
+  // end_batch
+  //============================================================================
+  void Pipeline::end_batch()
+  {
+    if (m_transaction_db != nullptr && 
+        ++m_batches_in_transaction >= m_batches_per_transaction)
+      commit_transaction();
+
+    if (m_checkpoint_interval == 0)
+      return;
+
+    // Checkpoints are postponed until the pipeline transaction is committed
+    if (++m_batches_since_checkpoint < m_checkpoint_interval || 
+        m_transaction_db != nullptr)
+      return;
+
+    sqlite3* db = connection();
+    if (db == nullptr || !sqlite3_get_autocommit(db))
+      return;
+
+    m_batches_since_checkpoint = 0;
+    const int retcode = sqlite3_wal_checkpoint_v2(
+        db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+    if (retcode != SQLITE_OK && retcode != SQLITE_BUSY)
+    {
+      std::cerr << sqlite3_errmsg(db) << std::endl;
+      throw SQLiteError("Failed checkpointing the database");
+    }
+  }
+
+  //============================================================================
+  // connection
+  //============================================================================
+  sqlite3* Pipeline::connection() const
+  {
+    if (m_loader)
+      return m_loader->database().get();
+
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) 
+        return sql_interface->database().get();
+
+    return nullptr;
+  }
+
+  //============================================================================
+  // commit_transaction
+  //============================================================================
+  void Pipeline::commit_transaction()
+  {
+    if (m_transaction_db == nullptr)
+      return;
+
+    sqlite3* db = m_transaction_db;
+    m_transaction_db = nullptr;
+    m_batches_in_transaction = 0;
+
+    if (sqlite3_exec(db, "RELEASE sqlamarr_pipeline", 0, 0, 0) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db) << std::endl;
+      throw SQLiteError("Failed to commit the pipeline transaction");
+    }
+  }
+
+  //============================================================================
+  // rollback_transaction
+  //============================================================================
+  void Pipeline::rollback_transaction()
+  {
+    // The savepoints of the failed algorithms are rolled back first
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) sql_interface->rollback_transactions();
+
+    if (m_loader) 
+      m_loader->rollback_transactions();
+
+    if (m_transaction_db == nullptr)
+      return;
+
+    sqlite3* db = m_transaction_db;
+    m_transaction_db = nullptr;
+    m_batches_in_transaction = 0;
+
+    if (sqlite3_exec(db, 
+          "ROLLBACK TO sqlamarr_pipeline; RELEASE sqlamarr_pipeline", 
+          0, 0, 0) != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db) << std::endl;
+      throw SQLiteError("Failed to roll back the pipeline transaction");
+    }
+  }
+
+  //============================================================================
+  // invalidate_cache
+  //============================================================================
+  void Pipeline::invalidate_cache()
+  {
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) sql_interface->invalidate_cache();
+
+    if (m_loader) 
+      m_loader->invalidate_cache();
+  }
+
+  //============================================================================
+  // reset_statements
+  //============================================================================
+  void Pipeline::reset_statements()
+  {
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) sql_interface->reset_statements();
+
+    if (m_loader) 
+      m_loader->reset_statements();
+  }
+
+  //============================================================================
+  // set_profiling
+  //============================================================================
+  void Pipeline::set_profiling(bool enabled)
+  {
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) sql_interface->set_profiling(enabled);
+
+    if (m_loader) 
+      m_loader->set_profiling(enabled);
+  }
+
+  //============================================================================
+  // execute_once
+  //============================================================================
+  void Pipeline::execute_once()
+  {
+    check_external_changes(true);
+
+    const bool concurrent = 
+      (m_n_threads > 1 && m_transaction_policy == PerTransformer);
+
+    // The first execution discovers the tables accessed by the algorithms
+    if (concurrent && !m_stages.empty())
+    {
+      for (const std::vector<int>& stage: m_stages)
+        execute_stage(stage);
+    }
+    else
+    {
+      const int n_algorithms = m_algorithms.size();
+      for (int iAlg = 0; iAlg < n_algorithms; ++iAlg)
+      {
+        m_current_algorithm = iAlg;
+        execute_algorithm(iAlg);
+      }
+    }
+
+    // Newly compiled statements may have introduced new dependencies
+    if (concurrent && 
+        (m_stages.empty() || n_statements_prepared() != m_stages_statements))
+      build_stages();
+
+    check_external_changes(false);
+  }
+
+  //============================================================================
+  // execute_algorithm
+  //============================================================================
+  void Pipeline::execute_algorithm(int iAlg)
+  {
+    if (m_skip_unchanged && unchanged(iAlg))
+      return;
+
+    // Closing the connection requires all the statements to be finalized
+    // and the pipeline transaction to be committed
+    if (m_updates_connection[iAlg])
+    {
+      commit_transaction();
+      invalidate_cache();
+    }
+
+    try
+    {
+      if (m_instrumented)
+        execute_instrumented(iAlg);
+      else
+        m_algorithms[iAlg]->execute();
+    }
+    catch (...)
+    {
+      // Release the locks held by the failing algorithm, which would
+      // block the algorithms running concurrently on other connections
+      if (m_sql_interfaces[iAlg])
+      {
+        m_sql_interfaces[iAlg]->reset_statements();
+        m_sql_interfaces[iAlg]->rollback_transactions();
+      }
+      throw;
+    }
+
+    // Resetting the statements releases the locks on the tables, 
+    // without the cost of preparing them again at the next event.
+    if (m_sql_interfaces[iAlg])
+      m_sql_interfaces[iAlg]->reset_statements();
+
+    record_execution(iAlg);
+  }
+
+  //============================================================================
+  // execute_stage
+  //============================================================================
+  void Pipeline::execute_stage(const std::vector<int>& stage)
+  {
+    // Algorithms sharing a connection are run in sequence by the same thread
+    std::vector<sqlite3*> connections;
+    std::vector<std::vector<int> > groups;
+    for (int iAlg: stage)
+    {
+      sqlite3* db = m_sql_interfaces[iAlg] ? 
+        m_sql_interfaces[iAlg]->database().get() : nullptr;
+      const size_t iGroup = std::find(connections.begin(), connections.end(), db)
+        - connections.begin();
+
+      if (iGroup == connections.size())
+      {
+        connections.push_back(db);
+        groups.push_back(std::vector<int>());
+      }
+      groups[iGroup].push_back(iAlg);
+    }
+
+    if (groups.size() < 2)
+    {
+      for (int iAlg: stage)
+      {
+        m_current_algorithm = iAlg;
+        execute_algorithm(iAlg);
+      }
+      return;
+    }
+
+    const size_t n_workers = std::min<size_t>(m_n_threads, groups.size());
+    std::vector<std::exception_ptr> errors (n_workers);
+    std::vector<int> failed (n_workers, -1);
+
+    auto worker = [&](size_t iWorker)
+    {
+      for (size_t iGroup = iWorker; iGroup < groups.size(); iGroup += n_workers)
+        for (int iAlg: groups[iGroup])
+        {
+          try
+          {
+            execute_algorithm(iAlg);
+          }
+          catch (...)
+          {
+            errors[iWorker] = std::current_exception();
+            failed[iWorker] = iAlg;
+            return;
+          }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t iWorker = 1; iWorker < n_workers; ++iWorker)
+      threads.push_back(std::thread(worker, iWorker));
+
+    worker(0);
+    for (std::thread& thread: threads)
+      thread.join();
+
+    // Report the failure of the first algorithm in the sequence
+    int iFailed = -1;
+    std::exception_ptr error;
+    for (size_t iWorker = 0; iWorker < n_workers; ++iWorker)
+      if (errors[iWorker] && (iFailed < 0 || failed[iWorker] < iFailed))
+      {
+        iFailed = failed[iWorker];
+        error = errors[iWorker];
+      }
+
+    if (error)
+    {
+      m_current_algorithm = iFailed;
+      std::rethrow_exception(error);
+    }
+  }
+
+  //============================================================================
+  // set_n_threads
+  //============================================================================
+  void Pipeline::set_n_threads(unsigned int n_threads)
+  {
+    if (n_threads == 0)
+      throw std::logic_error("The pipeline requires at least one thread");
+
+    m_n_threads = n_threads;
+    m_stages.clear();
+    if (n_threads > 1)
+      enable_table_tracking();
+  }
+
+  //============================================================================
+  // set_skip_unchanged
+  //============================================================================
+  void Pipeline::set_skip_unchanged(bool enabled)
+  {
+    m_skip_unchanged = enabled;
+    if (enabled)
+      enable_table_tracking();
+  }
+
+  //============================================================================
+  // enable_table_tracking
+  //============================================================================
+  void Pipeline::enable_table_tracking()
+  {
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) sql_interface->set_table_tracking(true);
+
+    if (m_loader) 
+      m_loader->set_table_tracking(true);
+  }
+
+  //============================================================================
+  // n_statements_prepared
+  //============================================================================
+  uint64_t Pipeline::n_statements_prepared() const
+  {
+    uint64_t ret = 0;
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface) 
+        ret += sql_interface->n_statements_prepared();
+
+    return ret;
+  }
+
+  //============================================================================
+  // build_stages
+  //============================================================================
+  void Pipeline::build_stages()
+  {
+    const int n_algorithms = m_algorithms.size();
+    std::vector<size_t> level (n_algorithms, 0);
+    m_stages.clear();
+
+    for (int iAlg = 0; iAlg < n_algorithms; ++iAlg)
+    {
+      BaseSqlInterface* alg = m_sql_interfaces[iAlg];
+      for (int iPrev = 0; iPrev < iAlg; ++iPrev)
+      {
+        BaseSqlInterface* prev = m_sql_interfaces[iPrev];
+        const bool barrier = (alg == nullptr || prev == nullptr || 
+            m_updates_connection[iAlg] || m_updates_connection[iPrev]);
+
+        if (barrier || 
+            intersect(prev->tables_written(), alg->tables_read()) ||
+            intersect(prev->tables_written(), alg->tables_written()) ||
+            intersect(prev->tables_read(), alg->tables_written()))
+          level[iAlg] = std::max(level[iAlg], level[iPrev] + 1);
+      }
+
+      if (level[iAlg] >= m_stages.size())
+        m_stages.resize(level[iAlg] + 1);
+
+      m_stages[level[iAlg]].push_back(iAlg);
+    }
+
+    m_stages_statements = n_statements_prepared();
+
+    // Concurrent algorithms wait for the locks held by the others
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface && sql_interface->database().get())
+        sqlite3_busy_timeout(sql_interface->database().get(), s_busy_timeout);
+  }
+
+  //============================================================================
+  // unchanged
+  //============================================================================
+  bool Pipeline::unchanged(int iAlg)
+  {
+    const BaseSqlInterface* sql_interface = m_sql_interfaces[iAlg];
+    if (sql_interface == nullptr || m_updates_connection[iAlg])
+      return false;
+
+    std::lock_guard<std::mutex> lock (m_changes_mutex);
+    const uint64_t last_execution = m_last_execution[iAlg];
+    if (last_execution == 0 || m_all_changed > last_execution)
+      return false;
+
+    for (const std::set<std::string>* tables: 
+        {&sql_interface->tables_read(), &sql_interface->tables_written()})
+      for (const std::string& table: *tables)
+      {
+        auto change = m_table_changes.find(table);
+        if (change != m_table_changes.end() && change->second > last_execution)
+          return false;
+      }
+
+    return true;
+  }
+
+  //============================================================================
+  // record_execution
+  //============================================================================
+  void Pipeline::record_execution(int iAlg)
+  {
+    const BaseSqlInterface* sql_interface = 
+      (iAlg < 0) ? m_loader : m_sql_interfaces[iAlg];
+
+    std::lock_guard<std::mutex> lock (m_changes_mutex);
+    const uint64_t change = ++m_n_changes;
+
+    // Algorithms not tracking their tables may have modified any table
+    if (sql_interface == nullptr)
+      m_all_changed = change;
+    else
+      for (const std::string& table: sql_interface->tables_written())
+        m_table_changes[table] = change;
+
+    if (iAlg >= 0)
+      m_last_execution[iAlg] = change;
+  }
+
+  //============================================================================
+  // mark_changed
+  //============================================================================
+  void Pipeline::mark_changed(const std::string& table)
+  {
+    std::string name (table);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    std::lock_guard<std::mutex> lock (m_changes_mutex);
+    if (name.empty())
+      m_all_changed = ++m_n_changes;
+    else
+      m_table_changes[name] = ++m_n_changes;
+  }
+
+  //============================================================================
+  // check_external_changes
+  //============================================================================
+  void Pipeline::check_external_changes(bool mark)
+  {
+    std::set<sqlite3*> connections;
+    for (BaseSqlInterface* sql_interface: m_sql_interfaces)
+      if (sql_interface && sql_interface->database().get())
+        connections.insert(sql_interface->database().get());
+
+    if (m_loader && m_loader->database().get())
+      connections.insert(m_loader->database().get());
+
+    bool changed = false;
+    for (sqlite3* db: connections)
+    {
+      const int64_t total_changes = sqlite3_total_changes(db);
+      auto stored = m_total_changes.find(db);
+      if (stored == m_total_changes.end() || stored->second != total_changes)
+        changed = true;
+
+      m_total_changes[db] = total_changes;
+    }
+
+    if (mark && changed)
+      mark_changed();
+  }
+
+  //============================================================================
+  // execute_instrumented
+  //============================================================================
+  void Pipeline::execute_instrumented(int iAlg)
+  {
+    TransformerStats& stats = m_stats[iAlg];
+    BaseSqlInterface* sql_interface = m_sql_interfaces[iAlg];
+    sqlite3* db = sql_interface ? sql_interface->database().get() : nullptr;
+
+    int64_t changes = 0;
+    uint64_t rows_returned = 0;
+    uint64_t statements_prepared = 0;
+    int current, highwater;
+    if (db)
+    {
+      changes = sqlite3_total_changes(db);
+      rows_returned = sql_interface->n_rows_returned();
+      statements_prepared = sql_interface->n_statements_prepared();
+      sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 1);
+      sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 1);
+    }
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    const std::clock_t cpu_start = std::clock();
+
+    m_algorithms[iAlg]->execute();
+
+    stats.cpu_time += static_cast<double>(std::clock() - cpu_start)/CLOCKS_PER_SEC;
+    stats.wall_time += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start).count();
+    stats.calls++;
+
+    if (db)
+    {
+      stats.rows_changed += sqlite3_total_changes(db) - changes;
+      stats.rows_returned += sql_interface->n_rows_returned() - rows_returned;
+      stats.statements_prepared += 
+        sql_interface->n_statements_prepared() - statements_prepared;
+      sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_HIT, &current, &highwater, 1);
+      stats.cache_hits += current;
+      sqlite3_db_status(db, SQLITE_DBSTATUS_CACHE_MISS, &current, &highwater, 1);
+      stats.cache_misses += current;
+    }
+  }
+
+  //============================================================================
+  // reset_stats
+  //============================================================================
+  void Pipeline::reset_stats()
+  {
+    for (TransformerStats& stats: m_stats)
+    {
+      const std::string name = stats.name;
+      stats = TransformerStats();
+      stats.name = name;
+    }
+  }
+
+  //============================================================================
+  // export_stats
+  //============================================================================
+  void Pipeline::export_stats(
+      SQLite3DB& db, 
+      const std::string& table, 
+      bool append,
+      int first_algorithm
+      ) const
+  {
+    validate_token(table);
+
+    std::vector<std::string> queries = {
+      "CREATE TABLE IF NOT EXISTS " + table + " ("
+        "algorithm INTEGER, name TEXT, calls INTEGER, "
+        "wall_time REAL, cpu_time REAL, "
+        "rows_changed INTEGER, rows_returned INTEGER, "
+        "statements_prepared INTEGER, "
+        "cache_hits INTEGER, cache_misses INTEGER)"
+    };
+    if (!append)
+      queries.push_back("DELETE FROM " + table);
+
+    for (const std::string& query: queries)
+    {
+      sqlite3_stmt* stmt = prepare_statement(db, query);
+      const int retcode = sqlite3_step(stmt);
+      sqlite3_finalize(stmt);
+      if (retcode != SQLITE_DONE)
+      {
+        std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+        throw SQLiteError("Failed preparing the stats table");
+      }
+    }
+
+    sqlite3_stmt* insert = prepare_statement(db, 
+        "INSERT INTO " + table + " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+
+    for (size_t iAlg = 0; iAlg < m_stats.size(); ++iAlg)
+    {
+      const TransformerStats& stats = m_stats[iAlg];
+      sqlite3_reset(insert);
+      sqlite3_bind_int64(insert, 1, first_algorithm + iAlg);
+      sqlite3_bind_text(insert, 2, stats.name.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64(insert, 3, stats.calls);
+      sqlite3_bind_double(insert, 4, stats.wall_time);
+      sqlite3_bind_double(insert, 5, stats.cpu_time);
+      sqlite3_bind_int64(insert, 6, stats.rows_changed);
+      sqlite3_bind_int64(insert, 7, stats.rows_returned);
+      sqlite3_bind_int64(insert, 8, stats.statements_prepared);
+      sqlite3_bind_int64(insert, 9, stats.cache_hits);
+      sqlite3_bind_int64(insert, 10, stats.cache_misses);
+
+      if (sqlite3_step(insert) != SQLITE_DONE)
+      {
+        std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+        sqlite3_finalize(insert);
+        throw SQLiteError("Failed exporting the stats");
+      }
+    }
+
+    sqlite3_finalize(insert);
+  }
+
+  //============================================================================
+  // export_profiles
+  //============================================================================
+  void Pipeline::export_profiles(
+      SQLite3DB& db, 
+      const std::string& table, 
+      bool append
+      )
+  {
+    validate_token(table);
+
+    std::vector<std::string> queries = {
+      "CREATE TABLE IF NOT EXISTS " + table + " ("
+        "algorithm TEXT, statement TEXT, sql TEXT, query_plan TEXT, "
+        "executions INTEGER, time REAL, "
+        "fullscan_steps INTEGER, sorts INTEGER, "
+        "autoindex INTEGER, vm_steps INTEGER)"
+    };
+    if (!append)
+      queries.push_back("DELETE FROM " + table);
+
+    for (const std::string& query: queries)
+    {
+      sqlite3_stmt* stmt = prepare_statement(db, query);
+      const int retcode = sqlite3_step(stmt);
+      sqlite3_finalize(stmt);
+      if (retcode != SQLITE_DONE)
+      {
+        std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+        throw SQLiteError("Failed preparing the profiles table");
+      }
+    }
+
+    std::vector<BaseSqlInterface*> interfaces (m_sql_interfaces);
+    if (m_loader)
+      interfaces.push_back(m_loader);
+
+    sqlite3_stmt* insert = prepare_statement(db, 
+        "INSERT INTO " + table + " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+
+    for (BaseSqlInterface* sql_interface: interfaces)
+    {
+      if (sql_interface == nullptr)
+        continue;
+
+      const std::string name = demangled_name(*sql_interface);
+      for (const StatementProfile& profile: sql_interface->statement_profiles())
+      {
+        sqlite3_reset(insert);
+        sqlite3_bind_text(insert, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert, 2, profile.name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert, 3, profile.sql.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(insert, 4, 
+            profile.query_plan.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(insert, 5, profile.executions);
+        sqlite3_bind_double(insert, 6, profile.time);
+        sqlite3_bind_int64(insert, 7, profile.fullscan_steps);
+        sqlite3_bind_int64(insert, 8, profile.sorts);
+        sqlite3_bind_int64(insert, 9, profile.autoindex);
+        sqlite3_bind_int64(insert, 10, profile.vm_steps);
+
+        if (sqlite3_step(insert) != SQLITE_DONE)
+        {
+          std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+          sqlite3_finalize(insert);
+          throw SQLiteError("Failed exporting the profiles");
+        }
+      }
+    }
+
+    sqlite3_finalize(insert);
+  }
+}
@@ -0,0 +1,197 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+// STL
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Local
+#include "SQLamarr/SyntheticDataLoader.h"
+#include "SQLamarr/GlobalPRNG.h"
+
+namespace SQLamarr
+{
+  namespace 
+  {
+    /// Particle species produced by the synthetic generator
+    struct Species { int pid; float mass; };
+    const Species species[] = {
+      {211, 139.57}, {-211, 139.57}, {321, 493.68}, {-321, 493.68}, 
+      {2212, 938.27}, {-2212, 938.27}, {13, 105.66}, {-13, 105.66},
+      {11, 0.511}, {-11, 0.511}, {22, 0.}
+    };
+    constexpr int n_species = sizeof(species)/sizeof(Species);
+
+    /// Decay vertex whose products are still to be generated
+    struct Decay 
+    {
+      int genvertex_id;
+      unsigned int depth;
+      float px, py, pz;
+      float position[4]; ///< t, x, y, z
+    };
+  }
+
+  //==========================================================================
+  // Constructor
+  //==========================================================================
+  SyntheticDataLoader::SyntheticDataLoader (SQLite3DB& db)
+    : SyntheticDataLoader (db, Config())
+  {}
+
+  //==========================================================================
+  SyntheticDataLoader::SyntheticDataLoader (
+      SQLite3DB& db,
+      const Config& config
+      )
+    : AbsDataLoader(db)
+    , m_config (config)
+  {}
+
+  //==========================================================================
+  // load
+  //==========================================================================
+  void SyntheticDataLoader::load (
+      const std::string& data_source, 
+      size_t run_number, 
+      size_t evt_number
+      )
+  {
+    auto generator = GlobalPRNG::get_or_create(m_database.get());
+    std::poisson_distribution<int> pileup(m_config.pileup);
+
+    begin_transaction();
+    try
+    {
+      const int ds_id = insert_event(data_source, run_number, evt_number);
+
+      const int n_collisions = std::max(1, pileup(*generator));
+      for (int iCollision = 0; iCollision < n_collisions; ++iCollision)
+        generate_collision(ds_id, iCollision + 1, 
+            m_config.with_signal && iCollision == 0);
+    }
+    catch (...)
+    {
+      // The rows inserted so far are discarded with the transaction
+      reset_statements();
+      rollback_transaction();
+      throw;
+    }
+
+    end_transaction();
+  }
+
+  //==========================================================================
+  // generate_collision
+  //==========================================================================
+  void SyntheticDataLoader::generate_collision (
+      int datasource_id, 
+      int collision, 
+      bool signal
+      )
+  {
+    auto& generator = *GlobalPRNG::get_or_create(m_database.get());
+    std::normal_distribution<float> gauss(0., 1.);
+    std::uniform_real_distribution<float> uniform(0., 1.);
+    std::exponential_distribution<float> momentum(1./5000.); // MeV
+    std::exponential_distribution<float> lifetime(1.);       // mm/c
+    std::uniform_int_distribution<int> species_index(0, n_species - 1);
+    std::poisson_distribution<int> multiplicity(m_config.multiplicity);
+
+    const int event_id = insert_collision(datasource_id, collision, 0, 0, 0, 0);
+
+    int hepmc_vertex = 0;
+    int hepmc_particle = 0;
+    std::vector<Decay> decays;
+
+    // Insert a particle and, if it decays, its end vertex
+    auto add_particle = [&] (
+        int production_vertex, const float* origin, unsigned int depth,
+        float px, float py, float pz, bool decays_, bool is_signal
+        )
+    {
+      const Species& s = species[species_index(generator)];
+      const float pe = std::sqrt(px*px + py*py + pz*pz + s.mass*s.mass);
+
+      int end_vertex = LAMARR_BAD_INDEX;
+      if (decays_)
+      {
+        const float p = std::sqrt(px*px + py*py + pz*pz);
+        const float flight = lifetime(generator);
+        Decay decay = {0, depth + 1, px, py, pz, {
+            origin[0] + flight,
+            origin[1] + flight * px / p,
+            origin[2] + flight * py / p,
+            origin[3] + flight * pz / p
+          }};
+        end_vertex = decay.genvertex_id = insert_vertex(
+            event_id, --hepmc_vertex, 0,
+            decay.position[0], decay.position[1], 
+            decay.position[2], decay.position[3],
+            false);
+        decays.push_back(decay);
+      }
+
+      const int status = 
+        is_signal ? m_config.signal_status :
+        decays_ ? m_config.decayed_status : m_config.stable_status;
+
+      insert_particle(event_id, ++hepmc_particle, production_vertex, end_vertex,
+          s.pid, status, pe, px, py, pz, s.mass);
+    };
+
+    // Primary vertex, produced by the colliding protons
+    const float pv_pos[] = {
+      0., 0.01f*gauss(generator), 0.01f*gauss(generator), 50.f*gauss(generator)
+    };
+    const int pv = insert_vertex(event_id, --hepmc_vertex, 0, 
+        pv_pos[0], pv_pos[1], pv_pos[2], pv_pos[3], true);
+
+    for (float beam_pz: {6.5e6f, -6.5e6f})
+      insert_particle(event_id, ++hepmc_particle, LAMARR_BAD_INDEX, pv,
+          2212, m_config.beam_status, 6.5e6, 0, 0, beam_pz, 938.27);
+
+    // Particles produced at the primary vertex
+    const int n_particles = multiplicity(generator);
+    for (int iParticle = 0; iParticle < n_particles; ++iParticle)
+    {
+      const bool is_signal = signal && (iParticle == 0);
+      const float px = 400. * gauss(generator);
+      const float py = 400. * gauss(generator);
+      const float pz = momentum(generator) * (uniform(generator) < 0.9 ? 1 : -1);
+      const bool decays_ = (m_config.max_depth > 0) && 
+        (is_signal || uniform(generator) < m_config.decay_probability);
+
+      add_particle(pv, pv_pos, 0, px, py, pz, decays_, is_signal);
+    }
+
+    // Decay trees, daughters share the momentum of the mother
+    while (!decays.empty())
+    {
+      const Decay decay = decays.back();
+      decays.pop_back();
+
+      const float fraction = 1. / m_config.n_daughters;
+      for (unsigned int iDaughter = 0; iDaughter < m_config.n_daughters; ++iDaughter)
+      {
+        const float px = fraction * decay.px + 100. * gauss(generator);
+        const float py = fraction * decay.py + 100. * gauss(generator);
+        const float pz = fraction * decay.pz;
+        const bool decays_ = (decay.depth < m_config.max_depth) && 
+          uniform(generator) < m_config.decay_probability;
+
+        add_particle(decay.genvertex_id, decay.position, decay.depth, 
+            px, py, pz, decays_, false);
+      }
+    }
+  }
+}
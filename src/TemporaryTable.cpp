@@ -9,7 +9,10 @@
 
 
 // STL
+#include <algorithm>
+#include <cctype>
 #include <sstream>
+#include <stdexcept>
 
 // SQLite
 #include "sqlite3.h"
@@ -34,6 +37,8 @@ namespace SQLamarr
     , m_columns (columns)
     , m_select_statements (select_statements)
     , m_make_persistent (make_persistent)
+    , m_materialization (Copy)
+    , m_drop_existing (false)
   {
     validate_token (output_table);
     for (auto& column_name: m_columns)
@@ -55,6 +60,8 @@ namespace SQLamarr
     , m_columns (columns)
     , m_select_statements ({select_statement})
     , m_make_persistent (make_persistent)
+    , m_materialization (Copy)
+    , m_drop_existing (false)
   {
     validate_token (output_table);
     for (auto& column_name: m_columns)
@@ -110,11 +117,161 @@ namespace SQLamarr
     return s.str();
   }
 
+  //============================================================================
+  // compose_union_query. Internal.
+  //============================================================================
+  std::string TemporaryTable::compose_union_query() const
+  {
+    std::stringstream s;
+    for (auto& st: m_select_statements)
+    {
+      // Trailing semicolons are not allowed in subqueries
+      const size_t end = st.find_last_not_of(" \t\n\r;");
+      s << (&st == &m_select_statements.front() ? "" : " UNION ALL ")
+        << "SELECT * FROM (" << st.substr(0, end + 1) << ")";
+    }
+
+    return s.str();
+  }
+
+  //============================================================================
+  // set_materialization
+  //============================================================================
+  void TemporaryTable::set_materialization (Materialization strategy)
+  {
+    if (strategy == m_materialization)
+      return;
+
+    m_materialization = strategy;
+    m_drop_existing = true;
+    reset_processed_events();
+    invalidate_cache();
+  }
+
+  //============================================================================
+  // drop_existing. Internal.
+  //============================================================================
+  void TemporaryTable::drop_existing ()
+  {
+    sqlite3_stmt* get_type = get_statement("get_type", 
+        std::string("SELECT type FROM ") + 
+        (m_make_persistent ? "sqlite_master" : "sqlite_temp_master") + 
+        " WHERE name = ? AND type IN ('table', 'view')"
+        );
+    sqlite3_bind_text(get_type, 1, m_output_table.c_str(), -1, SQLITE_STATIC);
+
+    std::string type = exec_stmt(get_type) ?
+      reinterpret_cast<const char*>(sqlite3_column_text(get_type, 0)) : "";
+    sqlite3_reset(get_type);
+
+    if (type.empty())
+      return;
+
+    std::transform(type.begin(), type.end(), type.begin(), ::toupper);
+    sqlite3_stmt* drop = get_statement("drop_existing", 
+        "DROP " + type + " " + (m_make_persistent ? "main." : "temp.") + 
+        m_output_table
+        );
+    exec_stmt(drop);
+
+    // The statement depends on the type of the dropped object
+    invalidate_cache();
+  }
+
+  //============================================================================
+  // execute_view. Internal.
+  //============================================================================
+  void TemporaryTable::execute_view ()
+  {
+    std::stringstream s;
+    s << "CREATE " << (m_make_persistent ? "" : "TEMPORARY ") 
+      << "VIEW IF NOT EXISTS " << m_output_table << " (";
+    for (auto c: m_columns)
+      s << c << (c != m_columns.back() ? ", ": "");
+    s << ") AS " << compose_union_query();
+
+    exec_stmt(get_statement("create_view", s.str()));
+  }
+
+  //============================================================================
+  // execute_recreate. Internal.
+  //============================================================================
+  void TemporaryTable::execute_recreate ()
+  {
+    exec_stmt(get_statement("drop_output_table", 
+          std::string("DROP TABLE IF EXISTS ") + 
+          (m_make_persistent ? "main." : "temp.") + m_output_table));
+
+    std::stringstream s;
+    s << "CREATE " << (m_make_persistent ? "" : "TEMPORARY ") 
+      << "TABLE " << m_output_table << " AS WITH sqlamarr_output (";
+    for (auto c: m_columns)
+      s << c << (c != m_columns.back() ? ", ": "");
+    s << ") AS (" << compose_union_query() << ") "
+      << "SELECT * FROM sqlamarr_output";
+
+    exec_stmt(get_statement("create_as_select", s.str()));
+  }
+
+  //============================================================================
+  // execute_incremental. Internal.
+  //============================================================================
+  void TemporaryTable::execute_incremental ()
+  {
+    exec_stmt(get_statement(
+          "create_output_table", compose_create_query().c_str()));
+
+    // Without the incremental mode, all the events are processed again
+    if (!incremental())
+      exec_stmt(get_statement(
+            "delete_output_table", compose_delete_query().c_str()));
+
+    const auto events = genevent_range();
+
+    int c = 0;
+    char buffer[128];
+    for (auto& stmt: m_select_statements)
+    {
+      sprintf(buffer, "insert_in_output_table_%d", c++);
+      sqlite3_stmt* insert = get_statement(buffer, 
+          compose_insert_query(stmt).c_str());
+
+      const int first = 
+        sqlite3_bind_parameter_index(insert, ":first_genevent_id");
+      const int last = 
+        sqlite3_bind_parameter_index(insert, ":last_genevent_id");
+      if (first == 0 || last == 0)
+        throw std::logic_error(
+            "Incremental TemporaryTable " + m_output_table + " requires "
+            ":first_genevent_id and :last_genevent_id in the queries");
+
+      sqlite3_bind_int64(insert, first, events.first);
+      sqlite3_bind_int64(insert, last, events.second);
+      exec_stmt(insert);
+    }
+
+    set_processed(events.second);
+  }
+
   //============================================================================
   // Execute
   //============================================================================
   void TemporaryTable::execute ()
   {
+    if (m_drop_existing)
+    {
+      drop_existing();
+      m_drop_existing = false;
+    }
+
+    switch (m_materialization)
+    {
+      case View:        execute_view(); return;
+      case Recreate:    execute_recreate(); return;
+      case Incremental: execute_incremental(); return;
+      case Copy:        break;
+    }
+
     // Prepare the queries and initialize the database
     // CREATE TEMPORARY TABLE IF NOT EXISTS
     sqlite3_stmt* create_output_table = get_statement(
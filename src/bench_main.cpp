@@ -0,0 +1,375 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// Benchmark of the SQLamarr transformers on synthetic events.
+//
+// Usage:
+//   sqlamarr_bench [--events N] [--collisions N] [--particles N]
+//                  [--repetitions N] [--seed N]
+//                  [--pv-parametrization FILE] [--models FILE]
+//
+// Synthetic events are written to HepMC2 ASCII files in a temporary
+// directory, then each benchmark processes the whole batch of events
+// and the throughput is reported as events/s and particles/s.
+
+// STL
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <numeric>
+#include <stdlib.h>
+
+// HepMC3
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/GenVertex.h"
+#include "HepMC3/GenParticle.h"
+#include "HepMC3/WriterAsciiHepMC2.h"
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/GlobalPRNG.h"
+#include "SQLamarr/HepMC2DataLoader.h"
+#include "SQLamarr/PVFinder.h"
+#include "SQLamarr/MCParticleSelector.h"
+#include "SQLamarr/PVReconstruction.h"
+#include "SQLamarr/Plugin.h"
+#include "SQLamarr/GenerativePlugin.h"
+#include "SQLamarr/CleanEventStore.h"
+
+namespace fs = std::filesystem;
+
+// Configuration of the benchmark, from the command line
+struct BenchConfig
+{
+  size_t n_events = 100;
+  size_t n_collisions = 5;
+  size_t n_particles = 200;
+  size_t n_repetitions = 5;
+  size_t seed = 42;
+  std::string pv_parametrization =
+    "../temporary_data/PrimaryVertex/PrimaryVertexSmearing.db";
+  std::string models = "../temporary_data/models/lhcb.trk.2016MU.so";
+};
+
+// Timing of a benchmark over the repetitions
+struct BenchResult
+{
+  std::string name;
+  std::vector<double> seconds;
+};
+
+// Helper functions
+BenchConfig parse_args(int argc, char* argv[]);
+std::vector<std::string> write_synthetic_events(
+    const BenchConfig& config, const fs::path& output_dir);
+void report(const std::vector<BenchResult>& results,
+    size_t n_events, size_t n_particles);
+
+
+//==============================================================================
+// main
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  const BenchConfig config = parse_args(argc, argv);
+
+  char tmp_template[] = "/tmp/sqlamarr_bench_XXXXXX";
+  const fs::path tmp_dir(mkdtemp(tmp_template));
+  const std::vector<std::string> files = write_synthetic_events(config, tmp_dir);
+
+  const bool with_pv_reco = fs::exists(config.pv_parametrization);
+  const bool with_models = fs::exists(config.models);
+  if (!with_pv_reco)
+    std::cerr << "PV parametrization not found, skipping PVReconstruction\n";
+  if (!with_models)
+    std::cerr << "Models not found, skipping Plugin and GenerativePlugin\n";
+
+  std::vector<BenchResult> results;
+  std::map<std::string, size_t> result_index;
+  auto measure = [&results, &result_index] (
+      const std::string& name, std::function<void()> func
+      )
+  {
+    if (result_index.find(name) == result_index.end())
+    {
+      result_index[name] = results.size();
+      results.push_back({name, {}});
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    results[result_index[name]].seconds.push_back(
+        std::chrono::duration<double>(
+          std::chrono::steady_clock::now() - start).count()
+        );
+  };
+
+  size_t n_particles = 0;
+  for (size_t iRep = 0; iRep < config.n_repetitions; ++iRep)
+  {
+    SQLamarr::SQLite3DB db = SQLamarr::make_database(":memory:");
+    SQLamarr::GlobalPRNG::get_or_create(db.get(), config.seed + iRep);
+
+    SQLamarr::HepMC2DataLoader loader(db);
+    SQLamarr::PVFinder pv_finder(db);
+    SQLamarr::MCParticleSelector mcps(db);
+    SQLamarr::CleanEventStore clean(db);
+
+    measure("HepMC2DataLoader::load", [&]() {
+        size_t evt_number = 0;
+        for (const std::string& file_path: files)
+          loader.load(file_path, 1, evt_number++);
+        });
+
+    sqlite3_stmt* count_particles = SQLamarr::prepare_statement(db,
+        "SELECT COUNT(*) FROM GenParticles");
+    sqlite3_step(count_particles);
+    n_particles = sqlite3_column_int64(count_particles, 0);
+    sqlite3_finalize(count_particles);
+
+    measure("PVFinder::execute", [&]() { pv_finder.execute(); });
+    measure("MCParticleSelector::execute", [&]() { mcps.execute(); });
+
+    if (with_pv_reco)
+    {
+      SQLamarr::PVReconstruction pv_reco(db,
+          SQLamarr::PVReconstruction::load_parametrization(
+            config.pv_parametrization, "PVSmearing", "2016_pp_MagUp")
+          );
+      measure("PVReconstruction::execute", [&]() { pv_reco.execute(); });
+    }
+
+    if (with_models)
+    {
+      SQLamarr::Plugin acceptance(db, config.models, "acceptance", R"(
+          SELECT
+            mcparticle_id,
+            ov.x AS mc_x,
+            ov.y AS mc_y,
+            ov.z AS mc_z,
+            log10(norm2(p.px, p.py, p.pz)) AS mc_log10_p,
+            p.px/p.pz AS mc_tx,
+            p.py/p.pz AS mc_ty,
+            pseudorapidity(p.px, p.py, p.pz) AS mc_eta,
+            azimuthal(p.px, p.py, p.pz) AS mc_phi,
+            abs(p.pid) == 11 AS mc_is_e,
+            abs(p.pid) == 13 AS mc_is_mu,
+            (
+              abs(p.pid) == 211 OR abs(p.pid) == 321 OR abs(p.pid) == 2212
+            ) AS mc_is_h,
+            propagation_charge(p.pid) AS mc_charge
+          FROM MCParticles AS p
+          INNER JOIN MCVertices AS ov ON p.production_vertex = ov.mcvertex_id
+          WHERE
+            p.pz > 1.
+            AND
+            propagation_charge(p.pid) <> 0.
+          )",
+          "tmp_acceptance_out", {"acceptance"}, {"mcparticle_id"}
+          );
+      measure("Plugin::execute", [&]() { acceptance.execute(); });
+
+      SQLamarr::GenerativePlugin resolution(db, config.models, "resolution", R"(
+          SELECT
+            p.mcparticle_id,
+            ov.x AS mc_x,
+            ov.y AS mc_y,
+            ov.z AS mc_z,
+            p.px/p.pz AS mc_tx,
+            p.py/p.pz AS mc_ty,
+            log10(norm2(p.px, p.py, p.pz)) AS mc_log10_p,
+            abs(p.pid) == 11 AS mc_is_e,
+            abs(p.pid) == 13 AS mc_is_mu,
+            (abs(p.pid) = 211 OR abs(p.pid) = 321 OR abs(p.pid) = 2212) AS is_h,
+            TRUE AS is_long,
+            FALSE AS is_upstream,
+            FALSE AS is_downstream
+          FROM MCParticles AS p
+          INNER JOIN MCVertices AS ov ON p.production_vertex = ov.mcvertex_id
+          WHERE
+            p.pz > 1.
+            AND
+            propagation_charge(p.pid) <> 0.
+          )",
+          "tmp_resolution_out",
+          {"dx", "dy", "dz", "dtx", "dty", "dp",
+            "chi2PerDoF", "nDoF_f", "ghostProb"},
+          128,
+          {"mcparticle_id"}
+          );
+      measure("GenerativePlugin::execute", [&]() { resolution.execute(); });
+    }
+
+    measure("CleanEventStore::execute", [&]() { clean.execute(); });
+  }
+
+  report(results, config.n_events, n_particles);
+
+  fs::remove_all(tmp_dir);
+  return 0;
+}
+
+//==============================================================================
+// parse_args
+//==============================================================================
+BenchConfig parse_args(int argc, char* argv[])
+{
+  BenchConfig config;
+  for (int iArg = 1; iArg + 1 < argc; iArg += 2)
+  {
+    const std::string key(argv[iArg]);
+    const std::string value(argv[iArg + 1]);
+
+    if (key == "--events") config.n_events = std::stoul(value);
+    else if (key == "--collisions") config.n_collisions = std::stoul(value);
+    else if (key == "--particles") config.n_particles = std::stoul(value);
+    else if (key == "--repetitions") config.n_repetitions = std::stoul(value);
+    else if (key == "--seed") config.seed = std::stoul(value);
+    else if (key == "--pv-parametrization") config.pv_parametrization = value;
+    else if (key == "--models") config.models = value;
+    else
+    {
+      std::cerr << "Unknown option " << key << std::endl;
+      exit(1);
+    }
+  }
+
+  return config;
+}
+
+//==============================================================================
+// write_synthetic_events
+//==============================================================================
+std::vector<std::string> write_synthetic_events(
+    const BenchConfig& config,
+    const fs::path& output_dir
+    )
+{
+  using HepMC3::FourVector;
+  using HepMC3::GenVertex;
+  using HepMC3::GenParticle;
+
+  std::mt19937_64 rng(config.seed);
+  std::normal_distribution<double> gauss(0., 1.);
+  std::exponential_distribution<double> momentum(1./5000.);  // MeV
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::uniform_int_distribution<int> species(0, 6);
+  const int pids[] = {211, -211, 321, -321, 2212, 13, 11};
+  const double masses[] = {139.57, 139.57, 493.68, 493.68, 938.27, 105.66, 0.511};
+
+  std::vector<std::string> files;
+  for (size_t iEvt = 0; iEvt < config.n_events; ++iEvt)
+  {
+    const fs::path file_path = output_dir / ("evt" + std::to_string(iEvt) + ".mc2");
+    HepMC3::WriterAsciiHepMC2 writer(file_path.string());
+
+    for (size_t iCollision = 0; iCollision < config.n_collisions; ++iCollision)
+    {
+      HepMC3::GenEvent evt(HepMC3::Units::MEV, HepMC3::Units::MM);
+      evt.set_event_number(iCollision + 1);
+
+      // Primary vertex with the two colliding protons
+      auto pv = std::make_shared<GenVertex>(FourVector(
+            0.01*gauss(rng), 0.01*gauss(rng), 50.*gauss(rng), 0.));
+      pv->add_particle_in(std::make_shared<GenParticle>(
+            FourVector(0, 0, 6.5e6, 6.5e6), 2212, 4));
+      pv->add_particle_in(std::make_shared<GenParticle>(
+            FourVector(0, 0, -6.5e6, 6.5e6), 2212, 4));
+      evt.add_vertex(pv);
+
+      for (size_t iPart = 0; iPart < config.n_particles; ++iPart)
+      {
+        const int iSpecies = species(rng);
+        const double pz = momentum(rng) * (uniform(rng) < 0.9 ? 1 : -1);
+        const double px = 400. * gauss(rng);
+        const double py = 400. * gauss(rng);
+        const double m = masses[iSpecies];
+        const double e = std::sqrt(px*px + py*py + pz*pz + m*m);
+
+        // One decaying particle out of ten, the first one being the signal
+        const bool decays = (iPart % 10 == 0);
+        const int status = !decays ? 1 : (iCollision == 0 && iPart == 0 ? 889 : 2);
+        auto particle = std::make_shared<GenParticle>(
+            FourVector(px, py, pz, e), pids[iSpecies], status);
+        particle->set_generated_mass(m);
+        pv->add_particle_out(particle);
+
+        if (decays)
+        {
+          const double flight = momentum(rng) / 5000.;
+          auto end_vertex = std::make_shared<GenVertex>(FourVector(
+                pv->position().x() + flight*px/e,
+                pv->position().y() + flight*py/e,
+                pv->position().z() + flight*pz/e,
+                flight));
+          end_vertex->add_particle_in(particle);
+          for (int iDaughter = 0; iDaughter < 2; ++iDaughter)
+            end_vertex->add_particle_out(std::make_shared<GenParticle>(
+                  FourVector(px/2, py/2, pz/2, e/2), 211 * (1 - 2*iDaughter), 1));
+          evt.add_vertex(end_vertex);
+        }
+      }
+
+      writer.write_event(evt);
+    }
+
+    writer.close();
+    files.push_back(file_path.string());
+  }
+
+  return files;
+}
+
+//==============================================================================
+// report
+//==============================================================================
+void report(
+    const std::vector<BenchResult>& results,
+    size_t n_events,
+    size_t n_particles
+    )
+{
+  std::cout
+    << "Events per iteration: " << n_events
+    << ", generator-level particles: " << n_particles << "\n\n"
+    << std::left << std::setw(32) << "Benchmark"
+    << std::right
+    << std::setw(14) << "Mean [ms]"
+    << std::setw(14) << "Min [ms]"
+    << std::setw(16) << "Events/s"
+    << std::setw(16) << "Particles/s"
+    << "\n" << std::string(92, '-') << "\n";
+
+  for (const BenchResult& result: results)
+  {
+    const double mean = std::accumulate(
+        result.seconds.begin(), result.seconds.end(), 0.) / result.seconds.size();
+    const double best = *std::min_element(
+        result.seconds.begin(), result.seconds.end());
+
+    std::cout
+      << std::left << std::setw(32) << result.name
+      << std::right << std::fixed
+      << std::setw(14) << std::setprecision(2) << 1e3*mean
+      << std::setw(14) << std::setprecision(2) << 1e3*best
+      << std::setw(16) << std::setprecision(1) << n_events/mean
+      << std::setw(16) << std::setprecision(0) << n_particles/mean
+      << "\n";
+  }
+
+  std::cout << std::endl;
+}
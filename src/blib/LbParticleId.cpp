@@ -53,6 +53,51 @@ namespace SQLamarr
       }
 
 
+      //========================================================================
+      // make_fused
+      //========================================================================
+      std::unique_ptr<MultiModelPlugin> make_fused(
+          SQLite3DB& db,
+          const std::string& library,
+          const std::vector<std::pair<int, std::string> >& models,
+          const std::string& output_table,
+          const std::string& particle_table,
+          const std::string& track_table
+          )
+      {
+        validate_token(particle_table);
+        validate_token(track_table);
+
+        // The species is used to route the rows, not as an input
+        const std::string query = R"(
+              SELECT
+                p.mcparticle_id AS mc_particleid,
+                norm2(p.px, p.py, p.pz) AS p,
+                pseudorapidity(p.px, p.py, p.pz) AS eta,
+                random_normal() * 10 + 100 as nTracks,
+                propagation_charge(p.pid) AS track_charge,
+                0 AS isMuon,
+                abs(p.pid) AS abspid
+              FROM )" + particle_table + R"( AS p
+              INNER JOIN )" + track_table + R"( AS recguess 
+                ON p.mcparticle_id = recguess.mcparticle_id
+              WHERE 
+                  recguess.track_type == 3;
+              )";
+
+        std::unique_ptr<MultiModelPlugin> ret (
+            new MultiModelPlugin(db, query, get_column_names(true, false))
+            );
+        ret->set_selection("abspid");
+
+        for (const auto& model: models)
+          ret->add_model(library, model.second, output_table,
+              get_column_names(false, true), 64, {}, {model.first});
+
+        return ret;
+      }
+
+
       //========================================================================
       // get_column_names
       //========================================================================
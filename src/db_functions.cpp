@@ -13,6 +13,7 @@
 #include <sstream>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include "SQLamarr/db_functions.h"
 #include "SQLamarr/GlobalPRNG.h"
@@ -111,7 +112,9 @@ namespace SQLamarr
         db,
         [](sqlite3* ptr) {
         SQLamarr::GlobalPRNG::release(ptr);
-        int ret = sqlite3_close(ptr);
+        // Statements still cached by algorithms are finalized lazily,
+        // when they notice the connection was replaced.
+        int ret = sqlite3_close_v2(ptr);
         if (ret != SQLITE_OK)
         {
           std::cerr << "sqlite3_close returned errorcode: " << ret << std::endl;
@@ -224,6 +227,52 @@ namespace SQLamarr
   }
 
 
+  //==========================================================================
+  // lower_bound_of
+  //==========================================================================
+  bool lower_bound_of (sqlite3_value* v, bool strict, sqlite3_int64& bound)
+  {
+    // Bounds are conservative: SQLite checks the constraints again
+    switch (sqlite3_value_type(v))
+    {
+      case SQLITE_INTEGER:
+        bound = sqlite3_value_int64(v);
+        if (strict && bound < std::numeric_limits<sqlite3_int64>::max()) bound++;
+        return true;
+      case SQLITE_FLOAT:
+        if (sqlite3_value_double(v) > -9e18 && sqlite3_value_double(v) < 9e18)
+          bound = static_cast<sqlite3_int64>(floor(sqlite3_value_double(v)));
+        return true;
+      case SQLITE_NULL:
+        bound = std::numeric_limits<sqlite3_int64>::max();
+        return false;
+    }
+    return true;
+  }
+
+  //==========================================================================
+  // upper_bound_of
+  //==========================================================================
+  bool upper_bound_of (sqlite3_value* v, bool strict, sqlite3_int64& bound)
+  {
+    switch (sqlite3_value_type(v))
+    {
+      case SQLITE_INTEGER:
+        bound = sqlite3_value_int64(v);
+        if (strict && bound > std::numeric_limits<sqlite3_int64>::min()) bound--;
+        return true;
+      case SQLITE_FLOAT:
+        if (sqlite3_value_double(v) > -9e18 && sqlite3_value_double(v) < 9e18)
+          bound = static_cast<sqlite3_int64>(ceil(sqlite3_value_double(v)));
+        return true;
+      case SQLITE_NULL:
+        bound = std::numeric_limits<sqlite3_int64>::min();
+        return false;
+    }
+    return true;
+  }
+
+
   //==========================================================================
   // validate_token
   //==========================================================================
@@ -244,6 +293,66 @@ namespace SQLamarr
   }
 
   
+  //==========================================================================
+  // flush_database
+  //==========================================================================
+  void flush_database(SQLite3DB& db)
+  {
+    const int retcode = sqlite3_db_cacheflush(db.get());
+    if (retcode != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+      throw SQLiteError("Failed flushing the database cache");
+    }
+  }
+
+  //==========================================================================
+  // enable_wal_mode
+  //==========================================================================
+  void enable_wal_mode(SQLite3DB& db, int autocheckpoint)
+  {
+    sqlite3_stmt* stmt = prepare_statement(db, "PRAGMA journal_mode = WAL");
+    const std::string mode = (sqlite3_step(stmt) == SQLITE_ROW) ? 
+      reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)) : "";
+    sqlite3_finalize(stmt);
+
+    // In-memory and temporary databases keep their own journal mode
+    if (mode != "wal")
+    {
+      std::cerr << "Journal mode: " << mode << " (" 
+        << sqlite3_errmsg(db.get()) << ")" << std::endl;
+      throw SQLiteError("Failed enabling the write-ahead log");
+    }
+
+    // Committed transactions are durable at the next checkpoint, 
+    // the database cannot be corrupted by a crash 
+    sqlite3_exec(db.get(), "PRAGMA synchronous = NORMAL", 0, 0, 0);
+
+    if (autocheckpoint >= 0)
+      sqlite3_wal_autocheckpoint(db.get(), autocheckpoint);
+  }
+
+  //==========================================================================
+  // checkpoint_database
+  //==========================================================================
+  bool checkpoint_database(SQLite3DB& db, int mode)
+  {
+    int n_frames, n_checkpointed;
+    const int retcode = sqlite3_wal_checkpoint_v2(
+        db.get(), nullptr, mode, &n_frames, &n_checkpointed);
+
+    if (retcode == SQLITE_BUSY)
+      return false;
+
+    if (retcode != SQLITE_OK)
+    {
+      std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+      throw SQLiteError("Failed checkpointing the database");
+    }
+
+    return n_frames == n_checkpointed;
+  }
+
   //==========================================================================
   // update_db_connection
   //==========================================================================
@@ -0,0 +1,198 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+
+#include "zlib.h"
+
+#include "SQLamarr/input_streams.h"
+#include "SQLamarr/EventIndex.h"
+
+namespace
+{
+  //==========================================================================
+  // GzipStreamBuf: stream buffer decompressing a gzip file
+  //==========================================================================
+  class GzipStreamBuf: public std::streambuf
+  {
+    public:
+      GzipStreamBuf (gzFile file)
+        : m_file (file)
+        , m_buffer (1 << 16)
+      {
+        gzbuffer(m_file, 1 << 17);
+      }
+
+      ~GzipStreamBuf () { gzclose(m_file); }
+
+    protected:
+      int_type underflow () override
+      {
+        if (gptr() < egptr())
+          return traits_type::to_int_type(*gptr());
+
+        const int n_bytes = gzread(m_file, m_buffer.data(), m_buffer.size());
+        if (n_bytes <= 0)
+          return traits_type::eof();
+
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n_bytes);
+        return traits_type::to_int_type(*gptr());
+      }
+
+    private:
+      gzFile m_file;
+      std::vector<char> m_buffer;
+  };
+
+  //==========================================================================
+  // GzipInputStream: input stream owning its GzipStreamBuf
+  //==========================================================================
+  class GzipInputStream: public std::istream
+  {
+    public:
+      GzipInputStream (gzFile file)
+        : std::istream (nullptr)
+        , m_buffer (file)
+      {
+        rdbuf(&m_buffer);
+      }
+
+    private:
+      GzipStreamBuf m_buffer;
+  };
+
+  //==========================================================================
+  // ReplayStreamBuf: stream buffer reading the header of a file, and then 
+  // the file from a given offset
+  //==========================================================================
+  class ReplayStreamBuf: public std::streambuf
+  {
+    public:
+      ReplayStreamBuf (
+          const std::string& path, 
+          uint64_t header_size, 
+          uint64_t offset
+          )
+        : m_file (path, std::ios::binary)
+        , m_buffer (std::max<uint64_t>(header_size, 1 << 16))
+      {
+        m_file.read(m_buffer.data(), header_size);
+        const std::streamsize n_bytes = m_file.gcount();
+        m_file.clear();
+        m_file.seekg(offset);
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n_bytes);
+      }
+
+      bool is_open () const { return m_file.is_open(); }
+
+    protected:
+      int_type underflow () override
+      {
+        if (gptr() < egptr())
+          return traits_type::to_int_type(*gptr());
+
+        m_file.read(m_buffer.data(), m_buffer.size());
+        const std::streamsize n_bytes = m_file.gcount();
+        if (n_bytes <= 0)
+          return traits_type::eof();
+
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n_bytes);
+        return traits_type::to_int_type(*gptr());
+      }
+
+    private:
+      std::ifstream m_file;
+      std::vector<char> m_buffer;
+  };
+
+  //==========================================================================
+  // ReplayInputStream: input stream owning its ReplayStreamBuf
+  //==========================================================================
+  class ReplayInputStream: public std::istream
+  {
+    public:
+      ReplayInputStream (
+          const std::string& path, 
+          uint64_t header_size, 
+          uint64_t offset
+          )
+        : std::istream (nullptr)
+        , m_buffer (path, header_size, offset)
+      {
+        rdbuf(&m_buffer);
+        if (!m_buffer.is_open())
+          setstate(std::ios::failbit);
+      }
+
+    private:
+      ReplayStreamBuf m_buffer;
+  };
+}
+
+namespace SQLamarr
+{
+  //==========================================================================
+  // open_input_stream
+  //==========================================================================
+  std::shared_ptr<std::istream> open_input_stream (const std::string& path)
+  {
+    std::shared_ptr<std::ifstream> file = std::make_shared<std::ifstream>(path);
+    if (!file->is_open())
+      return file;
+
+    char magic[2] = {0, 0};
+    file->read(magic, 2);
+    const bool compressed = file->gcount() == 2 && 
+      static_cast<unsigned char>(magic[0]) == 0x1f &&
+      static_cast<unsigned char>(magic[1]) == 0x8b;
+
+    if (!compressed)
+    {
+      file->clear();
+      file->seekg(0);
+      return file;
+    }
+
+    file->close();
+    gzFile gz = gzopen(path.c_str(), "rb");
+    if (gz == nullptr)
+    {
+      file->setstate(std::ios::failbit);
+      return file;
+    }
+
+    return std::make_shared<GzipInputStream>(gz);
+  }
+
+  //==========================================================================
+  // open_input_stream (from an event)
+  //==========================================================================
+  std::shared_ptr<std::istream> open_input_stream (
+      const std::string& path,
+      size_t& first_event
+      )
+  {
+    std::shared_ptr<std::istream> stream = open_input_stream(path);
+    if (first_event == 0 || !std::dynamic_pointer_cast<std::ifstream>(stream)
+        || stream->fail())
+      return stream;
+
+    // The lines preceding the first event (version, run info...) are read
+    // before jumping to the requested event
+    const EventIndex index (path);
+    stream = std::make_shared<ReplayInputStream>(
+        path, index.offset(0), index.offset(first_event));
+    first_event = 0;
+    return stream;
+  }
+}
@@ -18,6 +18,7 @@
 #include "SQLamarr/PVReconstruction.h"
 #include "SQLamarr/Plugin.h"
 #include "SQLamarr/GenerativePlugin.h"
+#include "SQLamarr/MultiModelPlugin.h"
 #include "SQLamarr/GlobalPRNG.h"
 #include "SQLamarr/TemporaryTable.h"
 #include "SQLamarr/BlockLib/LbParticleId.h"
@@ -62,15 +63,17 @@ int main(int argc, char* argv[])
   size_t evtNumber = 0;
   size_t runNumber = 456;
 
-  for (std::string& file_path: file_paths)
-    if (evtNumber < 100) 
-      loader.load(file_path, runNumber, evtNumber++);
+  if (file_paths.size() > 100)
+    file_paths.resize(100);
+  loader.load_many(file_paths, runNumber, evtNumber);
 
   // Runs the PVFinder algorithm
   SQLamarr::PVFinder pvfinder(db);
+  pvfinder.set_incremental(true);
   pvfinder.execute();
 
   SQLamarr::MCParticleSelector mcps(db);
+  mcps.set_incremental(true);
   mcps.execute();
 
   SQLamarr::PVReconstruction pv_reco(db,
@@ -78,11 +81,11 @@ int main(int argc, char* argv[])
         "../temporary_data/PrimaryVertex/PrimaryVertexSmearing.db",
         "PVSmearing", "2016_pp_MagUp")
       );
+  pv_reco.set_incremental(true);
   pv_reco.execute();
 
-  SQLamarr::Plugin acceptance_model (db,
-        "../temporary_data/models/lhcb.trk.2016MU.so",
-        "acceptance", 
+  // Acceptance and efficiency share the input query, run only once
+  SQLamarr::MultiModelPlugin tracking_models (db,
         R"(
         SELECT 
           mcparticle_id,
@@ -107,45 +110,23 @@ int main(int argc, char* argv[])
           AND
           propagation_charge(p.pid) <> 0.
         )",
-        "tmp_acceptance_out", {"acceptance"}, {"mcparticle_id"}
+        {"mcparticle_id"}
       );
 
-  acceptance_model.execute();
-
+  tracking_models.add_model(
+        "../temporary_data/models/lhcb.trk.2016MU.so",
+        "acceptance", 
+        "tmp_acceptance_out", {"acceptance"}
+      );
 
-  SQLamarr::Plugin efficiency_model (db,
+  tracking_models.add_model(
         "../temporary_data/models/lhcb.trk.2016MU.so",
         "efficiency", 
-        R"(
-        SELECT 
-          mcparticle_id,
-          ov.x AS mc_x, 
-          ov.y AS mc_y, 
-          ov.z AS mc_z,
-          log10(norm2(p.px, p.py, p.pz)) AS mc_log10_p,
-          p.px/p.pz AS mc_tx, 
-          p.py/p.pz AS mc_ty,
-          pseudorapidity(p.px, p.py, p.pz) AS mc_eta,
-          azimuthal(p.px, p.py, p.pz) AS mc_phi,
-          abs(p.pid) == 11 AS mc_is_e,
-          abs(p.pid) == 13 AS mc_is_mu,
-          (
-            abs(p.pid) == 211 OR abs(p.pid) == 321 OR abs(p.pid) == 2212  
-          ) AS mc_is_h,
-          propagation_charge(p.pid) AS mc_charge
-        FROM MCParticles AS p
-        INNER JOIN MCVertices AS ov ON p.production_vertex = ov.mcvertex_id
-        WHERE 
-          p.pz > 1.
-          AND
-          propagation_charge(p.pid) <> 0.
-        )",
         "tmp_efficiency_out", 
-        {"not_recoed", "long", "upstream", "downstream"}, 
-        {"mcparticle_id"}
+        {"not_recoed", "long", "upstream", "downstream"}
       );
 
-  efficiency_model.execute();
+  tracking_models.execute();
 
   SQLamarr::TemporaryTable debug_eff (db,
       "debug_eff", 
@@ -379,27 +360,21 @@ int main(int argc, char* argv[])
   const std::string particle_table = "MCParticles";
   const std::string track_table = "tmp_particles_recoed_as";
 
-  std::vector<std::unique_ptr<SQLamarr::GenerativePlugin>> pid_algos;
-  pid_algos.push_back(SQLamarr::BlockLib::LbParticleId::make (db, pidlib, "pion_pipe", "tmp_pid_pi",
-        particle_table, track_table, 211));
-  pid_algos.push_back(SQLamarr::BlockLib::LbParticleId::make(db, pidlib, "kaon_pipe", "tmp_pid_k",
-        particle_table, track_table, 321));
-  pid_algos.push_back(SQLamarr::BlockLib::LbParticleId::make(db, pidlib, "proton_pipe", "tmp_pid_p",
-        particle_table, track_table, 2212));
-  pid_algos.push_back(SQLamarr::BlockLib::LbParticleId::make(db, pidlib, "muon_pipe", "tmp_pid_mu",
-        particle_table, track_table, 13));
-  for (auto& pid_algo: pid_algos)
-    pid_algo->execute();
+  // One scan of the tracks, routed to the model of each species
+  auto pid_algo = SQLamarr::BlockLib::LbParticleId::make_fused(db, pidlib, 
+      {
+        {211, "pion_pipe"},
+        {321, "kaon_pipe"},
+        {2212, "proton_pipe"},
+        {13, "muon_pipe"}
+      },
+      "tmp_pid", particle_table, track_table);
+  pid_algo->execute();
 
   SQLamarr::TemporaryTable concat_pid(db,
       "pid",
       SQLamarr::BlockLib::LbParticleId::get_column_names(),
-      { 
-      "SELECT * FROM tmp_pid_pi",
-      "SELECT * FROM tmp_pid_k",
-      "SELECT * FROM tmp_pid_mu",
-      "SELECT * FROM tmp_pid_p"
-      },
+      "SELECT * FROM tmp_pid",
       /*make_persistent*/ true
       );
   concat_pid.execute();
@@ -472,7 +447,7 @@ std::vector<std::string> globVector(const std::string& pattern)
   glob(pattern.c_str(),GLOB_TILDE,NULL,&glob_result);
 
   for(unsigned int i = 0; i < glob_result.gl_pathc; ++i)
-    files.push_back(string(glob_result.gl_pathv[i]));
+    files.push_back(std::string(glob_result.gl_pathv[i]));
 
   globfree(&glob_result);
 
@@ -0,0 +1,321 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// STL
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// SQLamarr
+#include "SQLamarr/merge_databases.h"
+#include "SQLamarr/SQLiteError.h"
+
+namespace SQLamarr
+{
+  namespace
+  {
+    /// Primary keys of the event store and the tables defining them
+    const char* s_keys[][2] = {
+      {"datasource_id", "DataSources"},
+      {"genevent_id", "GenEvents"},
+      {"genvertex_id", "GenVertices"},
+      {"genparticle_id", "GenParticles"},
+      {"mcvertex_id", "MCVertices"},
+      {"mcparticle_id", "MCParticles"},
+      {"vertex_id", "Vertices"}
+    };
+
+    /// Columns referring to a key with a different name
+    const char* s_references[][3] = {
+      {"GenParticles", "production_vertex", "genvertex_id"},
+      {"GenParticles", "end_vertex", "genvertex_id"},
+      {"MCParticles", "production_vertex", "mcvertex_id"},
+      {"MCParticles", "end_vertex", "mcvertex_id"}
+    };
+
+    /// Column of a table, as described by PRAGMA table_info
+    struct ColumnInfo
+    {
+      std::string name;
+      std::string type;
+      bool primary_key;
+    };
+
+    //========================================================================
+    // quoted: SQL identifier in double quotes
+    //========================================================================
+    std::string quoted (const std::string& name)
+    {
+      std::string ret = "\"";
+      for (char c: name)
+        ret += (c == '"') ? std::string("\"\"") : std::string(1, c);
+      return ret + "\"";
+    }
+
+    //========================================================================
+    // execute: run a statement ignoring its output
+    //========================================================================
+    void execute (SQLite3DB& db, const std::string& query)
+    {
+      sqlite3_stmt* stmt = prepare_statement(db, query);
+      int retcode;
+      while ((retcode = sqlite3_step(stmt)) == SQLITE_ROW);
+      sqlite3_finalize(stmt);
+
+      if (retcode != SQLITE_DONE)
+      {
+        std::cerr << sqlite3_errmsg(db.get()) << std::endl;
+        throw SQLiteError("Failed executing: " + query);
+      }
+    }
+
+    //========================================================================
+    // table_exists
+    //========================================================================
+    bool table_exists (
+        SQLite3DB& db, const std::string& schema, const std::string& table)
+    {
+      sqlite3_stmt* stmt = prepare_statement(db,
+          "SELECT 1 FROM " + schema + ".sqlite_master "
+          "WHERE type = 'table' AND name = ?");
+      sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+      const bool ret = (sqlite3_step(stmt) == SQLITE_ROW);
+      sqlite3_finalize(stmt);
+      return ret;
+    }
+
+    //========================================================================
+    // table_columns
+    //========================================================================
+    std::vector<ColumnInfo> table_columns (
+        SQLite3DB& db, const std::string& schema, const std::string& table)
+    {
+      std::vector<ColumnInfo> ret;
+      sqlite3_stmt* stmt = prepare_statement(db,
+          "PRAGMA " + schema + ".table_info(" + quoted(table) + ")");
+
+      while (sqlite3_step(stmt) == SQLITE_ROW)
+      {
+        ColumnInfo column;
+        column.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        column.type = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+        column.primary_key = (sqlite3_column_int(stmt, 5) > 0);
+        std::transform(column.type.begin(), column.type.end(),
+            column.type.begin(), ::toupper);
+        ret.push_back(column);
+      }
+
+      sqlite3_finalize(stmt);
+      return ret;
+    }
+
+    //========================================================================
+    // last_id: largest identifier ever assigned in a table
+    //========================================================================
+    sqlite3_int64 last_id (
+        SQLite3DB& db, 
+        const std::string& schema, 
+        const std::string& table, 
+        const std::string& id
+        )
+    {
+      if (!table_exists(db, schema, table))
+        return 0;
+
+      // AUTOINCREMENT identifiers of deleted rows are not reused, and may
+      // still be referenced by other tables
+      std::string query = "SELECT IFNULL(MAX(" + quoted(id) + "), 0) FROM " 
+        + schema + "." + quoted(table);
+      if (table_exists(db, schema, "sqlite_sequence"))
+        query = "SELECT MAX((" + query + "), IFNULL((SELECT seq FROM " 
+          + schema + ".sqlite_sequence WHERE name = '" + table + "'), 0))";
+
+      sqlite3_stmt* stmt = prepare_statement(db, query);
+      const sqlite3_int64 ret =
+        (sqlite3_step(stmt) == SQLITE_ROW) ? sqlite3_column_int64(stmt, 0) : 0;
+      sqlite3_finalize(stmt);
+      return ret;
+    }
+
+    //========================================================================
+    // attached_inputs: schemas of the inputs attached to the connection
+    //========================================================================
+    std::vector<std::string> attached_inputs (SQLite3DB& db)
+    {
+      std::vector<std::string> ret;
+      sqlite3_stmt* stmt = prepare_statement(db, "PRAGMA database_list");
+      while (sqlite3_step(stmt) == SQLITE_ROW)
+      {
+        const std::string name =
+          reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (name.compare(0, 15, "sqlamarr_input_") == 0)
+          ret.push_back(name);
+      }
+
+      sqlite3_finalize(stmt);
+      return ret;
+    }
+
+    //========================================================================
+    // key_of: key referred to by a column, empty if none
+    //========================================================================
+    std::string key_of (const std::string& table, const std::string& column)
+    {
+      for (auto& key: s_keys)
+        if (column == key[0])
+          return key[0];
+
+      for (auto& reference: s_references)
+        if (table == reference[0] && column == reference[1])
+          return reference[2];
+
+      return std::string();
+    }
+  }
+
+  //==========================================================================
+  // merge_databases
+  //==========================================================================
+  std::map<std::string, uint64_t> merge_databases (
+      SQLite3DB& output,
+      const std::vector<std::string>& input_paths,
+      const std::vector<std::string>& tables
+      )
+  {
+    std::map<std::string, uint64_t> n_rows;
+    std::map<std::string, sqlite3_int64> next_offsets;
+
+    // Inputs merged in a transaction of the caller cannot be detached
+    // until it ends, and are detached by the following merges
+    std::vector<std::string> attached = attached_inputs(output);
+    for (const std::string& schema: attached)
+      sqlite3_exec(output.get(), ("DETACH DATABASE " + schema).c_str(),
+          nullptr, nullptr, nullptr);
+    attached = attached_inputs(output);
+
+    for (const std::string& input_path: input_paths)
+    {
+      std::string input;
+      for (size_t iInput = 0; input.empty() || std::count(
+            attached.begin(), attached.end(), input); ++iInput)
+        input = "sqlamarr_input_" + std::to_string(iInput);
+
+      sqlite3_stmt* attach = prepare_statement(output,
+          "ATTACH DATABASE ? AS " + input);
+      sqlite3_bind_text(attach, 1, input_path.c_str(), -1, SQLITE_TRANSIENT);
+      const int retcode = sqlite3_step(attach);
+      sqlite3_finalize(attach);
+      if (retcode != SQLITE_DONE)
+      {
+        std::cerr << sqlite3_errmsg(output.get()) << std::endl;
+        throw SQLiteError("Failed attaching " + input_path);
+      }
+
+      bool in_savepoint = false;
+      try
+      {
+        // Tables of the input, in the order they were created
+        std::vector<std::pair<std::string, std::string> > input_tables;
+        sqlite3_stmt* list = prepare_statement(output,
+            "SELECT name, sql FROM " + input + ".sqlite_master "
+            "WHERE type = 'table' AND name NOT LIKE 'sqlite_%' "
+            "AND sql NOT LIKE 'CREATE VIRTUAL TABLE%' ORDER BY rowid");
+        while (sqlite3_step(list) == SQLITE_ROW)
+        {
+          const std::string name =
+            reinterpret_cast<const char*>(sqlite3_column_text(list, 0));
+          if (tables.empty() ||
+              std::find(tables.begin(), tables.end(), name) != tables.end())
+            input_tables.push_back(std::make_pair(name,
+                  reinterpret_cast<const char*>(sqlite3_column_text(list, 1))));
+        }
+        sqlite3_finalize(list);
+
+        // Offsets of the identifiers, after those assigned in the output
+        // and in the previous inputs
+        std::map<std::string, sqlite3_int64> offsets;
+        for (auto& key: s_keys)
+        {
+          offsets[key[0]] = std::max(next_offsets[key[0]], 
+              last_id(output, "main", key[1], key[0]));
+          next_offsets[key[0]] = offsets[key[0]] + 
+            last_id(output, input, key[1], key[0]);
+        }
+
+        // A savepoint, rather than a transaction, so that the merge can be
+        // part of a transaction opened by the caller
+        execute(output, "SAVEPOINT sqlamarr_merge");
+        in_savepoint = true;
+        for (auto& table: input_tables)
+        {
+          const std::string& name = table.first;
+          if (!table_exists(output, "main", name))
+            execute(output, table.second);
+
+          const std::vector<ColumnInfo> input_columns =
+            table_columns(output, input, name);
+          const std::vector<ColumnInfo> output_columns =
+            table_columns(output, "main", name);
+          const size_t n_primary_keys = std::count_if(
+              input_columns.begin(), input_columns.end(),
+              [](const ColumnInfo& c) { return c.primary_key; });
+
+          std::string targets, values;
+          for (const ColumnInfo& column: input_columns)
+          {
+            const std::string key = key_of(name, column.name);
+            const bool in_output = std::find_if(
+                output_columns.begin(), output_columns.end(),
+                [&column](const ColumnInfo& c) { return c.name == column.name; }
+                ) != output_columns.end();
+
+            // Integer primary keys not referenced by other tables are reassigned
+            if (!in_output || (key.empty() && column.primary_key &&
+                  n_primary_keys == 1 && column.type == "INTEGER"))
+              continue;
+
+            targets += (targets.empty() ? "" : ", ") + quoted(column.name);
+            values += (values.empty() ? "" : ", ") + quoted(column.name);
+            if (!key.empty() && offsets[key] != 0)
+              values += " + " + std::to_string(offsets[key]);
+          }
+
+          if (targets.empty())
+            continue;
+
+          execute(output,
+              "INSERT INTO main." + quoted(name) + " (" + targets + ") "
+              "SELECT " + values + " FROM " + input + "." + quoted(name));
+          n_rows[name] += sqlite3_changes(output.get());
+        }
+        execute(output, "RELEASE sqlamarr_merge");
+      }
+      catch (...)
+      {
+        if (in_savepoint)
+          sqlite3_exec(output.get(), 
+              "ROLLBACK TO sqlamarr_merge; RELEASE sqlamarr_merge", 
+              nullptr, nullptr, nullptr);
+        sqlite3_exec(output.get(), ("DETACH DATABASE " + input).c_str(),
+            nullptr, nullptr, nullptr);
+        throw;
+      }
+
+      if (sqlite3_get_autocommit(output.get()))
+        execute(output, "DETACH DATABASE " + input);
+      else if (sqlite3_exec(output.get(), ("DETACH DATABASE " + input).c_str(),
+            nullptr, nullptr, nullptr) != SQLITE_OK)
+        attached.push_back(input);
+    }
+
+    return n_rows;
+  }
+}
@@ -0,0 +1,80 @@
+// (c) Copyright 2022 CERN for the benefit of the LHCb Collaboration.
+//
+// This software is distributed under the terms of the GNU General Public
+// Licence version 3 (GPL Version 3), copied verbatim in the file "LICENCE".
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+// Merge the output databases of independent SQLamarr jobs.
+//
+// Usage:
+//   sqlamarr_merge [--table NAME]... OUTPUT INPUT [INPUT...]
+//
+// The tables of the input databases (or only those selected with --table)
+// are appended to OUTPUT, created with the SQLamarr schema if missing,
+// shifting the identifiers of the event store as in
+// SQLamarr::merge_databases.
+
+// STL
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+
+// SQLamarr
+#include "SQLamarr/db_functions.h"
+#include "SQLamarr/merge_databases.h"
+
+
+//==============================================================================
+// main
+//==============================================================================
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> tables;
+  std::vector<std::string> paths;
+  for (int iArg = 1; iArg < argc; ++iArg)
+  {
+    const std::string arg(argv[iArg]);
+    if (arg == "--table" && iArg + 1 < argc)
+      tables.push_back(argv[++iArg]);
+    else if (arg.size() > 1 && arg[0] == '-')
+    {
+      std::cerr << "Unknown option " << arg << std::endl;
+      exit(1);
+    }
+    else
+      paths.push_back(arg);
+  }
+
+  if (paths.size() < 2)
+  {
+    std::cerr
+      << "Usage: " << argv[0]
+      << " [--table NAME]... OUTPUT INPUT [INPUT...]" << std::endl;
+    exit(1);
+  }
+
+  const std::vector<std::string> inputs(paths.begin() + 1, paths.end());
+  SQLamarr::SQLite3DB db = SQLamarr::make_database(paths[0]);
+
+  // A failed merge leaves an incomplete output anyway: skip the fsyncs
+  sqlite3_exec(db.get(), "PRAGMA synchronous = OFF", nullptr, nullptr, nullptr);
+
+  const auto start = std::chrono::steady_clock::now();
+  const std::map<std::string, uint64_t> n_rows =
+    SQLamarr::merge_databases(db, inputs, tables);
+  const std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  std::cout << "Merged " << inputs.size() << " databases into " << paths[0]
+    << " in " << elapsed.count() << " s" << std::endl;
+  for (auto& table: n_rows)
+    std::cout << "  " << table.first << ": " << table.second << " rows\n";
+
+  return 0;
+}
@@ -9,25 +9,42 @@
 
 
 #include <string.h>
+#include <math.h>
+#include <stdint.h>
 #include <memory>
+#include <algorithm>
 #include <exception>
+#include <functional>
 #include <iostream>
 #include "SQLamarr/HepMC2DataLoader.h"
+#include "SQLamarr/HepMC3DataLoader.h"
+#include "SQLamarr/SyntheticDataLoader.h"
+#include "SQLamarr/BinaryDataLoader.h"
 #include "SQLamarr/PVFinder.h"
 #include "SQLamarr/db_functions.h"
+#include "SQLamarr/merge_databases.h"
 #include "SQLamarr/MCParticleSelector.h"
 #include "SQLamarr/PVReconstruction.h"
 #include "SQLamarr/Plugin.h"
 #include "SQLamarr/GenerativePlugin.h"
+#include "SQLamarr/MultiModelPlugin.h"
 #include "SQLamarr/GlobalPRNG.h"
 #include "SQLamarr/TemporaryTable.h"
+#include "SQLamarr/ArrowWriter.h"
 #include "SQLamarr/CleanEventStore.h"
 #include "SQLamarr/EditEventStore.h"
 #include "SQLamarr/UpdateDBConnection.h"
 #include "SQLamarr/SQLiteError.h"
+#include "SQLamarr/Pipeline.h"
+#include "SQLamarr/ColumnarEventStore.h"
+#include "SQLamarr/HepMC2VirtualTable.h"
 
 constexpr int SQL_ERRORSHIFT = 10000;
 constexpr int LOGIC_ERRORSHIFT = 20000;
+constexpr int LOADER_ERROR = 30000;
+
+constexpr int BUFFER_FLOAT64 = 0;
+constexpr int BUFFER_INT64 = 1;
 
 using SQLamarr::SQLite3DB;
 
@@ -41,6 +58,8 @@ typedef enum {
     , CleanEventStore
     , EditEventStore
     , UpdateDBConnection
+    , ArrowWriter
+    , MultiModelPlugin
   } TransformerType;
 
 struct TransformerPtr {
@@ -48,9 +67,26 @@ struct TransformerPtr {
   void *p;
 };
 
+struct PipelineStats {
+  uint64_t calls;
+  double wall_time;
+  double cpu_time;
+  int64_t rows_changed;
+  uint64_t rows_returned;
+  uint64_t statements_prepared;
+  int64_t cache_hits;
+  int64_t cache_misses;
+};
+
+struct QueryReader {
+  sqlite3_stmt* stmt;
+  bool done;
+};
+
 SQLamarr::Transformer* resolve_polymorphic_transformer(TransformerPtr);
 void clear_cache_if_any(TransformerPtr);
 std::vector<std::string> tokenize (const char*);
+int run_persistent_pipeline(SQLamarr::Pipeline*, std::function<void()>);
 
 //==============================================================================
 // make_database
@@ -83,6 +119,386 @@ void GlobalPRNG_get_or_create(void* db, int seed)
     );
 }
 
+//==============================================================================
+// QueryReader
+//==============================================================================
+extern "C"
+void* new_QueryReader (void* db, const char* query)
+{
+  SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
+  try
+  {
+    return reinterpret_cast<void *> (
+        new QueryReader {SQLamarr::prepare_statement(*udb, query), false}
+      );
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return nullptr;
+  }
+}
+
+extern "C"
+void del_QueryReader (void* self)
+{
+  QueryReader* reader = reinterpret_cast<QueryReader *>(self);
+  sqlite3_finalize(reader->stmt);
+  delete reader;
+}
+
+extern "C"
+int QueryReader_column_count (void* self)
+{
+  return sqlite3_column_count(reinterpret_cast<QueryReader *>(self)->stmt);
+}
+
+extern "C"
+const char* QueryReader_column_name (void* self, int iCol)
+{
+  return sqlite3_column_name(reinterpret_cast<QueryReader *>(self)->stmt, iCol);
+}
+
+extern "C"
+int QueryReader_column_dtype (void* self, int iCol)
+{
+  // Follows the SQLite rules for type affinity of the declared type.
+  // Expressions have no declared type and are exported as floating point.
+  const char* decltype_ = sqlite3_column_decltype(
+      reinterpret_cast<QueryReader *>(self)->stmt, iCol
+      );
+
+  std::string declared_type(decltype_ ? decltype_ : "");
+  std::transform(declared_type.begin(), declared_type.end(), 
+      declared_type.begin(), ::toupper);
+
+  if (declared_type.find("INT") != std::string::npos)
+    return BUFFER_INT64;
+
+  return BUFFER_FLOAT64;
+}
+
+extern "C"
+int64_t QueryReader_fetch (
+    void* self,
+    int n_columns,
+    const int* dtypes,
+    void** buffers,
+    uint8_t** masks,
+    int64_t capacity
+    )
+{
+  QueryReader* reader = reinterpret_cast<QueryReader *>(self);
+  sqlite3_stmt* stmt = reader->stmt;
+
+  int64_t iRow;
+  for (iRow = 0; iRow < capacity && !reader->done; ++iRow)
+  {
+    switch (sqlite3_step(stmt))
+    {
+      case SQLITE_ROW: 
+        break;
+      case SQLITE_DONE:
+        reader->done = true;
+        return iRow;
+      default:
+        std::cerr << sqlite3_errmsg(sqlite3_db_handle(stmt)) << std::endl;
+        return -1;
+    }
+
+    for (int iCol = 0; iCol < n_columns; ++iCol)
+    {
+      const bool is_null = (sqlite3_column_type(stmt, iCol) == SQLITE_NULL);
+      switch (dtypes[iCol])
+      {
+        case BUFFER_FLOAT64:
+          reinterpret_cast<double *>(buffers[iCol])[iRow] = 
+            is_null ? NAN : sqlite3_column_double(stmt, iCol);
+          break;
+        case BUFFER_INT64:
+          // Integers have no NULL value, which is flagged in the mask if any
+          reinterpret_cast<int64_t *>(buffers[iCol])[iRow] = 
+            sqlite3_column_int64(stmt, iCol);
+          if (masks[iCol])
+            masks[iCol][iRow] = is_null;
+          break;
+        default:
+          std::cerr << "Unexpected buffer type: " << dtypes[iCol] << std::endl;
+          return -1;
+      }
+    }
+  }
+
+  return iRow;
+}
+
+//==============================================================================
+// Bulk insert
+//==============================================================================
+extern "C"
+int64_t bulk_insert (
+    void* db,
+    const char* table,
+    const char* columns,
+    int n_columns,
+    const int* dtypes,
+    void** buffers,
+    const uint8_t** masks,
+    int64_t n_rows
+    )
+{
+  SQLite3DB& udb = *reinterpret_cast<SQLite3DB *>(db);
+  std::vector<std::string> column_names = tokenize(columns);
+
+  try
+  {
+    if (static_cast<int>(column_names.size()) != n_columns)
+      throw std::logic_error("Inconsistent number of columns");
+
+    SQLamarr::validate_token(table);
+    for (const auto& column: column_names)
+      SQLamarr::validate_token(column);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "bulk_insert: " << e.what() << std::endl;
+    return -1;
+  }
+
+  // Compose the CREATE TABLE and INSERT statements
+  std::string create_query = 
+    std::string("CREATE TABLE IF NOT EXISTS ") + table + " (";
+  std::string insert_query = std::string("INSERT INTO ") + table + " (";
+  std::string placeholders;
+  for (int iCol = 0; iCol < n_columns; ++iCol)
+  {
+    const char* sep = (iCol == 0) ? "" : ", ";
+    create_query += sep + column_names[iCol] 
+      + (dtypes[iCol] == BUFFER_INT64 ? " INTEGER" : " REAL");
+    insert_query += sep + column_names[iCol];
+    placeholders += std::string(sep) + "?";
+  }
+  create_query += ")";
+  insert_query += ") VALUES (" + placeholders + ")";
+
+  // The rows are inserted in a savepoint, nested in any open transaction
+  if (sqlite3_exec(udb.get(), "SAVEPOINT sqlamarr_bulk", 
+        nullptr, nullptr, nullptr) != SQLITE_OK)
+  {
+    std::cerr << sqlite3_errmsg(udb.get()) << std::endl;
+    return -1;
+  }
+
+  sqlite3_stmt* insert = nullptr;
+  try
+  {
+    sqlite3_stmt* create = SQLamarr::prepare_statement(udb, create_query);
+    const int retcode = sqlite3_step(create);
+    sqlite3_finalize(create);
+    if (retcode != SQLITE_DONE)
+      throw SQLamarr::SQLiteError("Failed creating the table");
+
+    insert = SQLamarr::prepare_statement(udb, insert_query);
+
+    for (int64_t iRow = 0; iRow < n_rows; ++iRow)
+    {
+      sqlite3_reset(insert);
+      for (int iCol = 0; iCol < n_columns; ++iCol)
+      {
+        if (masks[iCol] && masks[iCol][iRow])
+        {
+          sqlite3_bind_null(insert, iCol + 1);
+        }
+        else if (dtypes[iCol] == BUFFER_INT64)
+        {
+          sqlite3_bind_int64(insert, iCol + 1, 
+              reinterpret_cast<const int64_t *>(buffers[iCol])[iRow]);
+        }
+        else
+        {
+          const double value = 
+            reinterpret_cast<const double *>(buffers[iCol])[iRow];
+          if (isnan(value))
+            sqlite3_bind_null(insert, iCol + 1);
+          else
+            sqlite3_bind_double(insert, iCol + 1, value);
+        }
+      }
+
+      if (sqlite3_step(insert) != SQLITE_DONE)
+        throw SQLamarr::SQLiteError("Failed inserting a row");
+    }
+
+    sqlite3_finalize(insert);
+    insert = nullptr;
+
+    if (sqlite3_exec(udb.get(), "RELEASE sqlamarr_bulk", 
+          nullptr, nullptr, nullptr) != SQLITE_OK)
+      throw SQLamarr::SQLiteError("Failed releasing the savepoint");
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    std::cerr << "bulk_insert: " << e.what() << ": " 
+      << sqlite3_errmsg(udb.get()) << std::endl;
+    sqlite3_finalize(insert);
+    sqlite3_exec(udb.get(), 
+        "ROLLBACK TO sqlamarr_bulk; RELEASE sqlamarr_bulk", 
+        nullptr, nullptr, nullptr);
+    return -1;
+  }
+
+  return n_rows;
+}
+
+//==============================================================================
+// Flush database
+//==============================================================================
+extern "C"
+int flush_database (void* db)
+{
+  try
+  {
+    SQLamarr::flush_database(*reinterpret_cast<SQLite3DB *>(db));
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+//==============================================================================
+// Write-ahead log
+//==============================================================================
+extern "C"
+int enable_wal_mode (void* db, int autocheckpoint)
+{
+  try
+  {
+    SQLamarr::enable_wal_mode(*reinterpret_cast<SQLite3DB *>(db), autocheckpoint);
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+extern "C"
+int checkpoint_database (void* db, int mode)
+{
+  try
+  {
+    return SQLamarr::checkpoint_database(
+        *reinterpret_cast<SQLite3DB *>(db), mode) ? 1 : 0;
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return -1;
+  }
+}
+
+//==============================================================================
+// ColumnarEventStore
+//==============================================================================
+extern "C"
+int attach_columnar_event_store (void* db)
+{
+  try
+  {
+    SQLamarr::ColumnarEventStore::attach(*reinterpret_cast<SQLite3DB *>(db));
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+//==============================================================================
+// HepMC2VirtualTable
+//==============================================================================
+extern "C"
+int attach_hepmc2_file (void* db, const char* file_path, const char* prefix)
+{
+  try
+  {
+    SQLamarr::HepMC2VirtualTable::attach(
+        *reinterpret_cast<SQLite3DB *>(db), file_path, prefix);
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return -1;
+  }
+  catch (const std::runtime_error& e)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+//==============================================================================
+// merge_databases
+//==============================================================================
+extern "C"
+int merge_databases (
+    void* db, 
+    int n_inputs, 
+    const char** input_paths, 
+    int n_tables, 
+    const char** tables
+    )
+{
+  try
+  {
+    SQLamarr::merge_databases(
+        *reinterpret_cast<SQLite3DB *>(db),
+        std::vector<std::string>(input_paths, input_paths + n_inputs),
+        std::vector<std::string>(tables, tables + n_tables)
+        );
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+//==============================================================================
+// AbsDataLoader
+//==============================================================================
+extern "C"
+int AbsDataLoader_load_many (
+      void *self, 
+      int n_files,
+      const char** file_paths,
+      size_t runNumber, 
+      size_t firstEvtNumber,
+      unsigned int n_threads
+    )
+{
+  auto loader = reinterpret_cast<SQLamarr::AbsDataLoader *>(self);
+  std::vector<std::string> files (file_paths, file_paths + n_files);
+  try
+  {
+    loader->load_many(files, runNumber, firstEvtNumber, n_threads);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
+}
+
+
 //==============================================================================
 // HepMC2DataLoader
 //==============================================================================
@@ -90,29 +506,259 @@ extern "C"
 void* new_HepMC2DataLoader (void *db)
 {
   SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
-  return reinterpret_cast<void *> (new SQLamarr::HepMC2DataLoader(*udb));
+  SQLamarr::AbsDataLoader* loader = new SQLamarr::HepMC2DataLoader(*udb);
+  return reinterpret_cast<void *> (loader);
 }
 
 extern "C"
 void del_HepMC2DataLoader (void *self)
 {
-  delete reinterpret_cast<SQLamarr::HepMC2DataLoader *> (self);
+  delete reinterpret_cast<SQLamarr::AbsDataLoader *> (self);
 }
 
 extern "C"
-void HepMC2DataLoader_load (
+int HepMC2DataLoader_load (
+      void *self, 
+      const char* file_path, 
+      size_t runNumber, 
+      size_t evtNumber
+    )
+{
+  auto loader = reinterpret_cast<SQLamarr::AbsDataLoader *>(self);
+  try
+  {
+    loader->load(file_path, runNumber, evtNumber);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
+}
+
+extern "C"
+int HepMC2DataLoader_load_range (
       void *self, 
       const char* file_path, 
       size_t runNumber, 
       size_t evtNumber,
-      const char *db_uri
+      size_t first_event,
+      size_t max_events
+    )
+{
+  auto loader = dynamic_cast<SQLamarr::HepMC2DataLoader *>(
+      reinterpret_cast<SQLamarr::AbsDataLoader *>(self));
+  if (loader == nullptr)
+  {
+    std::cerr << "Not a HepMC2DataLoader" << std::endl;
+    return -1;
+  }
+
+  try
+  {
+    loader->load(file_path, runNumber, evtNumber, first_event, max_events);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
+}
+
+extern "C"
+int HepMC2DataLoader_convert_to_binary (
+      const char* file_path, 
+      const char* output_path
+    )
+{
+  try
+  {
+    SQLamarr::HepMC2DataLoader::convert_to_binary(file_path, output_path);
+  }
+  catch (const std::runtime_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+
+//==============================================================================
+// HepMC3DataLoader
+//==============================================================================
+extern "C"
+void* new_HepMC3DataLoader (void *db)
+{
+  SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
+  SQLamarr::AbsDataLoader* loader = new SQLamarr::HepMC3DataLoader(*udb);
+  return reinterpret_cast<void *> (loader);
+}
+
+extern "C"
+void del_HepMC3DataLoader (void *self)
+{
+  delete reinterpret_cast<SQLamarr::AbsDataLoader *> (self);
+}
+
+extern "C"
+int HepMC3DataLoader_load (
+      void *self, 
+      const char* file_path, 
+      size_t runNumber, 
+      size_t evtNumber
+    )
+{
+  auto loader = reinterpret_cast<SQLamarr::AbsDataLoader *>(self);
+  try
+  {
+    loader->load(file_path, runNumber, evtNumber);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
+}
+
+extern "C"
+int HepMC3DataLoader_load_range (
+      void *self, 
+      const char* file_path, 
+      size_t runNumber, 
+      size_t evtNumber,
+      size_t first_event,
+      size_t max_events
+    )
+{
+  auto loader = dynamic_cast<SQLamarr::HepMC3DataLoader *>(
+      reinterpret_cast<SQLamarr::AbsDataLoader *>(self));
+  if (loader == nullptr)
+  {
+    std::cerr << "Not a HepMC3DataLoader" << std::endl;
+    return -1;
+  }
+
+  try
+  {
+    loader->load(file_path, runNumber, evtNumber, first_event, max_events);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
+}
+
+
+//==============================================================================
+// BinaryDataLoader
+//==============================================================================
+extern "C"
+void* new_BinaryDataLoader (void *db)
+{
+  SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
+  SQLamarr::AbsDataLoader* loader = new SQLamarr::BinaryDataLoader(*udb);
+  return reinterpret_cast<void *> (loader);
+}
+
+extern "C"
+void del_BinaryDataLoader (void *self)
+{
+  delete reinterpret_cast<SQLamarr::AbsDataLoader *> (self);
+}
+
+extern "C"
+int BinaryDataLoader_load (
+      void *self, 
+      const char* file_path, 
+      size_t runNumber, 
+      size_t evtNumber
     )
 {
-  auto loader = reinterpret_cast<SQLamarr::HepMC2DataLoader *>(self);
-  loader->sync_database(db_uri);
-  loader->load(file_path, runNumber, evtNumber);
-  loader->invalidate_cache();
-  loader->sync_database(db_uri);
+  auto loader = reinterpret_cast<SQLamarr::AbsDataLoader *>(self);
+  try
+  {
+    loader->load(file_path, runNumber, evtNumber);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
+}
+
+
+//==============================================================================
+// SyntheticDataLoader
+//==============================================================================
+extern "C"
+void* new_SyntheticDataLoader (
+    void *db,
+    double pileup,
+    double multiplicity,
+    unsigned int max_depth,
+    double decay_probability,
+    unsigned int n_daughters,
+    bool with_signal
+    )
+{
+  SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
+  SQLamarr::SyntheticDataLoader::Config config;
+  config.pileup = pileup;
+  config.multiplicity = multiplicity;
+  config.max_depth = max_depth;
+  config.decay_probability = decay_probability;
+  config.n_daughters = n_daughters;
+  config.with_signal = with_signal;
+
+  SQLamarr::AbsDataLoader* loader = new SQLamarr::SyntheticDataLoader(*udb, config);
+  return reinterpret_cast<void *> (loader);
+}
+
+extern "C"
+void del_SyntheticDataLoader (void *self)
+{
+  delete reinterpret_cast<SQLamarr::AbsDataLoader *> (self);
+}
+
+extern "C"
+int SyntheticDataLoader_load (
+      void *self, 
+      const char* label, 
+      size_t runNumber, 
+      size_t evtNumber
+    )
+{
+  auto loader = reinterpret_cast<SQLamarr::AbsDataLoader *>(self);
+  try
+  {
+    loader->load(label, runNumber, evtNumber);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  loader->flush();
+  return 0;
 }
 
 
@@ -212,6 +858,76 @@ TransformerPtr new_GenerativePlugin (
         )};
 }
 
+//==============================================================================
+// MultiModelPlugin
+//==============================================================================
+extern "C"
+TransformerPtr new_MultiModelPlugin (
+    void *db,
+    const char* query,
+    const char* semicolon_separated_references
+    )
+{
+  SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
+
+  return {MultiModelPlugin, new SQLamarr::MultiModelPlugin(*udb,
+        query,
+        tokenize(semicolon_separated_references)
+        )};
+}
+
+extern "C"
+int MultiModelPlugin_add_model (
+    TransformerPtr self,
+    const char* library_path,
+    const char* function_name,
+    const char* output_table,
+    const char* semicolon_separated_outputs,
+    int n_random,
+    const char* semicolon_separated_inputs,
+    const char* semicolon_separated_selected_values
+    )
+{
+  try
+  {
+    std::vector<int64_t> selected_values;
+    for (const std::string& value: tokenize(semicolon_separated_selected_values))
+      selected_values.push_back(std::stoll(value));
+
+    reinterpret_cast<SQLamarr::MultiModelPlugin*> (self.p)->add_model(
+        library_path,
+        function_name,
+        output_table,
+        tokenize(semicolon_separated_outputs),
+        n_random,
+        tokenize(semicolon_separated_inputs),
+        selected_values
+        );
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+extern "C"
+int MultiModelPlugin_set_selection (TransformerPtr self, const char* column)
+{
+  try
+  {
+    reinterpret_cast<SQLamarr::MultiModelPlugin*> (self.p)->set_selection(column);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
 
 //==============================================================================
 // TemporaryTable
@@ -236,6 +952,14 @@ TransformerPtr new_TemporaryTable (
 }
 
 
+extern "C"
+void TemporaryTable_set_materialization (TransformerPtr self, int strategy)
+{
+  reinterpret_cast<SQLamarr::TemporaryTable*> (self.p)->set_materialization(
+      static_cast<SQLamarr::TemporaryTable::Materialization>(strategy));
+}
+
+
 //==============================================================================
 // CleanEventStore
 //==============================================================================
@@ -274,6 +998,37 @@ TransformerPtr new_UpdateDBConnection (
   return {UpdateDBConnection, new SQLamarr::UpdateDBConnection(*udb, path)};
 }
 
+//==============================================================================
+// ArrowWriter
+//==============================================================================
+extern "C"
+TransformerPtr new_ArrowWriter (
+    void *db, 
+    const char* file_path,
+    const char* query,
+    size_t batch_size
+    )
+{
+  SQLite3DB *udb = reinterpret_cast<SQLite3DB *>(db);
+  return {ArrowWriter, new SQLamarr::ArrowWriter(*udb, file_path, query, batch_size)};
+}
+
+extern "C"
+int ArrowWriter_close (TransformerPtr self)
+{
+  try
+  {
+    reinterpret_cast<SQLamarr::ArrowWriter*> (self.p)->close();
+  }
+  catch (const std::logic_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
 //==============================================================================
 // Delete Transformer
 //==============================================================================
@@ -309,6 +1064,12 @@ void del_Transformer (TransformerPtr self)
     case UpdateDBConnection:
       delete reinterpret_cast<SQLamarr::UpdateDBConnection*> (self.p);
       break;
+    case ArrowWriter:
+      delete reinterpret_cast<SQLamarr::ArrowWriter*> (self.p);
+      break;
+    case MultiModelPlugin:
+      delete reinterpret_cast<SQLamarr::MultiModelPlugin*> (self.p);
+      break;
     default:
       throw std::bad_cast();
   }
@@ -340,6 +1101,10 @@ SQLamarr::Transformer* resolve_polymorphic_transformer(TransformerPtr self)
       return reinterpret_cast<SQLamarr::EditEventStore*> (self.p);
     case UpdateDBConnection:
       return reinterpret_cast<SQLamarr::UpdateDBConnection*> (self.p);
+    case ArrowWriter:
+      return reinterpret_cast<SQLamarr::ArrowWriter*> (self.p);
+    case MultiModelPlugin:
+      return reinterpret_cast<SQLamarr::MultiModelPlugin*> (self.p);
   }
 
   throw std::bad_cast();
@@ -376,11 +1141,33 @@ void clear_cache_if_any(TransformerPtr self)
     case EditEventStore:
       reinterpret_cast<SQLamarr::EditEventStore*> (self.p)->invalidate_cache();
       break;
+    case ArrowWriter:
+      reinterpret_cast<SQLamarr::ArrowWriter*> (self.p)->invalidate_cache();
+      break;
+    case MultiModelPlugin:
+      reinterpret_cast<SQLamarr::MultiModelPlugin*> (self.p)->invalidate_cache();
+      break;
     case UpdateDBConnection:
       break;
   }
 }
 
+//==============================================================================
+// Transformer_set_incremental
+//==============================================================================
+extern "C"
+int Transformer_set_incremental (TransformerPtr self, bool enabled)
+{
+  auto sql_interface = dynamic_cast<SQLamarr::BaseSqlInterface*>(
+      resolve_polymorphic_transformer(self));
+
+  if (sql_interface == nullptr)
+    return -1;
+
+  sql_interface->set_incremental(enabled);
+  return 0;
+}
+
 //==============================================================================
 // Execute Pipeline
 //==============================================================================
@@ -415,6 +1202,209 @@ int execute_pipeline(int algc, TransformerPtr* algv)
 }
 
 
+//==============================================================================
+// Persistent Pipeline
+//==============================================================================
+extern "C"
+void* new_Pipeline (int algc, TransformerPtr* algv, void* loader)
+{
+  std::vector<SQLamarr::Transformer*> algorithms;
+  for (int iAlg = 0; iAlg < algc; ++iAlg)
+    algorithms.push_back(resolve_polymorphic_transformer(algv[iAlg]));
+
+  return reinterpret_cast<void *> (new SQLamarr::Pipeline(algorithms,
+        reinterpret_cast<SQLamarr::AbsDataLoader *>(loader)
+        ));
+}
+
+extern "C"
+void del_Pipeline (void* self)
+{
+  delete reinterpret_cast<SQLamarr::Pipeline *>(self);
+}
+
+extern "C"
+int Pipeline_execute (void* self, size_t n_times)
+{
+  auto pipeline = reinterpret_cast<SQLamarr::Pipeline *>(self);
+  return run_persistent_pipeline(pipeline, 
+      [pipeline, n_times]() { pipeline->execute(n_times); }
+      );
+}
+
+extern "C"
+int Pipeline_execute_over_files (
+    void* self, 
+    int n_files,
+    const char** file_paths,
+    size_t run_number,
+    size_t first_evt_number
+    )
+{
+  auto pipeline = reinterpret_cast<SQLamarr::Pipeline *>(self);
+  std::vector<std::string> files (file_paths, file_paths + n_files);
+
+  return run_persistent_pipeline(pipeline, 
+      [pipeline, files, run_number, first_evt_number]() { 
+        pipeline->execute_over_files(files, run_number, first_evt_number); 
+      });
+}
+
+extern "C"
+void Pipeline_set_instrumentation (void* self, bool enabled)
+{
+  reinterpret_cast<SQLamarr::Pipeline *>(self)->set_instrumentation(enabled);
+}
+
+extern "C"
+int Pipeline_set_transaction_policy (void* self, int policy, size_t n_batches)
+{
+  try
+  {
+    reinterpret_cast<SQLamarr::Pipeline *>(self)->set_transaction_policy(
+        static_cast<SQLamarr::Pipeline::TransactionPolicy>(policy), n_batches);
+  }
+  catch (const std::logic_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+extern "C"
+void Pipeline_set_checkpoint_interval (void* self, size_t n_batches)
+{
+  reinterpret_cast<SQLamarr::Pipeline *>(self)->set_checkpoint_interval(n_batches);
+}
+
+extern "C"
+int Pipeline_set_n_threads (void* self, unsigned int n_threads)
+{
+  try
+  {
+    reinterpret_cast<SQLamarr::Pipeline *>(self)->set_n_threads(n_threads);
+  }
+  catch (const std::logic_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
+
+extern "C"
+void Pipeline_set_skip_unchanged (void* self, bool enabled)
+{
+  reinterpret_cast<SQLamarr::Pipeline *>(self)->set_skip_unchanged(enabled);
+}
+
+extern "C"
+void Pipeline_mark_changed (void* self, const char* table)
+{
+  reinterpret_cast<SQLamarr::Pipeline *>(self)->mark_changed(
+      table ? table : "");
+}
+
+extern "C"
+int Pipeline_get_stage (void* self, int iAlg)
+{
+  const std::vector<std::vector<int> >& stages = 
+    reinterpret_cast<SQLamarr::Pipeline *>(self)->stages();
+
+  for (size_t iStage = 0; iStage < stages.size(); ++iStage)
+    for (int alg: stages[iStage])
+      if (alg == iAlg)
+        return iStage;
+
+  return -1;
+}
+
+extern "C"
+void Pipeline_reset_stats (void* self)
+{
+  reinterpret_cast<SQLamarr::Pipeline *>(self)->reset_stats();
+}
+
+extern "C"
+PipelineStats Pipeline_get_stats (void* self, int iAlg)
+{
+  const SQLamarr::TransformerStats& stats = 
+    reinterpret_cast<SQLamarr::Pipeline *>(self)->stats().at(iAlg);
+
+  return {
+    stats.calls,
+    stats.wall_time,
+    stats.cpu_time,
+    stats.rows_changed,
+    stats.rows_returned,
+    stats.statements_prepared,
+    stats.cache_hits,
+    stats.cache_misses
+  };
+}
+
+extern "C"
+void Pipeline_set_profiling (void* self, bool enabled)
+{
+  reinterpret_cast<SQLamarr::Pipeline *>(self)->set_profiling(enabled);
+}
+
+extern "C"
+int Pipeline_export_stats (
+    void* self, 
+    void* db, 
+    const char* table, 
+    bool append,
+    int first_algorithm
+    )
+{
+  try
+  {
+    reinterpret_cast<SQLamarr::Pipeline *>(self)->export_stats(
+        *reinterpret_cast<SQLite3DB *>(db), table, append, first_algorithm);
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return SQL_ERRORSHIFT;
+  }
+  catch (const std::logic_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return LOGIC_ERRORSHIFT;
+  }
+
+  return 0;
+}
+
+extern "C"
+int Pipeline_export_profiles (
+    void* self, 
+    void* db, 
+    const char* table, 
+    bool append
+    )
+{
+  try
+  {
+    reinterpret_cast<SQLamarr::Pipeline *>(self)->export_profiles(
+        *reinterpret_cast<SQLite3DB *>(db), table, append);
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    return SQL_ERRORSHIFT;
+  }
+  catch (const std::logic_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return LOGIC_ERRORSHIFT;
+  }
+
+  return 0;
+}
+
 //==============================================================================
 // Additional functions
 //==============================================================================
@@ -440,4 +1430,42 @@ std::vector<std::string> tokenize (const char* input_str)
   return ret;
 }
 
+int run_persistent_pipeline (
+    SQLamarr::Pipeline* pipeline, 
+    std::function<void()> event_loop
+    )
+{
+  int ret = 0;
+  try
+  {
+    event_loop();
+  }
+  catch (const SQLamarr::SQLiteError& e)
+  {
+    std::cerr << "Caught SQL error processing #alg: " 
+      << pipeline->current_algorithm() << "\n";
+    std::cerr << e.what() << std::endl;
+    ret = pipeline->current_algorithm() < 0 ? 
+      LOADER_ERROR : SQL_ERRORSHIFT + pipeline->current_algorithm();
+  }
+  catch (const std::logic_error& e)
+  {
+    std::cerr << "Caught logic error processing #alg: " 
+      << pipeline->current_algorithm() << "\n";
+    std::cerr << e.what() << std::endl;
+    ret = pipeline->current_algorithm() < 0 ? 
+      LOADER_ERROR : LOGIC_ERRORSHIFT + pipeline->current_algorithm();
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Caught runtime error processing #alg: " 
+      << pipeline->current_algorithm() << "\n";
+    std::cerr << e.what() << std::endl;
+    ret = pipeline->current_algorithm() < 0 ? 
+      LOADER_ERROR : LOGIC_ERRORSHIFT + pipeline->current_algorithm();
+  }
 
+  // Control is returned to Python, release the locks on the tables
+  pipeline->reset_statements();
+  return ret;
+}
@@ -51,6 +51,12 @@ constexpr char SQL_CREATE_SCHEMA[] = R"(
           FOREIGN KEY(end_vertex) REFERENCES GenVertices(genvertex_id)
         );
 
+        CREATE INDEX IF NOT EXISTS GenVertices_genevent_id
+          ON GenVertices (genevent_id);
+
+        CREATE INDEX IF NOT EXISTS GenParticles_genevent_id
+          ON GenParticles (genevent_id);
+
         CREATE INDEX IF NOT EXISTS GenParticles_production_vertex 
           ON GenParticles (production_vertex);
 
@@ -71,6 +77,9 @@ constexpr char SQL_CREATE_SCHEMA[] = R"(
           FOREIGN KEY(genevent_id) REFERENCES GenEvents(genevent_id)
           );
 
+        CREATE INDEX IF NOT EXISTS MCVertices_genevent_id
+          ON MCVertices (genevent_id);
+
         CREATE TABLE IF NOT EXISTS MCParticles (
           mcparticle_id INTEGER PRIMARY KEY AUTOINCREMENT,
           genparticle_id INTEGER UNIQUE,
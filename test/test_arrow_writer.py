@@ -0,0 +1,75 @@
+import sys
+sys.path.append("python")
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+pa = pytest.importorskip("pyarrow")
+import pyarrow.ipc
+
+
+def test_expression_types(tmp_path):
+  db = SQLamarr.SQLite3DB(str(tmp_path / "arrow.db"))
+  SQLamarr.Pipeline([SQLamarr.EditEventStore(db, [
+    "CREATE TABLE Numbers (n INTEGER)",
+    "INSERT INTO Numbers (n) VALUES (1), (2), (3), (4), (5)",
+    ])]).execute()
+
+  file_path = str(tmp_path / "expressions.arrow")
+  writer = SQLamarr.ArrowWriter(db, file_path, """
+      SELECT 
+        n, 
+        NULLIF(n * 2, 2) AS twice, 
+        CASE WHEN n > 1 THEN 'n' || n END AS label,
+        n / 2.0 AS half,
+        NULL AS missing
+      FROM Numbers ORDER BY n
+      """, batch_size=2)
+  SQLamarr.Pipeline([writer]).execute()
+  writer.close()
+
+  # The types of the expressions are those of their first non-NULL value
+  table = pa.ipc.open_file(file_path).read_all()
+  assert table.schema.field("twice").type == pa.int64()
+  assert table.schema.field("label").type == pa.string()
+  assert table.schema.field("half").type == pa.float64()
+  assert table.schema.field("missing").type == pa.float64()
+
+  assert table.column("twice").to_pylist() == [None, 4, 6, 8, 10]
+  assert table.column("label").to_pylist() == [None, "n2", "n3", "n4", "n5"]
+  assert table.column("half").to_pylist() == [0.5, 1.0, 1.5, 2.0, 2.5]
+  assert table.column("missing").null_count == 5
+
+
+def test_inconsistent_types(tmp_path):
+  db = SQLamarr.SQLite3DB(str(tmp_path / "arrow.db"))
+  SQLamarr.Pipeline([SQLamarr.EditEventStore(db, [
+    "CREATE TABLE Numbers (n INTEGER)",
+    "INSERT INTO Numbers (n) VALUES (1), (2), (3)",
+    ])]).execute()
+
+  # Text following a batch of NULL values, defined as floating point
+  file_path = str(tmp_path / "mixed.arrow")
+  writer = SQLamarr.ArrowWriter(db, file_path, 
+      "SELECT CASE WHEN n > 2 THEN 'n' || n END AS label, n FROM Numbers ORDER BY n",
+      batch_size=2)
+  with pytest.raises(Exception):
+    SQLamarr.Pipeline([writer]).execute()
+
+  # The failed writer does not accept further rows
+  with pytest.raises(Exception):
+    SQLamarr.Pipeline([writer]).execute()
+  writer.close()
+
+  # The file is valid, with the batches completed before the failure
+  with pa.ipc.open_file(file_path) as reader:
+    for iBatch in range(reader.num_record_batches):
+      reader.get_batch(iBatch).validate(full=True)
+    table = reader.read_all()
+
+  assert table.column("n").to_pylist() == [1, 2]
+  assert table.column("label").null_count == 2
@@ -0,0 +1,53 @@
+import sys
+sys.path.append("python")
+
+from glob import glob
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+np = pytest.importorskip("numpy")
+
+_HEPMC2_FILES_ = sorted(glob("temporary_data/HepMC2-ascii/DSt_Pi.hepmc2/evt*.mc2"))
+
+_QUERIES_ = dict(
+    GenParticles="SELECT * FROM GenParticles ORDER BY genparticle_id",
+    GenVertices="SELECT * FROM GenVertices ORDER BY genvertex_id",
+    MCParticles="SELECT * FROM MCParticles ORDER BY mcparticle_id",
+    MCVertices="SELECT * FROM MCVertices ORDER BY mcvertex_id",
+    )
+
+
+def process(columnar: bool):
+  db = SQLamarr.SQLite3DB()
+  if columnar:
+    db.use_columnar_event_store()
+
+  loader = SQLamarr.HepMC2DataLoader(db)
+  for evt_number, file_path in enumerate(_HEPMC2_FILES_[:2]):
+    loader.load(file_path, 1, evt_number)
+
+  SQLamarr.Pipeline([SQLamarr.PVFinder(db), SQLamarr.MCParticleSelector(db)]).execute()
+  return {table: db.query_to_numpy(query) for table, query in _QUERIES_.items()}
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+def test_columnar_matches_row_store():
+  rows = process(columnar=False)
+  columns = process(columnar=True)
+
+  for table in _QUERIES_:
+    assert sorted(rows[table].keys()) == sorted(columns[table].keys()), table
+    for name, expected in rows[table].items():
+      actual = columns[table][name]
+      assert len(expected) > 0, f"{table}.{name}"
+      np.testing.assert_array_equal(
+          np.ma.getmaskarray(actual), np.ma.getmaskarray(expected), 
+          err_msg=f"{table}.{name}")
+      np.testing.assert_array_equal(
+          np.ma.filled(actual, 0), np.ma.filled(expected, 0), 
+          err_msg=f"{table}.{name}")
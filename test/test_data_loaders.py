@@ -0,0 +1,103 @@
+import sys
+sys.path.append("python")
+
+from glob import glob
+import sqlite3
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+_HEPMC2_FILES_ = sorted(glob("temporary_data/HepMC2-ascii/DSt_Pi.hepmc2/evt*.mc2"))
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) == 0, reason="HepMC2 files not available")
+@pytest.mark.parametrize("loader_range", [{}, dict(first_event=0, max_events=1)])
+def test_load_failure_raises(tmp_path, loader_range):
+  db_path = str(tmp_path / "failure.db")
+  db = SQLamarr.SQLite3DB(db_path)
+  SQLamarr.Pipeline([SQLamarr.EditEventStore(db, "DROP TABLE GenParticles")]).execute()
+
+  with pytest.raises(RuntimeError):
+    SQLamarr.HepMC2DataLoader(db).load(_HEPMC2_FILES_[0], 1, 1, **loader_range)
+
+  # The rows inserted before the failure are rolled back, and the 
+  # transaction of the loader is not left open
+  SQLamarr.Pipeline([SQLamarr.EditEventStore(db, "CREATE TABLE X (n INTEGER)")]).execute()
+  with sqlite3.connect(db_path) as c:
+    assert c.execute("SELECT COUNT(*) FROM DataSources").fetchone()[0] == 0
+    assert c.execute("SELECT COUNT(*) FROM GenEvents").fetchone()[0] == 0
+    assert c.execute("SELECT COUNT(*) FROM X").fetchone()[0] == 0
+
+
+def test_synthetic_failure_raises(tmp_path):
+  db = SQLamarr.SQLite3DB(str(tmp_path / "failure.db"))
+
+  # The random number generator was not seeded
+  with pytest.raises(RuntimeError):
+    SQLamarr.SyntheticDataLoader(db).load("synthetic", 1, 1)
+
+
+def write_weighted_hepmc3(path, n_events):
+  """HepMC3 file with run info (weight names, tools) and weighted events"""
+  with open(path, "w") as f:
+    f.write("HepMC::Version 3.02.06\n")
+    f.write("HepMC::Asciiv3-START_EVENT_LISTING\n")
+    f.write("W Default Variation\n")
+    f.write("T Generator\\|1.0\\|test\n")
+    for i in range(n_events):
+      f.write(f"E {i} 1 3\nU GEV MM\nW 1.0 {0.5 + i}\n")
+      f.write("P 1 0 2212 0.0 0.0 6.5e3 6.5e3 0.938 4\n")
+      f.write("V -1 0 [1]\n")
+      f.write(f"P 2 -1 211 {1.0 + i} 0.0 10.0 10.1 0.1396 1\n")
+      f.write("P 3 -1 -211 -1.0 0.0 10.0 10.1 0.1396 1\n")
+    f.write("HepMC::Asciiv3-END_EVENT_LISTING\n")
+
+
+def test_range_matches_full_read(tmp_path):
+  hepmc_path = str(tmp_path / "weighted.hepmc3")
+  write_weighted_hepmc3(hepmc_path, 3)
+
+  query = "SELECT pid, status, px, py, pz, pe FROM GenParticles ORDER BY genparticle_id"
+  results = []
+  for name, loader_range in [("full", {}), ("range", dict(first_event=1, max_events=2))]:
+    db_path = str(tmp_path / f"{name}.db")
+    db = SQLamarr.SQLite3DB(db_path)
+    SQLamarr.HepMC3DataLoader(db).load(hepmc_path, 1, 1, **loader_range)
+    with sqlite3.connect(db_path) as c:
+      results.append(c.execute(query).fetchall())
+
+  assert len(results[0]) == 9
+  assert results[1] == results[0][3:]
+
+
+def test_range_past_the_end(tmp_path):
+  hepmc_path = str(tmp_path / "weighted.hepmc3")
+  write_weighted_hepmc3(hepmc_path, 3)
+
+  db_path = str(tmp_path / "empty.db")
+  db = SQLamarr.SQLite3DB(db_path)
+  SQLamarr.HepMC3DataLoader(db).load(hepmc_path, 1, 1, first_event=5, max_events=2)
+  with sqlite3.connect(db_path) as c:
+    assert c.execute("SELECT COUNT(*) FROM DataSources").fetchone()[0] == 0
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) == 0, reason="HepMC2 files not available")
+def test_virtual_table_missing_vertices():
+  pytest.importorskip("numpy")
+  db = SQLamarr.SQLite3DB().attach_hepmc2_file(_HEPMC2_FILES_[0], "File")
+  SQLamarr.HepMC2DataLoader(db).load(_HEPMC2_FILES_[0], 1, 1)
+
+  # Missing vertices are NULL, as in the event store
+  query = """SELECT 
+      SUM(production_vertex IS NULL) AS no_production, 
+      SUM(end_vertex IS NULL) AS no_end 
+    FROM {}"""
+  attached = db.query_to_numpy(query.format("FileParticles"))
+  loaded = db.query_to_numpy(query.format("GenParticles"))
+  assert attached["no_end"][0] > 0
+  for column in ("no_production", "no_end"):
+    assert attached[column][0] == loaded[column][0]
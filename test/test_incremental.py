@@ -0,0 +1,92 @@
+import sys
+sys.path.append("python")
+
+from glob import glob
+import sqlite3
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+_HEPMC2_FILES_ = sorted(glob("temporary_data/HepMC2-ascii/DSt_Pi.hepmc2/evt*.mc2"))
+
+
+def mcparticles(db_path: str):
+  with sqlite3.connect(db_path) as c:
+    return c.execute(
+        "SELECT genparticle_id, pid, pe FROM MCParticles ORDER BY genparticle_id"
+        ).fetchall()
+
+
+def incremental_algorithms(db):
+  return [
+      SQLamarr.PVFinder(db, incremental=True),
+      SQLamarr.MCParticleSelector(db, incremental=True),
+      ]
+
+
+def process(db, file_path: str, evt_number: int, algorithms):
+  SQLamarr.HepMC2DataLoader(db).load(file_path, 1, evt_number)
+  SQLamarr.Pipeline(algorithms).execute()
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+def test_reload_after_clean(tmp_path):
+  db_path = str(tmp_path / "incremental.db")
+  db = SQLamarr.SQLite3DB(db_path)
+  algorithms = incremental_algorithms(db)
+
+  process(db, _HEPMC2_FILES_[0], 1, algorithms)
+  assert len(mcparticles(db_path)) > 0
+
+  SQLamarr.Pipeline([SQLamarr.CleanEventStore(db)]).execute()
+  process(db, _HEPMC2_FILES_[1], 2, algorithms)
+  reloaded = mcparticles(db_path)
+
+  # Same particles as processing the second file in a new store
+  ref_path = str(tmp_path / "reference.db")
+  ref_db = SQLamarr.SQLite3DB(ref_path)
+  process(ref_db, _HEPMC2_FILES_[1], 2, 
+      incremental_algorithms(ref_db))
+  reference = mcparticles(ref_path)
+
+  assert len(reloaded) == len(reference) > 0
+  assert [r[1:] for r in reloaded] == [r[1:] for r in reference]
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+def test_incremental_accumulation(tmp_path):
+  db_path = str(tmp_path / "incremental.db")
+  db = SQLamarr.SQLite3DB(db_path)
+  algorithms = incremental_algorithms(db)
+
+  process(db, _HEPMC2_FILES_[0], 1, algorithms)
+  n_first = len(mcparticles(db_path))
+  process(db, _HEPMC2_FILES_[1], 2, algorithms)
+  accumulated = mcparticles(db_path)
+
+  # Particles of the first file are not promoted twice
+  assert len(set(r[0] for r in accumulated)) == len(accumulated) > n_first
+
+  # One primary vertex per event, whichever execution processed it
+  with sqlite3.connect(db_path) as c:
+    assert c.execute(
+        "SELECT COUNT(*) FROM MCVertices WHERE is_primary"
+        ).fetchone() == c.execute("SELECT COUNT(*) FROM GenEvents").fetchone()
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) == 0, reason="HepMC2 files not available")
+def test_not_incremental_by_default(tmp_path):
+  db_path = str(tmp_path / "default.db")
+  db = SQLamarr.SQLite3DB(db_path)
+  mcps = SQLamarr.MCParticleSelector(db)
+  process(db, _HEPMC2_FILES_[0], 1, [SQLamarr.PVFinder(db), mcps])
+  n_particles = len(mcparticles(db_path))
+  assert n_particles > 0
+
+  # Deleted particles are selected again by the next execution
+  SQLamarr.Pipeline([SQLamarr.EditEventStore(db, "DELETE FROM MCParticles"), mcps]).execute()
+  assert len(mcparticles(db_path)) == n_particles
@@ -0,0 +1,65 @@
+import sys
+sys.path.append("python")
+
+from glob import glob
+import sqlite3
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+_HEPMC2_FILES_ = sorted(glob("temporary_data/HepMC2-ascii/DSt_Pi.hepmc2/evt*.mc2"))
+
+
+def fetch(db_path: str, query: str):
+  with sqlite3.connect(db_path) as c:
+    return c.execute(query).fetchall()
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+def test_merge_offsets(tmp_path):
+  input_paths = []
+  for iFile, file_path in enumerate(_HEPMC2_FILES_[:2]):
+    input_paths.append(str(tmp_path / f"job{iFile}.db"))
+    db = SQLamarr.SQLite3DB(input_paths[-1])
+    SQLamarr.HepMC2DataLoader(db).load(file_path, 1, iFile + 1)
+    del db
+
+  # The same identifiers are used in both inputs
+  query = "SELECT MIN(genparticle_id), MAX(genparticle_id) FROM GenParticles"
+  ranges = [fetch(path, query)[0] for path in input_paths]
+  assert ranges[0][0] == ranges[1][0] == 1
+
+  output_path = str(tmp_path / "merged.db")
+  SQLamarr.SQLite3DB(output_path).merge(input_paths[:1]).merge(input_paths[1:])
+
+  # The identifiers of the second input follow those of the first one
+  assert fetch(output_path, query)[0] == (1, ranges[0][1] + ranges[1][1])
+  assert fetch(output_path, 
+      "SELECT evt_number FROM DataSources ORDER BY datasource_id") == [(1,), (2,)]
+
+  # The references among the tables are preserved
+  n_particles = sum(fetch(path, "SELECT COUNT(*) FROM GenParticles")[0][0]
+      for path in input_paths)
+  for column in ("production_vertex", "end_vertex"):
+    assert fetch(output_path, f"""
+      SELECT COUNT(*) FROM GenParticles AS p
+      LEFT JOIN GenVertices AS v ON p.{column} = v.genvertex_id
+      WHERE p.{column} IS NOT NULL AND v.genvertex_id IS NULL
+      """)[0][0] == 0
+
+  assert fetch(output_path, """
+    SELECT COUNT(*) FROM GenParticles AS p
+    INNER JOIN GenEvents AS e ON p.genevent_id = e.genevent_id
+    INNER JOIN DataSources AS d ON e.datasource_id = d.datasource_id
+    """)[0][0] == n_particles
+
+  assert fetch(output_path, """
+    SELECT COUNT(*) FROM GenParticles AS p
+    INNER JOIN GenEvents AS e ON p.genevent_id = e.genevent_id
+    INNER JOIN DataSources AS d ON e.datasource_id = d.datasource_id
+    WHERE d.evt_number = 2
+    """)[0][0] == fetch(input_paths[1], "SELECT COUNT(*) FROM GenParticles")[0][0]
@@ -3,6 +3,8 @@ import re
 
 _IGNORE_FILES_ = (
     'src/main.cpp',
+    'src/bench_main.cpp',
+    'src/merge_main.cpp',
     )
 
 def count_print_out(filename: str, fmt: str = 'C++'):
@@ -0,0 +1,43 @@
+import sys
+sys.path.append("python")
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+np = pytest.importorskip("numpy")
+
+
+@pytest.mark.parametrize("chunk_size", [2, 65536])
+def test_round_trip_with_nulls(chunk_size):
+  db = SQLamarr.SQLite3DB()
+  columns = dict(
+      run=np.ma.MaskedArray([1, 2, 3, 4, 5], mask=[0, 1, 0, 0, 1]),
+      event=np.array([10, 20, 30, 40, 50]),
+      scale=np.array([1.01, np.nan, 1.00, 0.98, 1.02]),
+      )
+  assert db.insert_numpy("Calibration", columns) == 5
+
+  ret = db.query_to_numpy("SELECT * FROM Calibration", chunk_size=chunk_size)
+
+  # NULL integers are masked, rather than read as 0
+  assert isinstance(ret["run"], np.ma.MaskedArray)
+  assert ret["run"].dtype == np.int64
+  assert list(ret["run"].mask) == [False, True, False, False, True]
+  assert list(ret["run"].compressed()) == [1, 3, 4]
+
+  # Integer columns without NULLs are plain arrays
+  assert not isinstance(ret["event"], np.ma.MaskedArray)
+  assert list(ret["event"]) == [10, 20, 30, 40, 50]
+
+  # NULL floats are NaN
+  np.testing.assert_array_equal(ret["scale"], columns["scale"])
+
+  # Masked and NaN values are stored as NULL
+  n_nulls = db.query_to_numpy(
+      "SELECT SUM(run IS NULL) AS run, SUM(scale IS NULL) AS scale FROM Calibration")
+  assert n_nulls["run"][0] == 2
+  assert n_nulls["scale"][0] == 1
@@ -0,0 +1,180 @@
+import sys
+sys.path.append("python")
+
+from glob import glob
+import re
+import sqlite3
+
+import pytest
+
+try:
+  import SQLamarr
+except (ImportError, OSError):
+  pytest.skip("libSQLamarr not available", allow_module_level=True)
+
+_HEPMC2_FILES_ = sorted(glob("temporary_data/HepMC2-ascii/DSt_Pi.hepmc2/evt*.mc2"))
+
+
+def count(db_path: str, table: str):
+  with sqlite3.connect(db_path) as c:
+    return c.execute(f"SELECT COUNT(*) FROM {table}").fetchone()[0]
+
+
+def gen_counts(db):
+  """Rows of the generator-level tables, and particles of missing events"""
+  np = pytest.importorskip("numpy")
+  counts = db.query_to_numpy("""
+    SELECT 
+      (SELECT COUNT(*) FROM GenEvents) AS events,
+      (SELECT COUNT(*) FROM GenVertices) AS vertices,
+      (SELECT COUNT(*) FROM GenParticles) AS particles,
+      (SELECT COUNT(*) FROM GenParticles 
+        WHERE genevent_id NOT IN (SELECT genevent_id FROM GenEvents)) AS orphans
+    """)
+  return {k: int(v[0]) for k, v in counts.items()}
+
+
+def make_db(db_path: str, columnar: bool):
+  db = SQLamarr.SQLite3DB(db_path)
+  return db.use_columnar_event_store() if columnar else db
+
+
+def failing_pipeline(db, policy):
+  """Pipeline failing at the second batch, after a nested transaction"""
+  edit = SQLamarr.EditEventStore(db, [
+    "CREATE TABLE IF NOT EXISTS Batches (n INTEGER CHECK (n < 1))",
+    "INSERT INTO Batches (n) SELECT COUNT(*) FROM Batches",
+    ])
+  return SQLamarr.Pipeline(
+      [edit], loader=SQLamarr.HepMC2DataLoader(db), transaction_policy=policy)
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+@pytest.mark.parametrize("columnar", [False, True])
+def test_rollback_failed_batch(tmp_path, columnar):
+  db_path = str(tmp_path / "rollback.db")
+  db = make_db(db_path, columnar)
+  pipeline = failing_pipeline(db, "batch")
+  with pytest.raises(Exception):
+    pipeline.execute_over_files(_HEPMC2_FILES_[:2], 1, 1)
+
+  # The first batch is committed, the second one is rolled back entirely
+  assert count(db_path, "DataSources") == 1
+  assert count(db_path, "Batches") == 1
+  assert gen_counts(db)["orphans"] == 0
+
+  # No transaction is left open: further batches commit normally
+  SQLamarr.Pipeline(
+      [SQLamarr.EditEventStore(db, "DELETE FROM Batches")],
+      transaction_policy="batch"
+      ).execute()
+  assert count(db_path, "Batches") == 0
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+@pytest.mark.parametrize("columnar", [False, True])
+def test_rollback_multiple_batches(tmp_path, columnar):
+  db_path = str(tmp_path / "rollback.db")
+  db = make_db(db_path, columnar)
+  pipeline = failing_pipeline(db, 2)
+  with pytest.raises(Exception):
+    pipeline.execute_over_files(_HEPMC2_FILES_[:2], 1, 1)
+
+  # Both batches belong to the transaction rolled back
+  assert count(db_path, "DataSources") == 0
+  assert gen_counts(db) == dict(events=0, vertices=0, particles=0, orphans=0)
+
+
+@pytest.mark.skipif(len(_HEPMC2_FILES_) < 2, reason="HepMC2 files not available")
+@pytest.mark.parametrize("columnar", [False, True])
+def test_rollback_clean(tmp_path, columnar):
+  db = make_db(str(tmp_path / "rollback.db"), columnar)
+  SQLamarr.HepMC2DataLoader(db).load(_HEPMC2_FILES_[0], 1, 1)
+  loaded = gen_counts(db)
+  assert loaded["particles"] > 0
+
+  # The rows deleted by the failing batch are restored
+  failing = SQLamarr.EditEventStore(db, "INSERT INTO MissingTable VALUES (1)")
+  with pytest.raises(Exception):
+    SQLamarr.Pipeline(
+        [SQLamarr.CleanEventStore(db), failing], transaction_policy="batch"
+        ).execute()
+  assert gen_counts(db) == loaded
+
+  # New rows follow those restored
+  SQLamarr.HepMC2DataLoader(db).load(_HEPMC2_FILES_[1], 1, 2)
+  reloaded = gen_counts(db)
+  assert reloaded["particles"] > loaded["particles"]
+  assert reloaded["orphans"] == 0
+
+
+def test_skip_unchanged_after_python_step(tmp_path):
+  db_path = str(tmp_path / "skip.db")
+  db = SQLamarr.SQLite3DB(db_path)
+  with sqlite3.connect(db_path) as c:
+    c.execute("CREATE TABLE Inputs (n INTEGER)")
+    c.execute("CREATE TABLE Outputs (id INTEGER PRIMARY KEY, n INTEGER)")
+
+  def add_input():
+    with sqlite3.connect(db_path) as c:
+      c.execute("INSERT INTO Inputs VALUES (1)")
+
+  pipeline = SQLamarr.Pipeline([
+      add_input,
+      SQLamarr.EditEventStore(db, 
+        "INSERT OR REPLACE INTO Outputs SELECT 0, COUNT(*) FROM Inputs"),
+    ], skip_unchanged=True)
+  pipeline.execute(3)
+
+  with sqlite3.connect(db_path) as c:
+    assert c.execute("SELECT n FROM Outputs").fetchall() == [(3,)]
+
+
+def test_export_stats(tmp_path):
+  db_path = str(tmp_path / "stats.db")
+  db = SQLamarr.SQLite3DB(db_path)
+
+  def python_step():
+    pass
+
+  edit = SQLamarr.EditEventStore(db, "CREATE TABLE IF NOT EXISTS X (n INTEGER)")
+  cpp_only = SQLamarr.Pipeline([edit], instrument=True)
+  cpp_only.execute(2)
+  cpp_only.export_stats(db, "CppStats")
+
+  mixed = SQLamarr.Pipeline([python_step, edit, python_step], instrument=True)
+  for _ in range(2):
+    mixed.execute(3)
+    mixed.export_stats(db, "MixedStats")
+
+  with sqlite3.connect(db_path) as c:
+    columns = lambda t: [r[1:3] for r in c.execute(f"PRAGMA table_info({t})")]
+    assert columns("MixedStats") == columns("CppStats")
+    rows = c.execute("SELECT algorithm, name, calls FROM MixedStats ORDER BY algorithm").fetchall()
+
+  assert [(r[0], r[2]) for r in rows] == [(0, 6), (1, 6), (2, 6)]
+  assert rows[0][1] == rows[2][1] == "python_step"
+  assert "EditEventStore" in rows[1][1]
+
+
+def test_concurrent_failure(tmp_path):
+  db_path = str(tmp_path / "concurrent.db")
+  dbs = [SQLamarr.SQLite3DB(db_path) for _ in range(2)]
+  dbs[0].enable_wal()
+  algorithms = [
+      SQLamarr.EditEventStore(dbs[0], [
+        "CREATE TABLE IF NOT EXISTS A (n INTEGER)",
+        "INSERT INTO A (n) VALUES (0)",
+        ]),
+      SQLamarr.EditEventStore(dbs[1], [
+        "CREATE TABLE IF NOT EXISTS B (n INTEGER CHECK (n < 1))",
+        "INSERT INTO B (n) SELECT COUNT(*) FROM B",
+        ]),
+      ]
+  pipeline = SQLamarr.Pipeline(algorithms, n_threads=2)
+  pipeline.execute()
+  assert len(pipeline.stages) == 1
+
+  # The second algorithm fails in a worker thread, and is reported
+  with pytest.raises(Exception, match=re.escape(repr(algorithms[1]))):
+    pipeline.execute()